@@ -1,10 +1,11 @@
 import logging
 import os
-from typing import List, Tuple
+from typing import List, Tuple, Dict
 
 import jinja2
 from networkx import Graph
 
+from ops import MESSAGE_WIDTH
 from program import Channel, target_index, FPGA, Program
 
 
@@ -43,15 +44,51 @@ def channel_name(src: Channel, out: bool, graph: Graph) -> str:
 
 
 def generate_program_host(programs: List[Tuple[str, Program]]) -> str:
+    # all the programs share the same rank width
+    wide_ranks = set(program.wide_ranks for (_, program) in programs)
+    assert len(wide_ranks) <= 1
+
     template = read_template_file("host.cl")
-    return template.render(programs=programs)
+    return template.render(programs=programs, wide_ranks=wide_ranks.pop() if wide_ranks else False)
+
+
+def generate_program_native_host(fpgas: List[FPGA], program_names: Dict[str, str],
+                                 device_sources: Dict[str, str]) -> str:
+    """
+    Generates the host code of the native backend.
+    :param fpgas: all FPGAs (ranks) of the cluster
+    :param program_names: mapping from FPGA key to the name of its program
+    :param device_sources: mapping from program name to its generated native device source
+    """
+    fpgas = sorted(fpgas, key=lambda f: f.rank)
+    ranks = [(fpga, program_names[fpga.key()], device_sources[program_names[fpga.key()]]) for fpga in fpgas]
+    programs = [(name, [fpga for fpga in fpgas if program_names[fpga.key()] == name])
+                for name in sorted(device_sources.keys())]
+    # all the ranks share the same message type
+    message_widths = set(fpga.program.message_width for fpga in fpgas)
+    assert len(message_widths) <= 1
+    wide_ranks = set(fpga.program.wide_ranks for fpga in fpgas)
+    assert len(wide_ranks) <= 1
+
+    template = read_template_file("native_host.cl")
+    return template.render(ranks=ranks, programs=programs,
+                           message_width=message_widths.pop() if message_widths else MESSAGE_WIDTH,
+                           wide_ranks=wide_ranks.pop() if wide_ranks else False)
 
 
-def generate_program_device(fpga: FPGA, fpgas: List[FPGA], graph: Graph, channels_per_fpga: int) -> str:
+def generate_program_device(fpga: FPGA, fpgas: List[FPGA], graph: Graph, channels_per_fpga: int,
+                            native=False, sources=()) -> str:
+    """
+    Generates the device code of a program.
+    If native is True, the code is generated for the native (CPU) backend and it includes the given
+    (rewritten) user sources.
+    """
     template = read_template_file("device.cl")
     return template.render(channels=fpga.channels,
                            channels_per_fpga=channels_per_fpga,
                            target_index=target_index,
                            program=fpga.program,
                            fpgas=fpgas,
+                           native=native,
+                           sources=sources,
                            channel_name=lambda channel, out: channel_name(channel, out, graph))
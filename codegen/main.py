@@ -1,15 +1,25 @@
+import json
 import os
-from typing import List
+from typing import Dict, List
 
 import click
+from networkx import Graph
 
-from codegen import generate_program_device, generate_program_host
+from codegen import generate_program_device, generate_program_host, generate_program_native_host
 from common import write_nodefile
-from program import Channel, CHANNELS_PER_FPGA, Program, ProgramMapping
+from ops import MESSAGE_WIDTH, PACKET_PAYLOAD_SIZES
+from program import Channel, CHANNELS_PER_FPGA, Program, ProgramMapping, ARBITERS, ARBITER_ROUND_ROBIN, \
+    RANK_GROUP_SIZE
 from rewrite import copy_files, rewrite
-from routing import create_routing_context
-from routing_table import serialize_to_array, cks_routing_table, ckr_routing_table
-from serialization import serialize_program, parse_routing_file, parse_program
+from routing import create_routing_context, shortest_paths, shortest_path_lengths, channel_dependency_graph, \
+    find_dependency_cycle, p2p_port_hops, place_datelines, place_virtual_channel_datelines
+from routing_table import serialize_to_array, cks_routing_table, ckr_routing_table, cks_multipath_routing_table, \
+    cks_two_level_routing_tables, expand_two_level_table
+from serialization import serialize_program, parse_routing_file, parse_program, parse_port_weights, \
+    parse_communication, parse_p2p_protocols, parse_p2p_hops, \
+    parse_any_source_ports, parse_port_endpoints
+from simulator import load_routing_tables, parse_traffic, synthetic_traffic, simulate as simulate_network, \
+    format_report
 
 
 def prepare_directory(path):
@@ -30,6 +40,24 @@ def write_table(channel: Channel, prefix: str, table: List[int], output_folder):
     write_file(os.path.join(output_folder, filename), bytes, binary=True)
 
 
+def create_cks_tables(graph: Graph, fpgas, wide_ranks: bool, multipath: bool) -> Dict[Channel, List[int]]:
+    if wide_ranks:
+        return cks_two_level_routing_tables(graph, fpgas, fpgas[0].program.rank_group_size)
+    channels = [channel for fpga in fpgas for channel in fpga.channels]
+    if multipath:
+        distances = shortest_path_lengths(graph)
+        return {channel: cks_multipath_routing_table(graph, distances, fpgas, channel) for channel in channels}
+    routes = shortest_paths(graph)
+    return {channel: cks_routing_table(routes, fpgas, channel) for channel in channels}
+
+
+def expand_cks_tables(tables: Dict[Channel, List[int]], fpgas, wide_ranks: bool) -> Dict[Channel, List[int]]:
+    if not wide_ranks:
+        return tables
+    group_size = fpgas[0].program.rank_group_size
+    return {channel: expand_two_level_table(table, len(fpgas), group_size) for (channel, table) in tables.items()}
+
+
 @click.command()
 @click.argument("routing_file")
 @click.argument("rewriter")
@@ -42,9 +70,18 @@ def write_table(channel: Channel, prefix: str, table: List[int], output_folder):
 @click.option("--consecutive-read-limit", default=8)
 @click.option("--max-ranks", default=8)
 @click.option("--p2p-rendezvous", default=True)
+@click.option("--native", is_flag=True)
+@click.option("--arbiter", default=ARBITER_ROUND_ROBIN, type=click.Choice(ARBITERS))
+@click.option("--control-lane", default=False)
+@click.option("--message-width", default=str(MESSAGE_WIDTH), type=click.Choice([str(w) for w in PACKET_PAYLOAD_SIZES]))
+@click.option("--burst-length", default=0)
+@click.option("--wide-ranks", default=False)
+@click.option("--rank-group-size", default=RANK_GROUP_SIZE)
+@click.option("--virtual-channels", default="OFF")
 def codegen_device(routing_file, rewriter, src_dir, dest_dir, device_src,
                    output_program, device_input,
-                   include, consecutive_read_limit, max_ranks, p2p_rendezvous):
+                   include, consecutive_read_limit, max_ranks, p2p_rendezvous, native, arbiter, control_lane,
+                   message_width, burst_length, wide_ranks, rank_group_size, virtual_channels):
     """
     Transpiles device code and generates device kernels and host initialization code.
     :param routing_file: path to a file with FPGA connections and FPGA-to-program mapping
@@ -57,31 +94,59 @@ def codegen_device(routing_file, rewriter, src_dir, dest_dir, device_src,
     :param include: list of include directories for device sources
     :param consecutive_read_limit: how many reads should be performed in succession from a single channel in CKR/CKS
     :param max_ranks: maximum number of ranks in the cluster
-    :param p2p_rendezvous: whether to use rendezvous for P2P operations
+    :param p2p_rendezvous: whether to use rendezvous for P2P operations (unless the connection file sets the protocol
+    of the port)
+    :param native: whether to generate code for the native (CPU) backend
+    :param arbiter: arbitration policy of CKR/CKS (see program.ARBITERS)
+    :param control_lane: whether synchronization messages use a dedicated high-priority lane in CKR/CKS
+    :param message_width: width in bits of the network messages
+    :param burst_length: maximum number of payload flits sent after a single header flit by P2P operations (0 = no bursts)
+    :param wide_ranks: whether to use 16-bit ranks and two-level CK_S routing tables
+    :param rank_group_size: number of consecutive ranks that share an entry of the top-level CK_S routing table
+    :param virtual_channels: whether every QSFP link has two virtual channels, used by the datelines of `route`
     """
     paths = list(copy_files(src_dir, dest_dir, device_input))
 
     p2p_rendezvous = True if p2p_rendezvous in (True, 1, "1", "ON") else False
+    control_lane = True if control_lane in (True, 1, "1", "ON") else False
+    wide_ranks = True if wide_ranks in (True, 1, "1", "ON") else False
+    virtual_channels = True if virtual_channels in (True, 1, "1", "ON") else False
 
     with open("rewrite.log", "w") as f:
         ops = []
         include_dirs = set(include.split(" "))
         for (src, dest) in paths:
-            ops += rewrite(rewriter, dest, include_dirs, f)
+            ops += rewrite(rewriter, dest, include_dirs, f, int(message_width), wide_ranks)
 
     ops = sorted(ops, key=lambda op: op.logical_port)
-    program = Program(ops, consecutive_read_limit, max_ranks, p2p_rendezvous)
 
     with open(routing_file) as rf:
-        (connections, mapping) = parse_routing_file(rf.read(), ignore_programs=True)
+        routing_data = rf.read()
+        routing_json = json.loads(routing_data)
+        program = Program(ops, consecutive_read_limit, max_ranks, p2p_rendezvous, arbiter=arbiter,
+                          control_lane=control_lane, port_weights=parse_port_weights(routing_json),
+                          message_width=int(message_width), burst_length=int(burst_length),
+                          wide_ranks=wide_ranks, rank_group_size=int(rank_group_size),
+                          p2p_protocols=parse_p2p_protocols(routing_json),
+                          p2p_hops=parse_p2p_hops(routing_json),
+                          any_source_ports=parse_any_source_ports(routing_json),
+                          virtual_channels=virtual_channels)
+        (connections, mapping) = parse_routing_file(routing_data, ignore_programs=True)
         program_mapping = ProgramMapping([program], {
             fpga: program for fpga in set(fpga for (fpga, _) in connections.keys())
         })
-        ctx = create_routing_context(connections, program_mapping)
+        ctx = create_routing_context(connections, program_mapping, parse_communication(routing_json),
+                                     routing_json.get("fpgas", {}))
+        # the hops of the ports with known endpoints follow the routes, unless they are set explicitly
+        p2p_hops = p2p_port_hops(ctx.graph, ctx.fpgas, parse_port_endpoints(routing_json))
+        p2p_hops.update(parse_p2p_hops(routing_json))
+        program.set_p2p_hops(p2p_hops)
 
     fpgas = ctx.fpgas
     if fpgas:
-        write_file(device_src, generate_program_device(fpgas[0], fpgas, ctx.graph, CHANNELS_PER_FPGA))
+        sources = [os.path.abspath(dest) for (_, dest) in paths]
+        write_file(device_src, generate_program_device(fpgas[0], fpgas, ctx.graph, CHANNELS_PER_FPGA,
+                                                       native, sources))
 
     write_file(output_program, serialize_program(program))
 
@@ -104,27 +169,88 @@ def codegen_host(host_src, metadata):
     write_file(host_src, generate_program_host(programs))
 
 
+@click.command()
+@click.argument("routing_file")
+@click.argument("host-src")
+@click.argument("metadata", nargs=-1)
+def codegen_native_host(routing_file, host_src, metadata):
+    """
+    Creates host code for the native (CPU) backend.
+    The native device source of each program is expected in <metadata without extension>/smi_generated_device.cl.
+    :param routing_file: path to a file with FPGA connections and FPGA-to-program mapping
+    :param host_src: path to a file with generated host code
+    :param metadata: list of program metadata files
+    """
+    with open(routing_file) as rf:
+        data = rf.read()
+        (connections, mapping) = parse_routing_file(data, metadata)
+        program_names = json.loads(data)["fpgas"]
+        ctx = create_routing_context(connections, mapping, parse_communication(json.loads(data)), program_names)
+
+    device_sources = {}
+    for program in metadata:
+        basename = os.path.splitext(os.path.basename(program))[0]
+        device_sources[basename] = os.path.join(os.path.splitext(os.path.abspath(program))[0],
+                                                "smi_generated_device.cl")
+
+    write_file(host_src, generate_program_native_host(ctx.fpgas, program_names, device_sources))
+
+
 @click.command()
 @click.argument("routing_file")
 @click.argument("dest_dir")
 @click.argument("metadata", nargs=-1)
-def route(routing_file, dest_dir, metadata):
+@click.option("--multipath", default=False)
+@click.option("--datelines", default="OFF")
+def route(routing_file, dest_dir, metadata, multipath, datelines):
     """
     Creates routing tables and hostfile.
     :param routing_file: path to a file with FPGA connections and FPGA-to-program mapping
     :param dest_dir: path to a directory where routing tables and the hostfile will be generated
     :param metadata: list of program metadata files
+    :param multipath: whether to spread the traffic over all the equal-cost paths (ignored by the two-level
+    tables of the wide-rank mode)
+    :param datelines: whether to break the cyclic channel dependencies that may deadlock the network with datelines:
+    the messages that cross a dateline switch to the second virtual channel of the QSFP links (the programs must be
+    generated with --virtual-channels), or, with "links", no route may cross a dateline
     """
+    multipath = True if multipath in (True, 1, "1", "ON") else False
+    restrict_routes = datelines == "links"
+    datelines = True if datelines in (True, 1, "1", "ON", "links") else False
     prepare_directory(os.path.abspath(dest_dir))
 
     with open(routing_file) as rf:
-        (connections, mapping) = parse_routing_file(rf.read(), metadata)
-        ctx = create_routing_context(connections, mapping)
+        data = rf.read()
+        (connections, mapping) = parse_routing_file(data, metadata)
+        routing_json = json.loads(data)
+        ctx = create_routing_context(connections, mapping, parse_communication(routing_json),
+                                     routing_json.get("fpgas", {}))
+
+    wide_ranks = any(fpga.program.wide_ranks for fpga in ctx.fpgas)
+    graph = ctx.graph
+    links = []
+    if restrict_routes:
+        (graph, links) = place_datelines(ctx.graph, ctx.fpgas, lambda g: expand_cks_tables(
+            create_cks_tables(g, ctx.fpgas, wide_ranks, multipath), ctx.fpgas, wide_ranks))
+    cks_tables = create_cks_tables(graph, ctx.fpgas, wide_ranks, multipath)
+    if datelines and not restrict_routes:
+        if not all(fpga.program.virtual_channels for fpga in ctx.fpgas):
+            raise click.UsageError("Dateline virtual channels need programs generated with --virtual-channels "
+                                   "(or use --datelines links)")
+        (cks_tables, links) = place_virtual_channel_datelines(
+            graph, ctx.fpgas, cks_tables, lambda tables: expand_cks_tables(tables, ctx.fpgas, wide_ranks))
+    for (src, dst) in links:
+        click.echo("Dateline: {}:ch{} -> {}:ch{}".format(src.fpga.key(), src.index, dst.fpga.key(), dst.index))
+    if not datelines:
+        dependencies = channel_dependency_graph(graph, ctx.fpgas, expand_cks_tables(cks_tables, ctx.fpgas,
+                                                                                   wide_ranks))
+        if find_dependency_cycle(dependencies) is not None:
+            click.echo("Warning: the routes have cyclic channel dependencies and may deadlock under load, "
+                       "use --datelines to break them", err=True)
 
     for fpga in ctx.fpgas:
         for channel in fpga.channels:
-            cks_table = cks_routing_table(ctx.routes, ctx.fpgas, channel)
-            write_table(channel, "cks", cks_table, dest_dir)
+            write_table(channel, "cks", cks_tables[channel], dest_dir)
             ckr_table = ckr_routing_table(channel, CHANNELS_PER_FPGA, fpga.program)
             write_table(channel, "ckr", ckr_table, dest_dir)
 
@@ -132,6 +258,57 @@ def route(routing_file, dest_dir, metadata):
         write_nodefile(ctx.fpgas, f)
 
 
+@click.command()
+@click.argument("routing_file")
+@click.argument("routing_dir")
+@click.argument("metadata", nargs=-1)
+@click.option("--traffic", help="JSON file with a recorded traffic pattern")
+@click.option("--pattern", default="all-to-all", help="synthetic traffic pattern (all-to-all, neighbour, random)")
+@click.option("--packets", default=1000, help="packets sent by each synthetic flow")
+@click.option("--interval", default=1, help="cycles between two injected packets of a synthetic flow")
+@click.option("--consecutive-read-limit", default=8)
+@click.option("--link-latency", default=100)
+@click.option("--link-cycles-per-packet", default=2)
+@click.option("--max-cycles", default=10000000)
+@click.option("--output", help="path to a JSON file where the report is stored")
+def simulate(routing_file, routing_dir, metadata, traffic, pattern, packets, interval,
+             consecutive_read_limit, link_latency, link_cycles_per_packet, max_cycles, output):
+    """
+    Simulates the network with the routing tables generated by route and reports link utilisation,
+    latency and stall cycles. The arbiter and the control lane of CK_S/CK_R are read from the program metadata.
+    :param routing_file: path to a file with FPGA connections and FPGA-to-program mapping
+    :param routing_dir: path to the directory with the routing tables
+    :param metadata: list of program metadata files
+    :param traffic: path to a recorded traffic pattern; if not given a synthetic pattern is used
+    :param pattern: synthetic traffic pattern
+    :param packets: number of packets of each synthetic flow
+    :param interval: injection interval of synthetic flows
+    :param consecutive_read_limit: how many reads should be performed in succession from a single channel in CKR/CKS
+    :param link_latency: latency of a QSFP link in cycles
+    :param link_cycles_per_packet: cycles needed by a QSFP link to transmit a single packet
+    :param max_cycles: maximum number of simulated cycles
+    :param output: path to a JSON report
+    """
+    with open(routing_file) as rf:
+        data = rf.read()
+        (connections, mapping) = parse_routing_file(data, metadata)
+        routing_json = json.loads(data)
+        ctx = create_routing_context(connections, mapping, parse_communication(routing_json),
+                                     routing_json.get("fpgas", {}))
+
+    if traffic:
+        with open(traffic) as f:
+            flows = parse_traffic(f.read())
+    else:
+        flows = synthetic_traffic(ctx.fpgas, pattern, packets, interval)
+
+    report = simulate_network(ctx, load_routing_tables(ctx.fpgas, routing_dir), flows, consecutive_read_limit,
+                              link_latency, link_cycles_per_packet, max_cycles)
+    click.echo(format_report(report), nl=False)
+    if output:
+        write_file(output, json.dumps(report, indent=4))
+
+
 @click.group()
 def cli():
     pass
@@ -140,5 +317,7 @@ def cli():
 if __name__ == "__main__":
     cli.add_command(codegen_device)
     cli.add_command(codegen_host)
+    cli.add_command(codegen_native_host)
     cli.add_command(route)
+    cli.add_command(simulate)
     cli()
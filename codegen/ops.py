@@ -5,10 +5,18 @@ KEY_CKS_CONTROL = "cks_control"
 KEY_CKR_DATA = "ckr_data"
 KEY_CKR_CONTROL = "ckr_control"
 KEY_BROADCAST = "broadcast"
+KEY_BROADCAST_RECV = "broadcast_recv"
 KEY_REDUCE_SEND = "reduce_send"
 KEY_REDUCE_RECV = "reduce_recv"
+KEY_ALLREDUCE_SEND = "allreduce_send"
+KEY_ALLREDUCE_RECV = "allreduce_recv"
 KEY_SCATTER = "scatter"
 KEY_GATHER = "gather"
+KEY_GATHER_RECV = "gather_recv"
+KEY_ALLGATHER_SEND = "allgather_send"
+KEY_ALLGATHER_RECV = "allgather_recv"
+KEY_ALLTOALL = "alltoall"
+KEY_BURST = "burst"
 
 DATA_TYPE_SIZE = {
     "char":     1,
@@ -18,7 +26,15 @@ DATA_TYPE_SIZE = {
     "double":   8
 }
 
-PACKET_PAYLOAD_SIZE = 28
+# payload bytes of a network message for every supported message width in bits (see smi/network_message.h)
+PACKET_PAYLOAD_SIZES = {
+    256: 28,
+    512: 59
+}
+MESSAGE_WIDTH = 256
+PACKET_PAYLOAD_SIZE = PACKET_PAYLOAD_SIZES[MESSAGE_WIDTH]
+# the 16-bit source and destination ranks of the wide-rank mode take two more header bytes
+WIDE_RANKS_HEADER_OVERHEAD = 2
 
 
 class SmiOperation:
@@ -26,6 +42,10 @@ class SmiOperation:
         self.logical_port = logical_port
         self.data_type = data_type
         self.buffer_size = buffer_size or 16
+        self.message_width = MESSAGE_WIDTH
+        self.wide_ranks = False
+        # QSFP links on the path between the P2P endpoints of the port
+        self.p2p_hops = 1
 
     def get_channel(self, key: str) -> str:
         inv_map = {v: k for k, v in OP_MAPPING.items()}
@@ -46,10 +66,17 @@ class SmiOperation:
             "ckr_data": self.buffer_size,
             "ckr_control": self.buffer_size,
             "broadcast": 1,
+            "broadcast_recv": 1,
             "reduce_send": 1,
             "reduce_recv": 1,
+            "allreduce_send": 1,
+            "allreduce_recv": 1,
             "scatter": 1,
-            "gather": 1
+            "gather": 1,
+            "gather_recv": 1,
+            "allgather_send": 1,
+            "allgather_recv": 1,
+            "alltoall": 1
         }
         return mapping[channel]
 
@@ -58,11 +85,42 @@ class SmiOperation:
 
     def data_elements_per_packet(self):
         size = self.data_size()
-        return PACKET_PAYLOAD_SIZE // size
+        payload = PACKET_PAYLOAD_SIZES[self.message_width]
+        if self.wide_ranks:
+            payload -= WIDE_RANKS_HEADER_OVERHEAD
+        return payload // size
+
+    def burst_elements_per_packet(self):
+        """
+        Number of data elements carried by a (headerless) payload flit of a burst.
+        """
+        return self.message_width // 8 // self.data_size()
 
     def channel_usage(self, p2p_rendezvous: bool) -> Set[str]:
         return set()
 
+    def p2p_window(self) -> int:
+        """
+        Number of packets that a P2P sender can send before receiving tokens, i.e. the buffer of the receiver.
+        buffer_size covers the round trip of the tokens between neighbours, which grows linearly with the hops.
+        """
+        return self.buffer_size * max(1, self.p2p_hops)
+
+    def p2p_tokens_batch(self) -> int:
+        """
+        Number of data elements acknowledged by every tokens message of a rendezvous P2P receiver. The round trip of
+        the tokens takes 7/8 of buffer_size packets per hop: the rest of the window (1/8 of the buffer per hop) is
+        the batch, so the tokens of longer paths are coalesced in fewer messages.
+        """
+        return max(1, self.buffer_size * self.data_elements_per_packet() // 8) * max(1, self.p2p_hops)
+
+    def credits_batch(self) -> int:
+        """
+        Number of packets acknowledged by every credits message of the collectives that are flow-controlled
+        with credits (the receiver can buffer buffer_size packets).
+        """
+        return max(1, self.buffer_size // 2)
+
     def serialize_args(self):
         return {}
 
@@ -84,6 +142,12 @@ class Push(SmiOperation):
             return {KEY_CKS_DATA, KEY_CKR_CONTROL}
         return {KEY_CKS_DATA}
 
+    def get_burst_channel(self) -> str:
+        """
+        Channel that holds the payload flits of a burst until its header flit is sent to CK_S.
+        """
+        return "push_{}_{}".format(self.logical_port, KEY_BURST)
+
 
 class Pop(SmiOperation):
     def channel_usage(self, p2p_rendezvous: bool) -> Set[str]:
@@ -91,6 +155,11 @@ class Pop(SmiOperation):
             return {KEY_CKR_DATA, KEY_CKS_CONTROL}
         return {KEY_CKR_DATA}
 
+    def get_channel_depth(self, channel):
+        if channel == KEY_CKR_DATA:
+            return self.p2p_window()
+        return super().get_channel_depth(channel)
+
 
 class Broadcast(SmiOperation):
     def channel_usage(self, p2p_rendezvous: bool) -> Set[str]:
@@ -99,7 +168,8 @@ class Broadcast(SmiOperation):
             KEY_CKS_CONTROL,
             KEY_CKR_DATA,
             KEY_CKR_CONTROL,
-            KEY_BROADCAST
+            KEY_BROADCAST,
+            KEY_BROADCAST_RECV
         }
 
 
@@ -178,6 +248,20 @@ class Reduce(SmiOperation):
         return (*super()._signature(), self.op_type)
 
 
+class Allreduce(Reduce):
+    def channel_usage(self, p2p_rendezvous: bool) -> Set[str]:
+        # partial results go up and reduced elements go down the tree as data messages,
+        # the parents give credits to their children
+        return {
+            KEY_CKS_DATA,
+            KEY_CKS_CONTROL,
+            KEY_CKR_DATA,
+            KEY_CKR_CONTROL,
+            KEY_ALLREDUCE_SEND,
+            KEY_ALLREDUCE_RECV
+        }
+
+
 class Scatter(SmiOperation):
     def channel_usage(self, p2p_rendezvous: bool) -> Set[str]:
         return {
@@ -196,7 +280,31 @@ class Gather(SmiOperation):
             KEY_CKS_CONTROL,
             KEY_CKR_DATA,
             KEY_CKR_CONTROL,
-            KEY_GATHER
+            KEY_GATHER,
+            KEY_GATHER_RECV
+        }
+
+
+class Allgather(SmiOperation):
+    def channel_usage(self, p2p_rendezvous: bool) -> Set[str]:
+        return {
+            KEY_CKS_DATA,
+            KEY_CKS_CONTROL,
+            KEY_CKR_DATA,
+            KEY_CKR_CONTROL,
+            KEY_ALLGATHER_SEND,
+            KEY_ALLGATHER_RECV
+        }
+
+
+class Alltoall(SmiOperation):
+    def channel_usage(self, p2p_rendezvous: bool) -> Set[str]:
+        return {
+            KEY_CKS_DATA,
+            KEY_CKS_CONTROL,
+            KEY_CKR_DATA,
+            KEY_CKR_CONTROL,
+            KEY_ALLTOALL
         }
 
 
@@ -205,6 +313,9 @@ OP_MAPPING = {
     "pop": Pop,
     "broadcast": Broadcast,
     "reduce": Reduce,
+    "allreduce": Allreduce,
     "scatter": Scatter,
-    "gather": Gather
+    "gather": Gather,
+    "allgather": Allgather,
+    "alltoall": Alltoall
 }
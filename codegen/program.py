@@ -1,12 +1,28 @@
-from typing import List, Dict
+from typing import Callable, List, Dict
 
 from ops import SmiOperation, KEY_CKS_DATA, KEY_CKS_CONTROL, KEY_CKR_DATA, KEY_CKR_CONTROL, \
-    OP_MAPPING
+    OP_MAPPING, MESSAGE_WIDTH, PACKET_PAYLOAD_SIZES
 from utils import round_robin
 
 COST_INTER_FPGA = 100
 COST_INTRA_FPGA = 1
 CHANNELS_PER_FPGA = 4
+# default number of consecutive ranks that share an entry of the top-level CK_S routing table (wide-rank mode)
+RANK_GROUP_SIZE = 2
+
+# CK_S/CK_R arbitration policies
+# round-robin: polls a single input per cycle and moves to the next one after a miss
+# ready-mask: polls all the inputs every cycle and grants the next one that holds a message
+ARBITER_ROUND_ROBIN = "round-robin"
+ARBITER_READY_MASK = "ready-mask"
+ARBITERS = (ARBITER_ROUND_ROBIN, ARBITER_READY_MASK)
+
+# P2P transmission protocols
+# eager: the sender pushes the data without waiting for the receiver
+# rendezvous: the sender waits for credits (tokens) of the receiver, which has buffer space for the data in flight
+P2P_EAGER = "eager"
+P2P_RENDEZVOUS = "rendezvous"
+P2P_PROTOCOLS = (P2P_EAGER, P2P_RENDEZVOUS)
 
 
 class FailedAllocation(Exception):
@@ -50,7 +66,7 @@ def validate_allocations(channel_allocations):
             ports.add(op.logical_port)
 
 
-def allocate_channels(operations: List[SmiOperation], p2p_rendezvous: bool, count: int):
+def allocate_channels(operations: List[SmiOperation], p2p_rendezvous: Callable[[SmiOperation], bool], count: int):
     channel_allocations = {}
 
     for channel in range(count):
@@ -70,7 +86,7 @@ def allocate_channels(operations: List[SmiOperation], p2p_rendezvous: bool, coun
 
     for chan in required_channels:
         for op in operations:
-            usage = op.channel_usage(p2p_rendezvous)
+            usage = op.channel_usage(p2p_rendezvous(op))
             if chan in usage:
                 op_channels[chan.split("_")[0]].append((op, chan))
 
@@ -98,16 +114,74 @@ class Program:
                  consecutive_read_limit=8,
                  max_ranks=8,
                  p2p_rendezvous=True,
-                 channel_count=CHANNELS_PER_FPGA):
+                 channel_count=CHANNELS_PER_FPGA,
+                 arbiter=ARBITER_ROUND_ROBIN,
+                 control_lane=False,
+                 port_weights=None,
+                 message_width=MESSAGE_WIDTH,
+                 burst_length=0,
+                 wide_ranks=False,
+                 rank_group_size=RANK_GROUP_SIZE,
+                 p2p_protocols=None,
+                 p2p_hops=None,
+                 any_source_ports=None,
+                 virtual_channels=False):
+        assert arbiter in ARBITERS
+        assert message_width in PACKET_PAYLOAD_SIZES
+        # the number of payload flits is stored in the element count of the header flit
+        assert 0 <= burst_length < 32
+        # the rank group is selected with a shift and the rank inside the group with a mask
+        assert rank_group_size > 0 and rank_group_size & (rank_group_size - 1) == 0
 
         self.consecutive_read_limit = consecutive_read_limit
         self.max_ranks = max_ranks
         self.p2p_rendezvous = p2p_rendezvous
+        # logical port -> P2P protocol used by the port instead of the global one (p2p_rendezvous)
+        self.p2p_protocols = dict(p2p_protocols or {})
+        assert all(protocol in P2P_PROTOCOLS for protocol in self.p2p_protocols.values())
+        # logical ports whose receive channels accept data from any source (SMI_ANY_SOURCE)
+        self.any_source_ports = set(any_source_ports or ())
         self.operations = sorted(operations, key=lambda op: op.logical_port)
         self.channel_count = channel_count
+        self.arbiter = arbiter
+        # control messages (SMI_SYNCH) use dedicated CK_S/CK_R interconnects with strict priority
+        self.control_lane = control_lane
+        # two virtual channels per QSFP link with their own credits, the second one used after crossing a dateline.
+        # CK_S keeps a waiting message per virtual channel and reads a single input at a time, its inputs must not
+        # be bursts
+        self.virtual_channels = virtual_channels
+        assert not virtual_channels or (not control_lane and not burst_length and arbiter == ARBITER_ROUND_ROBIN)
+        # logical port -> maximum number of consecutive reads from the CK_S inputs of the port
+        self.port_weights = dict(port_weights or {})
+        # the weights and the counter of consecutive reads are chars in CK_S
+        assert all(0 < weight < 128 for weight in self.port_weights.values())
+        self.message_width = message_width
+        # 16-bit rank ids and two-level (rank group, rank) CK_S routing tables
+        self.wide_ranks = wide_ranks
+        self.rank_group_size = rank_group_size
+        for op in self.operations:
+            op.message_width = message_width
+            op.wide_ranks = wide_ranks
+        # logical port -> QSFP links between the P2P endpoints of the port, which size its window of tokens
+        self.p2p_hops = {}
+        self.set_p2p_hops(p2p_hops or {})
+        # number of headerless payload flits that follow the header flit of a P2P burst (0 disables bursts)
+        self.burst_length = burst_length
+        if burst_length:
+            for op in filter(self.is_p2p_rendezvous, self.get_burst_ops()):
+                # a Push waits for credits while it stages a burst: the receiver must be able to return them
+                # before the whole burst is delivered
+                assert burst_length * op.burst_elements_per_packet() <= \
+                    op.p2p_window() * op.data_elements_per_packet() - op.p2p_tokens_batch()
+                # the senders of an any-source port get back the tokens only after the burst has been sent
+                if self.is_any_source(op) and self.max_ranks:
+                    assert burst_length * op.burst_elements_per_packet() < self.get_any_source_tokens(op)
 
         self.logical_port_count = max((op.logical_port for op in operations), default=0) + 1
-        self.channel_allocations = allocate_channels(self.operations, p2p_rendezvous, channel_count)
+        # the credits of the virtual channels use the last logical port (SMI_VC_CREDITS_PORT)
+        assert not virtual_channels or self.logical_port_count <= 127
+
+        self.channel_allocations = allocate_channels(self.operations, self.is_p2p_rendezvous, channel_count)
         validate_allocations(self.channel_allocations)
 
     def get_channel_allocations(self, channel: int):
@@ -117,6 +191,71 @@ class Program:
         allocations = self.get_channel_allocations(channel)
         return tuple((op, key) for (op, key) in allocations if key.startswith(prefix))
 
+    def get_lane_allocations(self, channel: int, prefix: str, control: bool):
+        """
+        Returns the allocations of the given channel that belong to the control (or data) lane.
+        Without a control lane all the allocations belong to the data lane.
+        """
+        allocations = self.get_channel_allocations_with_prefix(channel, prefix)
+        if not self.control_lane:
+            return () if control else allocations
+        return tuple((op, key) for (op, key) in allocations if (key in (KEY_CKS_CONTROL, KEY_CKR_CONTROL)) == control)
+
+    def get_reads_limit(self, op: SmiOperation) -> str:
+        """
+        Returns the expression used as consecutive read limit for the CK_S inputs of the given operation.
+        """
+        weight = self.port_weights.get(op.logical_port)
+        return "READS_LIMIT" if weight is None else str(weight)
+
+    def set_p2p_hops(self, p2p_hops: Dict[int, int]):
+        """
+        Sets the hops between the P2P endpoints of the given logical ports. The other ports count a single hop:
+        a larger window (and CK_R buffer) is opt-in for the ports that need it.
+        """
+        assert all(hops > 0 for hops in p2p_hops.values())
+        self.p2p_hops.update(p2p_hops)
+        for op in self.operations:
+            op.p2p_hops = self.p2p_hops.get(op.logical_port, 1)
+
+    def is_p2p_rendezvous(self, op: SmiOperation) -> bool:
+        """
+        Returns whether the P2P operations of the logical port of the given operation use the rendezvous protocol.
+        """
+        protocol = self.p2p_protocols.get(op.logical_port)
+        if protocol is None:
+            return bool(self.p2p_rendezvous)
+        return protocol == P2P_RENDEZVOUS
+
+    def is_any_source(self, op: SmiOperation) -> bool:
+        """
+        Returns whether the receive channels of the logical port of the given operation accept data from any source.
+        """
+        return op.logical_port in self.any_source_ports
+
+    def get_any_source_tokens(self, op: SmiOperation) -> int:
+        """
+        Returns the tokens (data elements) of a sender of an any-source rendezvous port. The buffer of the receiver
+        is shared by all the other ranks, so that it never blocks its CK_R even if all of them send at the same time.
+        """
+        packets = max(op.p2p_window() // max(self.max_ranks - 1, 1), 1)
+        return packets * op.data_elements_per_packet()
+
+    def get_burst_ops(self) -> List[SmiOperation]:
+        """
+        Returns the operations that use burst framing (P2P operations, if bursts are enabled).
+        """
+        if not self.burst_length:
+            return []
+        return self.get_ops_by_type("push") + self.get_ops_by_type("pop")
+
+    def get_rank_group_count(self, ranks_count: int) -> int:
+        """
+        Returns the number of entries of the top-level CK_S routing table (wide-rank mode) for the given
+        number of ranks.
+        """
+        return (ranks_count + self.rank_group_size - 1) // self.rank_group_size
+
     def get_channel_for_port_key(self, logical_port: int, key: str):
         for (channel, allocations) in self.channel_allocations.items():
             for (op, ch) in allocations:
@@ -126,7 +265,7 @@ class Program:
 
     def get_ops_by_type(self, type: str) -> List[SmiOperation]:
         cls = OP_MAPPING[type]
-        return [op for op in self.operations if isinstance(op, cls)]
+        return [op for op in self.operations if op.__class__ == cls]
 
 
 class FPGA:
@@ -5,7 +5,7 @@ import subprocess
 
 import math
 
-from ops import SmiOperation
+from ops import SmiOperation, MESSAGE_WIDTH
 from serialization import parse_smi_operation
 
 
@@ -33,7 +33,7 @@ def transform_buffer_size(data, op: SmiOperation):
         op.buffer_size = math.ceil((max(1, op.buffer_size) / op.data_elements_per_packet()) / 8) * 8
 
 
-def rewrite(rewriter, file, include_dirs, log):
+def rewrite(rewriter, file, include_dirs, log, message_width=MESSAGE_WIDTH, wide_ranks=False):
     log.write("Rewriting {}".format(file))
 
     args = [rewriter, file]
@@ -51,6 +51,8 @@ def rewrite(rewriter, file, include_dirs, log):
         if line:
             data = json.loads(line)
             op = parse_smi_operation(data)
+            op.message_width = message_width
+            op.wide_ranks = wide_ranks
             transform_buffer_size(data, op)
             ops.append(op)
 
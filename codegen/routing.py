@@ -1,10 +1,11 @@
-from typing import List, Tuple, Dict
+from typing import Callable, List, Tuple, Dict
 
 import networkx
 from networkx import Graph
 
 from common import RoutingContext
-from program import COST_INTRA_FPGA, COST_INTER_FPGA, FPGA, ProgramMapping
+from program import COST_INTRA_FPGA, COST_INTER_FPGA, Channel, FPGA, ProgramMapping
+from routing_table import CKS_TARGET_CKR, CKS_TARGET_QSFP, CKS_TARGET_QSFP_DATELINE, NoRouteFound, mark_datelines
 
 """
 Each CK_R/CK_S separate QSFP
@@ -15,12 +16,21 @@ fpga-0014:acl0:ch0 - fpga-0014:acl1:ch0
 """
 
 
-def create_routing_context(fpga_connections: Dict[Tuple[str, int], Tuple[str, int]], program_mapping: ProgramMapping):
+def create_routing_context(fpga_connections: Dict[Tuple[str, int], Tuple[str, int]], program_mapping: ProgramMapping,
+                           communication: List[Tuple[int, int, int]] = None, fpga_programs: Dict[str, str] = None):
+    """
+    :param communication: optional communication graph, list of (rank, rank, weight); if given the ranks are placed
+    on the FPGAs so that the ranks that communicate are close to each other
+    :param fpga_programs: mapping from FPGA key to the name of its program; ranks are only moved between FPGAs
+    with the same program
+    """
     graph = networkx.Graph()
     fpgas = load_inter_fpga_connections(graph, fpga_connections, program_mapping)
     add_intra_fpga_connections(graph, fpgas)
     routes = shortest_paths(graph)
     fpgas = create_ranks_for_fpgas(fpgas)
+    if communication:
+        fpgas = place_ranks(graph, fpgas, communication, fpga_programs or {})
     return RoutingContext(graph, routes, fpgas)
 
 
@@ -58,6 +68,10 @@ def shortest_paths(graph):
     return networkx.shortest_path(graph, source=None, target=None, weight="weight")
 
 
+def shortest_path_lengths(graph):
+    return dict(networkx.shortest_path_length(graph, weight="weight"))
+
+
 def create_ranks_for_fpgas(fpgas: List[FPGA]) -> List[FPGA]:
     """
     Enumerates all channels and assigns ranks to individual FPGAs, sorted by their (node, fpga)
@@ -67,3 +81,234 @@ def create_ranks_for_fpgas(fpgas: List[FPGA]) -> List[FPGA]:
     for (rank, fpga) in enumerate(fpgas):
         fpga.rank = rank
     return fpgas
+
+
+def fpga_hops(graph: Graph, fpgas: List[FPGA]) -> Dict[FPGA, Dict[FPGA, int]]:
+    """
+    Returns the number of QSFP links on the shortest path between every pair of connected FPGAs (following the
+    direction of the links if the graph is directed).
+    """
+    fpga_graph = networkx.DiGraph() if graph.is_directed() else networkx.Graph()
+    fpga_graph.add_nodes_from(fpgas)
+    for (a, b) in graph.edges:
+        if a.fpga is not b.fpga:
+            fpga_graph.add_edge(a.fpga, b.fpga)
+    return dict(networkx.shortest_path_length(fpga_graph))
+
+
+def p2p_port_hops(graph: Graph, fpgas: List[FPGA], endpoints: Dict[int, List[Tuple[int, int]]]) -> Dict[int, int]:
+    """
+    Returns the hops of the given logical ports: the largest number of QSFP links on the routes between the
+    P2P endpoints (pairs of ranks) of the port. An inter-FPGA link costs more than any path inside an FPGA, so the
+    routes of the CK_S tables cross the fewest QSFP links.
+    """
+    hops = fpga_hops(graph, fpgas)
+    port_hops = {}
+    for (port, pairs) in endpoints.items():
+        distances = [hops[fpgas[src]][fpgas[dst]] for (src, dst) in pairs
+                     if src < len(fpgas) and dst < len(fpgas) and fpgas[dst] in hops[fpgas[src]]]
+        port_hops[port] = max(distances + [1])
+    return port_hops
+
+
+def placement_cost(hops: Dict[FPGA, Dict[FPGA, int]], placement: List[FPGA],
+                   communication: List[Tuple[int, int, int]]) -> int:
+    """
+    Returns the weighted hop count of the communication graph with the given placement (rank -> FPGA).
+    Pairs of disconnected FPGAs count as len(placement) hops.
+    """
+    cost = 0
+    for (src, dst, weight) in communication:
+        cost += weight * hops[placement[src]].get(placement[dst], len(placement))
+    return cost
+
+
+def place_ranks(graph: Graph, fpgas: List[FPGA], communication: List[Tuple[int, int, int]],
+                fpga_programs: Dict[str, str]) -> List[FPGA]:
+    """
+    Reassigns the ranks of the given FPGAs (sorted by rank) to minimise the weighted hop count of the communication
+    graph. Starting from the default placement, pairs of ranks that run the same program are swapped as long as the
+    cost decreases, so the result is deterministic.
+    Returns the FPGAs sorted by their new rank.
+    """
+    hops = fpga_hops(graph, fpgas)
+    count = len(fpgas)
+
+    peers = [{} for _ in range(count)]
+    for (src, dst, weight) in communication:
+        if src != dst and src < count and dst < count:
+            peers[src][dst] = peers[src].get(dst, 0) + weight
+            peers[dst][src] = peers[dst].get(src, 0) + weight
+
+    placement = list(fpgas)
+
+    def rank_cost(rank: int) -> int:
+        fpga = placement[rank]
+        return sum(weight * hops[fpga].get(placement[peer], count) for (peer, weight) in peers[rank].items())
+
+    improved = True
+    while improved:
+        improved = False
+        for a in range(count):
+            for b in range(a + 1, count):
+                if fpga_programs.get(placement[a].key()) != fpga_programs.get(placement[b].key()):
+                    continue
+                if not peers[a] and not peers[b]:
+                    continue
+                before = rank_cost(a) + rank_cost(b)
+                placement[a], placement[b] = placement[b], placement[a]
+                if rank_cost(a) + rank_cost(b) < before:
+                    improved = True
+                else:
+                    placement[a], placement[b] = placement[b], placement[a]
+
+    for (rank, fpga) in enumerate(placement):
+        fpga.rank = rank
+    return placement
+
+
+def cks_next_hop(graph: Graph, channel: Channel, target: int) -> Tuple[tuple, Channel]:
+    """
+    Returns the buffer used by the CK_S of the given channel to forward a message to the given output
+    (CKS_TARGET_QSFP, CKS_TARGET_QSFP_DATELINE or a neighbour CK_S) and the channel whose CK_S reads the message next.
+    """
+    if target in (CKS_TARGET_QSFP, CKS_TARGET_QSFP_DATELINE):
+        remote = [n for n in graph.neighbors(channel) if n.fpga != channel.fpga]
+        if not remote:
+            raise NoRouteFound("No link connected to {}".format(channel))
+        # the remote CK_R forwards the message to the CK_S of its channel
+        return ("qsfp", channel), remote[0]
+    neighbour = channel.fpga.channels[list(channel.neighbours())[target - 2]]
+    return ("cks", channel, neighbour), neighbour
+
+
+def channel_dependency_graph(graph: Graph, fpgas: List[FPGA], tables: Dict[Channel, List[int]]) -> networkx.DiGraph:
+    """
+    Builds the channel dependency graph of the given CK_S tables (one output per destination rank).
+    The nodes are the buffers that hold messages in transit, together with their virtual channel (0, or 1 after
+    crossing a dateline): ("qsfp", channel, vc) is the QSFP link of a channel together with the CK_R -> CK_S
+    interconnect of the remote channel, ("cks", a, b, vc) is the interconnect between the CK_S of two channels of
+    the same FPGA. An edge (a, b) means that a message in a waits for space in b.
+    Delivered messages leave the network, so the routing cannot deadlock if the graph is acyclic.
+    """
+    dependencies = networkx.DiGraph()
+    for (channel, table) in tables.items():
+        for fpga in fpgas:
+            # the messages are injected by the CK_S of the channel on the first virtual channel
+            (current, target, vc, previous) = (channel, table[fpga.rank], 0, None)
+            for _ in range(len(tables)):
+                if target == CKS_TARGET_CKR:
+                    break
+                if target == CKS_TARGET_QSFP_DATELINE:
+                    vc = 1
+                (buffer, current) = cks_next_hop(graph, current, target)
+                buffer += (vc,)
+                dependencies.add_node(buffer)
+                if previous is not None:
+                    dependencies.add_edge(previous, buffer)
+                (target, previous) = (tables[current][fpga.rank], buffer)
+            else:
+                raise NoRouteFound("Routing loop from {} to {}".format(channel, fpga))
+    return dependencies
+
+
+def find_dependency_cycle(dependencies: networkx.DiGraph):
+    """
+    Returns the buffers of a cycle of the channel dependency graph or None if the graph is acyclic.
+    """
+    try:
+        return [a for (a, _) in networkx.find_cycle(dependencies)]
+    except networkx.NetworkXNoCycle:
+        return None
+
+
+def place_virtual_channel_datelines(graph: Graph, fpgas: List[FPGA], tables: Dict[Channel, List[int]],
+                                    expand: Callable[[Dict[Channel, List[int]]], Dict[Channel, List[int]]] = None) \
+        -> Tuple[Dict[Channel, List[int]], List[Tuple[Channel, Channel]]]:
+    """
+    Breaks the cyclic channel dependencies of the given CK_S tables with dateline virtual channels: the routes are
+    kept, but the messages that cross a dateline (a direction of a QSFP link) continue on the second virtual
+    channel, whose buffers are separate from those of the first one.
+    While the dependency graph has a cycle, the first QSFP link of the cycle (in rank order) that is used on the
+    first virtual channel becomes a dateline. A ring needs one dateline for each direction. Cycles among the
+    buffers of the second virtual channel cannot be broken (the shortest paths of rings never cross a dateline
+    twice).
+    expand converts the tables into one output per destination rank (e.g. for two-level tables).
+    Returns the tables with the datelines (CKS_TARGET_QSFP_DATELINE) and the list of datelines (source, destination).
+    """
+    expand = expand or (lambda t: t)
+    datelines = []
+    while True:
+        cycle = find_dependency_cycle(channel_dependency_graph(graph, fpgas, expand(tables)))
+        if cycle is None:
+            return tables, [(channel, cks_next_hop(graph, channel, CKS_TARGET_QSFP)[1]) for channel in datelines]
+
+        links = [buffer[1] for buffer in cycle if buffer[0] == "qsfp" and buffer[-1] == 0]
+        if not links:
+            raise NoRouteFound("Cannot break the channel dependency cycle {} with two virtual channels".format(cycle))
+        datelines.append(min(links, key=lambda channel: (channel.fpga.rank, channel.index)))
+        tables = mark_datelines(tables, datelines)
+
+
+def place_datelines(graph: Graph, fpgas: List[FPGA],
+                    create_tables: Callable[[Graph], Dict[Channel, List[int]]],
+                    directed=True) -> Tuple[Graph, List[Tuple[Channel, Channel]]]:
+    """
+    Breaks the cyclic channel dependencies of the routes created by create_tables (graph -> CK_S table with one
+    output per rank for every channel) without virtual channels, by restricting the routes.
+    While the dependency graph has a cycle, one of its QSFP links becomes a dateline in the direction used by the
+    cycle: no route may cross it in that direction. Among the links of the cycle, the one whose removal keeps every
+    FPGA reachable and increases the hop count between the FPGAs the least is removed from a directed copy of the
+    graph and the routes are created again. A ring needs one dateline for each direction.
+    If no directed link of a cycle can be removed, the placement starts again with undirected datelines, which
+    succeeds at the latest when the remaining links form a tree (shortest paths on a tree never turn back, so their
+    dependencies are acyclic).
+    Returns the directed graph without the datelines and the list of datelines (source, destination).
+    """
+    routing_graph = graph.to_directed()
+    datelines = []
+    tables = create_tables(routing_graph)
+    while True:
+        cycle = find_dependency_cycle(channel_dependency_graph(routing_graph, fpgas, tables))
+        if cycle is None:
+            return routing_graph, datelines
+
+        def remove(link):
+            routing_graph.remove_edge(*link)
+            if not directed:
+                routing_graph.remove_edge(link[1], link[0])
+
+        def restore(link):
+            routing_graph.add_edge(*link, **graph[link[0]][link[1]])
+            if not directed:
+                routing_graph.add_edge(link[1], link[0], **graph[link[0]][link[1]])
+
+        def cost(link):
+            remove(link)
+            hops = fpga_hops(routing_graph, fpgas)
+            restore(link)
+            if any(len(distances) < len(fpgas) for distances in hops.values()):
+                return None
+            # on ties, keep the opposite direction of the link in use
+            idle = not routing_graph.has_edge(link[1], link[0])
+            return sum(sum(distances.values()) for distances in hops.values()), idle, link[0].fpga.rank, link[0].index
+
+        links = [(buffer[1], cks_next_hop(routing_graph, buffer[1], CKS_TARGET_QSFP)[1])
+                 for buffer in cycle if buffer[0] == "qsfp"]
+        dateline = None
+        for (_, link) in sorted((c, link) for (c, link) in ((cost(link), link) for link in links) if c is not None):
+            remove(link)
+            try:
+                tables = create_tables(routing_graph)
+                dateline = link
+                break
+            except NoRouteFound:
+                restore(link)
+
+        if dateline is None:
+            if directed:
+                return place_datelines(graph, fpgas, create_tables, False)
+            raise NoRouteFound("Cannot break the channel dependency cycle {}".format(cycle))
+        datelines.append(dateline)
+        if not directed:
+            datelines.append((dateline[1], dateline[0]))
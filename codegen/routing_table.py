@@ -1,12 +1,18 @@
-from typing import List
+from typing import Dict, List
 
 import bitstring
+import networkx
+from networkx import Graph
 
 from ops import KEY_CKR_DATA, KEY_CKR_CONTROL
 from program import Channel, FPGA, Program
 
 CKS_TARGET_QSFP = 0
 CKS_TARGET_CKR = 1
+# local QSFP whose link is a dateline: the messages continue on the second virtual channel
+CKS_TARGET_QSFP_DATELINE = 64
+# top-level entry of the group of the local rank in a two-level CK_S table (read as -1 by CK_S)
+CKS_TARGET_LOCAL_GROUP = 255
 
 
 class NoRouteFound(BaseException):
@@ -51,6 +57,174 @@ def cks_routing_table(paths, fpgas: List[FPGA], channel: Channel) -> List[int]:
     return table
 
 
+def fpga_distance(distances, channel: Channel, target: FPGA) -> int:
+    costs = [cost for (destination, cost) in distances[channel].items() if destination.fpga == target]
+    if not costs:
+        raise NoRouteFound("No route found from {} to {}".format(channel, target))
+    return min(costs)
+
+
+def get_equal_cost_output_targets(graph: Graph, distances, channel: Channel, target: FPGA) -> List[int]:
+    """
+    Returns all the outputs of the CK_S of the given channel that lie on a minimum cost path to the target
+    (same numbering as get_output_target).
+    Every hop strictly decreases the distance to the target, so any combination of choices is loop-free.
+    """
+    if target == channel.fpga:
+        return [CKS_TARGET_CKR]
+
+    distance = fpga_distance(distances, channel, target)
+    targets = []
+    for neighbour in graph.neighbors(channel):
+        cost = graph[channel][neighbour]["weight"]
+        if cost + fpga_distance(distances, neighbour, target) == distance:
+            if neighbour.fpga == channel.fpga:
+                targets.append(2 + channel.target_index(neighbour.index))
+            else:
+                targets.append(CKS_TARGET_QSFP)
+    return sorted(targets)
+
+
+def cks_multipath_routing_table(graph: Graph, distances, fpgas: List[FPGA], channel: Channel) -> List[int]:
+    """
+    Creates a CK_S routing table that spreads the traffic over equal-cost paths (ECMP).
+    The path is selected by the channel and by the destination rank, so that the logical ports (which are
+    distributed among the channels) and the destinations use different parallel links.
+    distances contains the cost between every pair of channels (see routing.shortest_path_lengths), it is
+    computed once for all the tables.
+    """
+    table = []
+    for fpga in fpgas:
+        targets = get_equal_cost_output_targets(graph, distances, channel, fpga)
+        table.append(targets[(channel.index + fpga.rank) % len(targets)])
+    return table
+
+
+def group_distances(distances, channel: Channel, group_size: int) -> Dict[int, int]:
+    """
+    Returns the cost of the closest channel of every rank group reachable from the given channel.
+    """
+    costs = {}
+    for (destination, cost) in distances[channel].items():
+        group = destination.fpga.rank // group_size
+        costs[group] = min(cost, costs.get(group, cost))
+    return costs
+
+
+def get_output_target_to_group(graph: Graph, group_costs, channel: Channel, group: int) -> int:
+    """
+    Returns the output of the CK_S of the given channel that lies on a minimum cost path to the closest FPGA of
+    the given rank group (same numbering as get_output_target).
+    Every hop strictly decreases the distance to the group, so the group is always reached.
+    """
+    distance = group_costs[channel].get(group)
+    if distance is None:
+        raise NoRouteFound("No route found from {} to rank group {}".format(channel, group))
+
+    targets = []
+    for neighbour in graph.neighbors(channel):
+        cost = graph[channel][neighbour]["weight"]
+        if cost + group_costs[neighbour][group] == distance:
+            if neighbour.fpga == channel.fpga:
+                targets.append(2 + channel.target_index(neighbour.index))
+            else:
+                targets.append(CKS_TARGET_QSFP)
+    return min(targets)
+
+
+def cks_two_level_routing_tables(graph: Graph, fpgas: List[FPGA], group_size: int) -> Dict[Channel, List[int]]:
+    """
+    Creates the two-level CK_S routing tables used in wide-rank mode: every table contains one entry for every
+    group of group_size consecutive ranks, followed by one entry for every rank of the group of the channel.
+    Messages for a remote group are routed towards its closest FPGA, then inside the group. Paths inside a group
+    avoid the other groups whenever the group is connected by itself.
+    """
+    distances = dict(networkx.shortest_path_length(graph, weight="weight"))
+    group_costs = {channel: group_distances(distances, channel, group_size) for channel in graph.nodes}
+    group_count = (len(fpgas) + group_size - 1) // group_size
+
+    tables = {}
+    for local_group in range(group_count):
+        members = fpgas[local_group * group_size:(local_group + 1) * group_size]
+        subgraph = graph.subgraph(c for fpga in members for c in fpga.channels)
+        local_distances = dict(networkx.shortest_path_length(subgraph, weight="weight"))
+
+        for fpga in members:
+            for channel in fpga.channels:
+                table = []
+                for group in range(group_count):
+                    if group == local_group:
+                        table.append(CKS_TARGET_LOCAL_GROUP)
+                    else:
+                        table.append(get_output_target_to_group(graph, group_costs, channel, group))
+
+                for target in members:
+                    try:
+                        targets = get_equal_cost_output_targets(subgraph, local_distances, channel, target)
+                    except NoRouteFound:
+                        targets = get_equal_cost_output_targets(graph, distances, channel, target)
+                    table.append(targets[0])
+                # the last group may be incomplete
+                table += [CKS_TARGET_CKR] * (group_size - len(members))
+                tables[channel] = table
+
+    validate_cks_routes(graph, fpgas, {channel: expand_two_level_table(table, len(fpgas), group_size)
+                                       for (channel, table) in tables.items()})
+    return tables
+
+
+def mark_datelines(tables: Dict[Channel, List[int]], datelines: List[Channel]) -> Dict[Channel, List[int]]:
+    """
+    Returns the CK_S tables in which the messages sent to the QSFP of the given channels (whose links are
+    datelines) switch to the second virtual channel.
+    """
+    return {channel: [CKS_TARGET_QSFP_DATELINE if channel in datelines and target == CKS_TARGET_QSFP else target
+                      for target in table] for (channel, table) in tables.items()}
+
+
+def expand_two_level_table(table: List[int], ranks_count: int, group_size: int) -> List[int]:
+    """
+    Returns the CK_S output of every destination rank described by a two-level CK_S table.
+    """
+    group_count = (ranks_count + group_size - 1) // group_size
+    targets = []
+    for rank in range(ranks_count):
+        target = table[rank // group_size]
+        if target == CKS_TARGET_LOCAL_GROUP:
+            target = table[group_count + rank % group_size]
+        targets.append(target)
+    return targets
+
+
+def validate_cks_routes(graph: Graph, fpgas: List[FPGA], tables: Dict[Channel, List[int]]):
+    """
+    Follows the CK_S tables (one output per destination rank) from every channel to every rank and raises
+    NoRouteFound if a message would loop or leave through a missing link.
+    """
+    for start in tables:
+        for fpga in fpgas:
+            channel = start
+            visited = set()
+            while True:
+                if channel in visited:
+                    raise NoRouteFound("Routing loop from {} to {}".format(start, fpga))
+                visited.add(channel)
+
+                target = tables[channel][fpga.rank]
+                if target == CKS_TARGET_CKR:
+                    if channel.fpga != fpga:
+                        raise NoRouteFound("No route found from {} to {}".format(start, fpga))
+                    break
+                elif target in (CKS_TARGET_QSFP, CKS_TARGET_QSFP_DATELINE):
+                    remote = [n for n in graph.neighbors(channel) if n.fpga != channel.fpga]
+                    if not remote:
+                        raise NoRouteFound("No route found from {} to {}".format(start, fpga))
+                    # the remote CK_R forwards the message to the CK_S of its channel
+                    channel = remote[0]
+                else:
+                    channel = channel.fpga.channels[list(channel.neighbours())[target - 2]]
+
+
 def get_input_target(channel: Channel, logical_port: int, program: Program,
                      channels_per_fpga: int, key) -> int:
     """
@@ -1,18 +1,21 @@
 import json
 import re
 import os
-from typing import List, Tuple, Dict
+from typing import List, Tuple, Dict, Set
 
-from ops import Broadcast, Push, Pop, Reduce, Scatter, Gather
-from program import Program, SmiOperation, ProgramMapping
+from ops import Allgather, Allreduce, Alltoall, Broadcast, Push, Pop, Reduce, Scatter, Gather, MESSAGE_WIDTH
+from program import Program, SmiOperation, ProgramMapping, RANK_GROUP_SIZE, ARBITER_ROUND_ROBIN
 
 SMI_OP_KEYS = {
     "push": Push,
     "pop": Pop,
     "broadcast": Broadcast,
     "reduce": Reduce,
+    "allreduce": Allreduce,
     "scatter": Scatter,
-    "gather": Gather
+    "gather": Gather,
+    "allgather": Allgather,
+    "alltoall": Alltoall
 }
 
 
@@ -49,16 +52,91 @@ def parse_program(input: str) -> Program:
         parse_operations(prog["operations"]),
         prog.get("consecutive_reads"),
         prog.get("max_ranks"),
-        """prog.get("p2p_rendezvous") TODO: fix"""
+        """prog.get("p2p_rendezvous") TODO: fix""",
+        arbiter=prog.get("arbiter", ARBITER_ROUND_ROBIN),
+        control_lane=prog.get("control_lane", False),
+        port_weights=parse_port_weights(prog),
+        message_width=prog.get("message_width", MESSAGE_WIDTH),
+        burst_length=prog.get("burst_length", 0),
+        wide_ranks=prog.get("wide_ranks", False),
+        rank_group_size=prog.get("rank_group_size", RANK_GROUP_SIZE),
+        p2p_protocols=parse_p2p_protocols(prog),
+        p2p_hops=parse_p2p_hops(prog),
+        any_source_ports=parse_any_source_ports(prog),
+        virtual_channels=prog.get("virtual_channels", False)
     )
 
 
 def serialize_program(program: Program) -> str:
     return json.dumps({
-        "operations": [serialize_smi_operation(op) for op in program.operations]
+        "operations": [serialize_smi_operation(op) for op in program.operations],
+        "arbiter": program.arbiter,
+        "control_lane": program.control_lane,
+        "port_weights": program.port_weights,
+        "message_width": program.message_width,
+        "burst_length": program.burst_length,
+        "wide_ranks": program.wide_ranks,
+        "rank_group_size": program.rank_group_size,
+        "p2p_protocols": program.p2p_protocols,
+        "p2p_hops": program.p2p_hops,
+        "any_source_ports": sorted(program.any_source_ports),
+        "virtual_channels": program.virtual_channels
     })
 
 
+def parse_port_weights(data) -> Dict[int, int]:
+    """
+    Parses the optional per-logical port weights ({"port_weights": {"<port>": <weight>}}) used by CK_S
+    instead of the global consecutive read limit.
+    """
+    return {int(port): int(weight) for (port, weight) in data.get("port_weights", {}).items()}
+
+
+def parse_p2p_protocols(data) -> Dict[int, str]:
+    """
+    Parses the optional per-logical port P2P protocols ({"p2p_protocols": {"<port>": "eager" | "rendezvous"}})
+    used instead of the global one.
+    """
+    return {int(port): protocol for (port, protocol) in data.get("p2p_protocols", {}).items()}
+
+
+def parse_p2p_hops(data) -> Dict[int, int]:
+    """
+    Parses the optional per-logical port hop counts ({"p2p_hops": {"<port>": <hops>}}) between the P2P endpoints
+    of the port, which size the window of tokens.
+    """
+    return {int(port): int(hops) for (port, hops) in data.get("p2p_hops", {}).items()}
+
+
+def parse_any_source_ports(data) -> Set[int]:
+    """
+    Parses the optional logical ports ({"any_source_ports": [<port>, ...]}) whose receive channels accept data
+    from any source (SMI_ANY_SOURCE).
+    """
+    return set(int(port) for port in data.get("any_source_ports", []))
+
+
+def parse_communication(data) -> List[Tuple[int, int, int]]:
+    """
+    Parses the optional communication graph ({"communication": [{"src": <rank>, "dst": <rank>, "weight": <weight>}]})
+    used to place the ranks on the FPGAs. The weight (e.g. the number of exchanged messages) defaults to 1.
+    """
+    return [(int(edge["src"]), int(edge["dst"]), int(edge.get("weight", 1)))
+            for edge in data.get("communication", [])]
+
+
+def parse_port_endpoints(data) -> Dict[int, List[Tuple[int, int]]]:
+    """
+    Parses the logical ports of the communication graph ({"communication": [{"src": <rank>, "dst": <rank>,
+    "port": <port>}]}): logical port -> list of (src rank, dst rank) pairs of its P2P endpoints.
+    """
+    endpoints = {}
+    for edge in data.get("communication", []):
+        if "port" in edge:
+            endpoints.setdefault(int(edge["port"]), []).append((int(edge["src"]), int(edge["dst"])))
+    return endpoints
+
+
 def parse_routing_file(data: str, metadata_paths=None, ignore_programs=False) -> Tuple[Dict[Tuple[str, int], Tuple[str, int]], ProgramMapping]:
     if metadata_paths is None:
         metadata_paths = []
@@ -0,0 +1,510 @@
+"""
+Cycle-approximate model of the SMI network.
+
+Every CK_S/CK_R is modelled as a kernel that executes one loop iteration per cycle (II=1), using the
+same round-robin polling and READS_LIMIT policy of the generated code (templates/cks.cl, templates/ckr.cl).
+A blocking write to a full channel stalls the whole kernel. Channels are bounded FIFOs with the depth
+declared in the generated device code and data written in a cycle becomes visible in the next one.
+QSFP links transmit one packet every `link_cycles_per_packet` cycles with a fixed latency.
+
+Routing decisions are taken from the routing tables written by `main.py route`.
+With a control lane, control packets travel on dedicated interconnects that every kernel polls before
+the data inputs; the QSFP links remain shared by both lanes. Dateline virtual channels are not modelled: the
+datelines are ordinary QSFP outputs.
+"""
+
+import json
+import os
+import random
+from collections import deque
+from typing import Dict, List, Tuple
+
+from common import RoutingContext
+from ops import KEY_CKS_DATA, KEY_CKS_CONTROL, KEY_CKR_DATA
+from program import Channel, FPGA, ARBITER_READY_MASK, ARBITER_ROUND_ROBIN
+from routing_table import CKS_TARGET_QSFP, CKS_TARGET_QSFP_DATELINE, expand_two_level_table
+
+
+INTERCONNECT_DEPTH = 16
+QSFP_DEPTH = 16
+
+
+class Fifo:
+    def __init__(self, name: str, depth: int):
+        self.name = name
+        self.depth = max(depth, 1)
+        self.items = deque()
+
+    def full(self) -> bool:
+        return len(self.items) >= self.depth
+
+    def can_pop(self, cycle: int) -> bool:
+        return bool(self.items) and self.items[0][0] <= cycle
+
+    def push(self, packet: "Packet", cycle: int):
+        assert not self.full()
+        self.items.append((cycle + 1, packet))
+
+    def pop(self) -> "Packet":
+        return self.items.popleft()[1]
+
+    def __repr__(self):
+        return "Fifo({})".format(self.name)
+
+
+class Packet:
+    __slots__ = ("flow", "src", "dst", "port", "control", "injected")
+
+    def __init__(self, flow: "Flow", injected: int):
+        self.flow = flow
+        self.src = flow.src
+        self.dst = flow.dst
+        self.port = flow.port
+        self.control = flow.control
+        self.injected = injected
+
+
+class Flow:
+    """
+    A stream of packets sent from a logical port of a rank to the same logical port of another rank.
+    """
+    def __init__(self, src: int, dst: int, port: int, packets: int, start=0, interval=1, control=False):
+        self.src = src
+        self.dst = dst
+        self.port = port
+        self.packets = packets
+        self.start = start
+        self.interval = max(interval, 1)
+        self.control = control
+
+        self.injected = 0
+        self.delivered = 0
+        self.next_injection = start
+        self.injection_stalls = 0
+
+    def finished_injection(self) -> bool:
+        return self.injected == self.packets
+
+    def __repr__(self):
+        return "Flow({}->{}, port {}, {} packets)".format(self.src, self.dst, self.port, self.packets)
+
+
+class CkKernel:
+    """
+    Arbiter shared by CK_S and CK_R.
+    With the round-robin arbiter it polls one input per cycle and moves to the next one if the input is empty
+    or after `reads_limit` consecutive reads.
+    With the ready-mask arbiter it checks all the inputs every cycle and grants the closest ready one when
+    the current input is empty or after `reads_limit` consecutive reads.
+    Control lane inputs (if any) are polled round-robin before the data inputs and have strict priority.
+    Inputs listed in `input_limits` use their own consecutive read limit (weight of the logical port).
+    """
+    def __init__(self, name: str, reads_limit: int, arbiter=ARBITER_ROUND_ROBIN):
+        self.name = name
+        self.reads_limit = reads_limit
+        self.arbiter = arbiter
+        self.inputs: List[Fifo] = []
+        self.input_limits: Dict[int, int] = {}
+        self.control_inputs: List[Fifo] = []
+        self.control_sender_id = 0
+        self.sender_id = 0
+        self.contiguous_reads = 0
+        self.pending = None
+
+        self.forwarded = 0
+        self.stall_cycles = 0
+
+    def route(self, packet: Packet) -> Fifo:
+        raise NotImplementedError()
+
+    def step(self, cycle: int):
+        if self.pending is not None:
+            if self.pending[1].full():
+                self.stall_cycles += 1
+                return
+            self.pending[1].push(self.pending[0], cycle)
+            self.pending = None
+            return
+
+        if self.control_inputs:
+            source = self.control_inputs[self.control_sender_id]
+            self.control_sender_id = (self.control_sender_id + 1) % len(self.control_inputs)
+            if source.can_pop(cycle):
+                self.forward(source.pop(), cycle)
+                return
+
+        if self.arbiter == ARBITER_READY_MASK:
+            self.grant(cycle)
+
+        source = self.inputs[self.sender_id]
+        valid = source.can_pop(cycle)
+        if valid:
+            self.contiguous_reads += 1
+            self.forward(source.pop(), cycle)
+
+        if self.arbiter == ARBITER_ROUND_ROBIN and (not valid or self.contiguous_reads == self.current_limit()):
+            self.contiguous_reads = 0
+            self.sender_id = (self.sender_id + 1) % len(self.inputs)
+
+    def current_limit(self) -> int:
+        return self.input_limits.get(self.sender_id, self.reads_limit)
+
+    def forward(self, packet: Packet, cycle: int):
+        self.forwarded += 1
+        target = self.route(packet)
+        if target.full():
+            self.pending = (packet, target)
+            self.stall_cycles += 1
+        else:
+            target.push(packet, cycle)
+
+    def lane(self, packet: Packet) -> List[Fifo]:
+        return self.control_outputs if packet.control and self.control_outputs else self.outputs
+
+    def grant(self, cycle: int):
+        if not self.inputs[self.sender_id].can_pop(cycle) or self.contiguous_reads == self.current_limit():
+            self.contiguous_reads = 0
+            for i in range(1, len(self.inputs)):
+                candidate = (self.sender_id + i) % len(self.inputs)
+                if self.inputs[candidate].can_pop(cycle):
+                    self.sender_id = candidate
+                    break
+
+
+class CkS(CkKernel):
+    def __init__(self, channel: Channel, table: List[int], reads_limit: int, arbiter: str):
+        super().__init__("CK_S rank {} channel {}".format(channel.fpga.rank, channel.index), reads_limit, arbiter)
+        self.channel = channel
+        self.table = table
+        self.outputs: List[Fifo] = []
+        self.control_outputs: List[Fifo] = []
+
+    def route(self, packet: Packet) -> Fifo:
+        return self.lane(packet)[self.table[packet.dst]]
+
+
+class CkR(CkKernel):
+    def __init__(self, channel: Channel, table: List[int], reads_limit: int, arbiter: str):
+        super().__init__("CK_R rank {} channel {}".format(channel.fpga.rank, channel.index), reads_limit, arbiter)
+        self.channel = channel
+        self.table = table
+        self.outputs: List[Fifo] = []
+        self.control_outputs: List[Fifo] = []
+
+    def route(self, packet: Packet) -> Fifo:
+        outputs = self.lane(packet)
+        if packet.dst != self.channel.fpga.rank:
+            return outputs[0]
+        return outputs[self.table[packet.port * 2 + int(packet.control)]]
+
+
+class Link:
+    """
+    Unidirectional QSFP connection between two channels.
+    """
+    def __init__(self, src: Channel, dst: Channel, output: Fifo, input: Fifo, latency: int,
+                 cycles_per_packet: int):
+        self.src = src
+        self.dst = dst
+        self.output = output
+        self.input = input
+        self.latency = latency
+        self.cycles_per_packet = max(cycles_per_packet, 1)
+        self.in_flight = deque()
+        self.next_send = 0
+
+        self.packets = 0
+        self.stall_cycles = 0
+
+    def step(self, cycle: int):
+        if self.in_flight and self.in_flight[0][0] <= cycle:
+            if self.input.full():
+                self.stall_cycles += 1
+            else:
+                self.input.push(self.in_flight.popleft()[1], cycle)
+
+        if cycle >= self.next_send and self.output.can_pop(cycle):
+            self.in_flight.append((cycle + self.latency, self.output.pop()))
+            self.next_send = cycle + self.cycles_per_packet
+            self.packets += 1
+
+    def name(self) -> str:
+        return "rank {} channel {} -> rank {} channel {}".format(self.src.fpga.rank, self.src.index,
+                                                                self.dst.fpga.rank, self.dst.index)
+
+
+def load_routing_tables(fpgas: List[FPGA], routing_dir: str) -> Dict[Tuple[str, Channel], List[int]]:
+    """
+    Loads the CK_S/CK_R routing tables written by `main.py route`.
+    """
+    tables = {}
+    for fpga in fpgas:
+        for channel in fpga.channels:
+            for prefix in ("cks", "ckr"):
+                filename = "{}-rank{}-channel{}".format(prefix, fpga.rank, channel.index)
+                with open(os.path.join(routing_dir, filename), "rb") as f:
+                    tables[(prefix, channel)] = list(f.read())
+            tables[("cks", channel)] = [CKS_TARGET_QSFP if target == CKS_TARGET_QSFP_DATELINE else target
+                                        for target in tables[("cks", channel)]]
+            if fpga.program.wide_ranks:
+                tables[("cks", channel)] = expand_two_level_table(tables[("cks", channel)], len(fpgas),
+                                                                  fpga.program.rank_group_size)
+    return tables
+
+
+def parse_traffic(data: str) -> List[Flow]:
+    """
+    Parses a recorded traffic pattern, e.g.
+    {"flows": [{"src": 0, "dst": 1, "port": 0, "packets": 1000, "start": 0, "interval": 1}]}
+    """
+    flows = []
+    for flow in json.loads(data)["flows"]:
+        flows.append(Flow(flow["src"], flow["dst"], flow["port"], flow["packets"],
+                          flow.get("start", 0), flow.get("interval", 1), flow.get("control", False)))
+    return flows
+
+
+def synthetic_traffic(fpgas: List[FPGA], pattern: str, packets: int, interval=1, seed=0) -> List[Flow]:
+    """
+    Creates a synthetic traffic pattern between all the (rank, logical port) pairs that are able to
+    exchange data, i.e. the source program sends and the destination program receives on the same port.
+    Supported patterns: all-to-all, neighbour (rank i sends to rank i + 1) and random (every rank sends to
+    a single random destination).
+    """
+    fpgas = sorted(fpgas, key=lambda f: f.rank)
+    rng = random.Random(seed)
+
+    def ports(src: FPGA, dst: FPGA):
+        return [op.logical_port for op in src.program.operations
+                if src.program.get_channel_for_port_key(op.logical_port, KEY_CKS_DATA) is not None and
+                dst.program.get_channel_for_port_key(op.logical_port, KEY_CKR_DATA) is not None]
+
+    pairs = []
+    for src in fpgas:
+        others = [dst for dst in fpgas if dst is not src]
+        if not others:
+            continue
+        if pattern == "all-to-all":
+            pairs += [(src, dst) for dst in others]
+        elif pattern == "neighbour":
+            pairs.append((src, fpgas[(src.rank + 1) % len(fpgas)]))
+        elif pattern == "random":
+            pairs.append((src, rng.choice(others)))
+        else:
+            raise ValueError("Unknown traffic pattern {}".format(pattern))
+
+    flows = []
+    used = set()
+    for (src, dst) in pairs:
+        # a logical port can be used only by a single stream at a time
+        for port in ports(src, dst):
+            if (src.rank, port) not in used and (dst.rank, port) not in used:
+                used.add((src.rank, port))
+                used.add((dst.rank, port))
+                flows.append(Flow(src.rank, dst.rank, port, packets, interval=interval))
+                break
+    return flows
+
+
+class Network:
+    def __init__(self, ctx: RoutingContext, tables, reads_limit: int, link_latency: int,
+                 link_cycles_per_packet: int):
+        self.fpgas = sorted(ctx.fpgas, key=lambda f: f.rank)
+        self.kernels: List[CkKernel] = []
+        self.links: List[Link] = []
+        self.sources: Dict[Tuple[int, int, str], Fifo] = {}
+        self.sinks: Dict[Fifo, Tuple[int, int]] = {}
+
+        io_out = {}
+        io_in = {}
+        cks = {}
+        ckr = {}
+        for fpga in self.fpgas:
+            program = fpga.program
+            channel_count = len(fpga.channels)
+            # CK_S/CK_R as generated for the program of the FPGA
+            (arbiter, control_lane) = (program.arbiter, program.control_lane)
+
+            def interconnect(kind, a, b):
+                return Fifo("{} rank {} {}->{}".format(kind, fpga.rank, a, b), INTERCONNECT_DEPTH)
+
+            cks_links = {(a.index, b.index): interconnect("cks", a.index, b.index)
+                         for a in fpga.channels for b in fpga.channels if a is not b}
+            ckr_links = {(a.index, b.index): interconnect("ckr", a.index, b.index)
+                         for a in fpga.channels for b in fpga.channels if a is not b}
+            cks_to_ckr = [interconnect("cks_to_ckr", c, c) for c in range(channel_count)]
+            ckr_to_cks = [interconnect("ckr_to_cks", c, c) for c in range(channel_count)]
+            if control_lane:
+                cks_control = {(a.index, b.index): interconnect("cks_control", a.index, b.index)
+                               for a in fpga.channels for b in fpga.channels if a is not b}
+                ckr_control = {(a.index, b.index): interconnect("ckr_control", a.index, b.index)
+                               for a in fpga.channels for b in fpga.channels if a is not b}
+                cks_to_ckr_control = [interconnect("cks_to_ckr_control", c, c) for c in range(channel_count)]
+                ckr_to_cks_control = [interconnect("ckr_to_cks_control", c, c) for c in range(channel_count)]
+
+            for channel in fpga.channels:
+                index = channel.index
+                io_out[channel] = Fifo("io_out {}".format(channel), QSFP_DEPTH)
+                io_in[channel] = Fifo("io_in {}".format(channel), QSFP_DEPTH)
+
+                sender = CkS(channel, tables[("cks", channel)], reads_limit, arbiter)
+                sender.inputs = [cks_links[(n, index)] for n in channel.neighbours()] + [ckr_to_cks[index]]
+                sender.outputs = [io_out[channel], cks_to_ckr[index]] + \
+                                 [cks_links[(index, n)] for n in channel.neighbours()]
+                if control_lane:
+                    sender.control_inputs = [cks_control[(n, index)] for n in channel.neighbours()] + \
+                                            [ckr_to_cks_control[index]]
+                    sender.control_outputs = [io_out[channel], cks_to_ckr_control[index]] + \
+                                             [cks_control[(index, n)] for n in channel.neighbours()]
+                for (op, key) in program.get_channel_allocations_with_prefix(index, "cks"):
+                    fifo = Fifo("{} {} rank {}".format(op, key, fpga.rank), op.get_channel_depth(key))
+                    self.sources[(fpga.rank, op.logical_port, key)] = fifo
+                    if control_lane and key == KEY_CKS_CONTROL:
+                        sender.control_inputs.append(fifo)
+                    else:
+                        if op.logical_port in program.port_weights:
+                            sender.input_limits[len(sender.inputs)] = program.port_weights[op.logical_port]
+                        sender.inputs.append(fifo)
+
+                receiver = CkR(channel, tables[("ckr", channel)], reads_limit, arbiter)
+                receiver.inputs = [io_in[channel]] + [ckr_links[(n, index)] for n in channel.neighbours()] + \
+                                  [cks_to_ckr[index]]
+                receiver.outputs = [ckr_to_cks[index]] + [ckr_links[(index, n)] for n in channel.neighbours()]
+                if control_lane:
+                    receiver.control_inputs = [ckr_control[(n, index)] for n in channel.neighbours()] + \
+                                              [cks_to_ckr_control[index]]
+                    receiver.control_outputs = [ckr_to_cks_control[index]] + \
+                                               [ckr_control[(index, n)] for n in channel.neighbours()]
+                for (op, key) in program.get_channel_allocations_with_prefix(index, "ckr"):
+                    fifo = Fifo("{} {} rank {}".format(op, key, fpga.rank), op.get_channel_depth(key))
+                    self.sinks[fifo] = (fpga.rank, op.logical_port)
+                    receiver.outputs.append(fifo)
+                    if control_lane:
+                        receiver.control_outputs.append(fifo)
+
+                cks[channel] = sender
+                ckr[channel] = receiver
+                self.kernels += [sender, receiver]
+
+        for (a, b) in ctx.graph.edges():
+            if a.fpga is not b.fpga:
+                for (src, dst) in ((a, b), (b, a)):
+                    self.links.append(Link(src, dst, io_out[src], io_in[dst], link_latency,
+                                           link_cycles_per_packet))
+
+    def source_for(self, flow: Flow) -> Fifo:
+        key = (flow.src, flow.port, KEY_CKS_CONTROL if flow.control else KEY_CKS_DATA)
+        if key not in self.sources:
+            raise ValueError("Rank {} cannot send on port {}".format(flow.src, flow.port))
+        return self.sources[key]
+
+
+def percentile(values: List[int], p: float) -> int:
+    index = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[index]
+
+
+def simulate(ctx: RoutingContext, tables, flows: List[Flow], reads_limit=8, link_latency=100,
+             link_cycles_per_packet=2, max_cycles=10000000):
+    """
+    Simulates the given flows until all the packets are delivered (or max_cycles is reached) and returns
+    a report with link utilisation, latency distribution for every (rank, logical port) and stall cycles.
+    The arbiter and the control lane of every CK_S/CK_R are those of the program of its FPGA.
+    """
+    network = Network(ctx, tables, reads_limit, link_latency, link_cycles_per_packet)
+    sources = [(flow, network.source_for(flow)) for flow in flows]
+    latencies: Dict[Tuple[int, int], List[int]] = {}
+    misrouted = 0
+    in_network = 0
+    total = sum(flow.packets for flow in flows)
+    delivered = 0
+
+    cycle = 0
+    while delivered + misrouted < total and cycle < max_cycles:
+        # all channels are empty, skip to the next injection
+        if in_network == 0 and not all(flow.finished_injection() for flow in flows):
+            cycle = max(cycle, min(flow.next_injection for flow in flows if not flow.finished_injection()))
+
+        for (sink, (rank, port)) in network.sinks.items():
+            if sink.can_pop(cycle):
+                packet = sink.pop()
+                in_network -= 1
+                if packet.dst != rank or packet.port != port:
+                    misrouted += 1
+                    continue
+                packet.flow.delivered += 1
+                delivered += 1
+                latencies.setdefault((rank, port), []).append(cycle - packet.injected)
+
+        for link in network.links:
+            link.step(cycle)
+        for kernel in network.kernels:
+            kernel.step(cycle)
+
+        for (flow, source) in sources:
+            if not flow.finished_injection() and cycle >= flow.next_injection:
+                if source.full():
+                    flow.injection_stalls += 1
+                else:
+                    source.push(Packet(flow, cycle), cycle)
+                    flow.injected += 1
+                    flow.next_injection = cycle + flow.interval
+                    in_network += 1
+        cycle += 1
+
+    return {
+        "cycles": cycle,
+        "delivered": delivered,
+        "misrouted": misrouted,
+        "undelivered": total - delivered - misrouted,
+        "links": [{
+            "link": link.name(),
+            "packets": link.packets,
+            "utilisation": link.packets * link.cycles_per_packet / max(cycle, 1),
+            "stall_cycles": link.stall_cycles
+        } for link in network.links],
+        "latency": [{
+            "rank": rank,
+            "port": port,
+            "packets": len(values),
+            "min": min(values),
+            "mean": sum(values) / len(values),
+            "p50": percentile(values, 50),
+            "p99": percentile(values, 99),
+            "max": max(values)
+        } for ((rank, port), values) in sorted((k, sorted(v)) for (k, v) in latencies.items())],
+        "stalls": [{
+            "kernel": kernel.name,
+            "forwarded": kernel.forwarded,
+            "stall_cycles": kernel.stall_cycles
+        } for kernel in network.kernels if kernel.forwarded > 0],
+        "flows": [{
+            "flow": repr(flow),
+            "delivered": flow.delivered,
+            "injection_stalls": flow.injection_stalls
+        } for flow in flows]
+    }
+
+
+def format_report(report) -> str:
+    lines = ["Simulated cycles: {}".format(report["cycles"]),
+             "Delivered packets: {}, misrouted: {}, undelivered: {}".format(
+                 report["delivered"], report["misrouted"], report["undelivered"]),
+             "", "Link utilisation:"]
+    for link in report["links"]:
+        if link["packets"] > 0:
+            lines.append("  {}: {} packets, {:.1%} utilisation, {} stall cycles".format(
+                link["link"], link["packets"], link["utilisation"], link["stall_cycles"]))
+    lines += ["", "Latency (cycles):"]
+    for latency in report["latency"]:
+        lines.append("  rank {} port {}: {} packets, min {}, mean {:.1f}, p50 {}, p99 {}, max {}".format(
+            latency["rank"], latency["port"], latency["packets"], latency["min"], latency["mean"],
+            latency["p50"], latency["p99"], latency["max"]))
+    lines += ["", "Stalls:"]
+    for stall in report["stalls"]:
+        lines.append("  {}: {} packets, {} stall cycles".format(
+            stall["kernel"], stall["forwarded"], stall["stall_cycles"]))
+    for flow in report["flows"]:
+        if flow["injection_stalls"] > 0:
+            lines.append("  {}: {} injection stall cycles".format(flow["flow"], flow["injection_stalls"]))
+    return "\n".join(lines) + "\n"
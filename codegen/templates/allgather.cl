@@ -0,0 +1,185 @@
+{% import 'utils.cl' as utils %}
+
+{%- macro smi_allgather_kernel(program, op) -%}
+__kernel void smi_kernel_allgather_{{ op.logical_port }}(SMI_Rank num_rank)
+{
+    // the contributions travel along the ring of the ranks: every rank forwards to the next one the contributions
+    // received from the previous one, after inserting its own one in its turn. Every rank therefore receives the
+    // contributions ordered by contributing rank (own contribution excluded) and the support kernels send data only
+    // to their neighbour, so there is no hotspot on CKS.
+    // The network is flow-controlled with credits, one per packet: the data in flight never exceeds the buffer
+    // of the CKR channel of the next rank, which would otherwise block any other message through its CKR
+    __constant int WINDOW = {{ op.buffer_size }};
+    __constant int CREDITS_BATCH = {{ op.credits_batch() }};
+    __constant int ELEMS_PER_PACKET = {{ op.data_elements_per_packet() }};
+    SMI_Network_message mess;
+    SMI_Network_message credits_mess;
+    bool configured = false;
+    SMI_Rank my_rank = 0;
+    SMI_Rank next = 0;
+    SMI_Rank contributor = 0;
+    int packets_per_contribution = 0;
+    int packet_id = 0;
+    int credits = WINDOW;       // packets that can be sent to the next rank
+    int received_packets = 0;   // packets received from the previous rank since the last credits
+
+    while (true)
+    {
+        if (!configured)
+        {
+            // the first message of every allgather contains the rank of the caller and the number
+            // of elements of every contribution
+            mess = read_channel_intel({{ op.get_channel("allgather_send") }});
+            my_rank = GET_HEADER_SRC(mess.header);
+            next = my_rank == num_rank - 1 ? 0 : my_rank + 1;
+            const int count = *(int *) mess.data;
+            packets_per_contribution = (count + ELEMS_PER_PACKET - 1) / ELEMS_PER_PACKET;
+            contributor = 0;
+            packet_id = 0;
+            configured = true;
+
+            SET_HEADER_OP(credits_mess.header, SMI_SYNCH);
+            SET_HEADER_PORT(credits_mess.header, {{ op.logical_port }});
+            SET_HEADER_SRC(credits_mess.header, my_rank);
+            SET_HEADER_DST(credits_mess.header, my_rank == 0 ? num_rank - 1 : my_rank - 1);
+        }
+        else
+        {
+            const bool own = contributor == my_rank;
+            if (own)
+            {
+                mess = read_channel_intel({{ op.get_channel("allgather_send") }});
+            }
+            else
+            {
+                mess = read_channel_intel({{ op.get_channel("ckr_data") }});
+                received_packets++;
+                if (received_packets == CREDITS_BATCH)
+                {
+                    write_channel_intel({{ op.get_channel("cks_control") }}, credits_mess);
+                    received_packets = 0;
+                }
+            }
+
+            // the contribution of the next rank has already gone around the ring
+            if (contributor != next)
+            {
+                if (credits == 0)
+                {
+                    SMI_Network_message req = read_channel_intel({{ op.get_channel("ckr_control") }});
+                    credits = CREDITS_BATCH;
+                }
+                SET_HEADER_DST(mess.header, next);
+                SET_HEADER_OP(mess.header, SMI_GATHER);
+                write_channel_intel({{ op.get_channel("cks_data") }}, mess);
+                credits--;
+            }
+            if (!own)
+            {
+                write_channel_intel({{ op.get_channel("allgather_recv") }}, mess);
+            }
+
+            packet_id++;
+            if (packet_id == packets_per_contribution)
+            {
+                packet_id = 0;
+                contributor++;
+                if (contributor == num_rank)
+                {
+                    configured = false;
+                }
+            }
+        }
+    }
+}
+{%- endmacro %}
+
+{%- macro smi_allgather_impl(program, op) -%}
+/**
+ * @brief SMI_Allgather
+ * @param chan pointer to the allgather channel descriptor
+ * @param data_snd pointer to the data element that must be sent (significant during the turn of the caller only)
+ * @param data_rcv pointer to the receiving data element
+ */
+void {{ utils.impl_name_port_type("SMI_Allgather", op) }}(SMI_AllgatherChannel* chan, void* send_data, void* rcv_data)
+{
+    if (chan->init)
+    {
+        // configure the support kernel for this allgather
+        SET_HEADER_OP(chan->net.header, SMI_SYNCH);
+        *(int *) chan->net.data = chan->send_count;
+        write_channel_intel({{ op.get_channel("allgather_send") }}, chan->net);
+        SET_HEADER_OP(chan->net.header, SMI_GATHER);
+        chan->init = false;
+    }
+
+    if (chan->next_contrib == chan->my_rank) // my turn: send the data and keep a copy of it
+    {
+        char* conv = (char*) send_data;
+        #pragma unroll
+        for (int jj = 0; jj < {{ op.data_size() }}; jj++)
+        {
+            ((char *)rcv_data)[jj] = conv[jj];
+        }
+{{ utils.pack(op, "chan->net.data", "chan->packet_element_id", "conv", op.data_elements_per_packet())|indent(4, first=True) }}
+        chan->packet_element_id++;
+        chan->processed_elements++;
+
+        if (chan->packet_element_id == chan->elements_per_packet || chan->processed_elements == chan->send_count)
+        {
+            SET_HEADER_NUM_ELEMS(chan->net.header, chan->packet_element_id);
+            write_channel_intel({{ op.get_channel("allgather_send") }}, chan->net);
+            chan->packet_element_id = 0;
+        }
+    }
+    else
+    {
+        if (chan->packet_element_id_rcv == 0)
+        {
+            chan->net_2 = read_channel_intel({{ op.get_channel("allgather_recv") }});
+        }
+{{ utils.unpack(op, "chan->net_2.data", "chan->packet_element_id_rcv", "rcv_data", op.data_elements_per_packet())|indent(4, first=True) }}
+        chan->packet_element_id_rcv++;
+        chan->processed_elements++;
+        if (chan->packet_element_id_rcv == chan->elements_per_packet)
+        {
+            chan->packet_element_id_rcv = 0;
+        }
+    }
+
+    if (chan->processed_elements == chan->send_count)
+    {
+        // we finished the data of this contributor, go to the next one
+        chan->processed_elements = 0;
+        chan->packet_element_id_rcv = 0;
+        chan->next_contrib++;
+    }
+}
+{%- endmacro %}
+
+{%- macro smi_allgather_channel(program, op) -%}
+SMI_AllgatherChannel {{ utils.impl_name_port_type("SMI_Open_allgather_channel", op) }}(int send_count, int recv_count, SMI_Datatype data_type, int port, SMI_Comm comm)
+{
+    SMI_AllgatherChannel chan;
+    chan.port = (char) port;
+    chan.send_count = send_count;
+    chan.recv_count = recv_count;
+    chan.data_type = data_type;
+    chan.my_rank = (SMI_Rank) SMI_Comm_rank(comm);
+    chan.num_rank = (SMI_Rank) SMI_Comm_size(comm);
+    chan.next_contrib = 0;
+    chan.size_of_type = {{ op.data_size() }};
+    chan.elements_per_packet = {{ op.data_elements_per_packet() }};
+    chan.init = true;
+
+    // setup header for the message
+    SET_HEADER_SRC(chan.net.header, chan.my_rank);
+    SET_HEADER_PORT(chan.net.header, chan.port);
+    SET_HEADER_NUM_ELEMS(chan.net.header, 0);
+    SET_HEADER_OP(chan.net.header, SMI_SYNCH);
+    chan.processed_elements = 0;
+    chan.packet_element_id = 0;
+    chan.packet_element_id_rcv = 0;
+    return chan;
+}
+{%- endmacro -%}
@@ -0,0 +1,314 @@
+{% import 'utils.cl' as utils %}
+
+{%- macro smi_allreduce_kernel(program, op) -%}
+#include "smi/reduce_operations.h"
+
+__kernel void smi_kernel_allreduce_{{ op.logical_port }}(SMI_Rank num_rank)
+{
+    __constant int SHIFT_REG = {{ op.shift_reg() }};
+
+    // the ranks form a tree rooted at rank 0 with `fanout` children per rank (fanout 0: all the other ranks are
+    // children of rank 0). Every rank combines its contribution with the partial results of its children and
+    // forwards the result to its parent, then the reduced element goes back along the same tree.
+    // As in the reduce, a parent gives credits to its children: up to credits_flow_control elements are in flight
+    // on every rank, each one in its own element of the buffer, and a credit is given back for every element
+    // forwarded to the parent (or sent back, by rank 0)
+    SMI_Network_message mess;
+    SMI_Network_message reduce;
+    SMI_Network_message result;
+    char sender_id = 0;
+    const char credits_flow_control = 16; // choose it in order to have II=1
+    // reduced results, organized in shift registers to mask latency (of the design, not related to the particular operation used)
+    {{ op.data_type }} __attribute__((register)) reduce_result[credits_flow_control][SHIFT_REG + 1];
+    SMI_Rank data_recvd[credits_flow_control];  // contributions received for every element of the buffer
+    bool send_credits = false; // true if we have to send credits to the children
+    char credits = 0; // the number of credits that we still have to send to every child
+    SMI_Rank send_to = 0;   // next child to which send the credit
+    char add_to[MAX_RANKS];   // for each rank tells to what element in the buffer we should add the received partial result
+    unsigned int sent_credits = 0;    //number of sent credits so far
+    unsigned int parent_credits = 0;  //credits received from the parent
+    unsigned int message_size = 0;
+    unsigned int own_elems = 0;         // contributions received from the application
+    unsigned int reduced_elems = 0;     // elements forwarded to the parent (or sent back, by rank 0)
+    bool active = false;                // an allreduce is in progress
+    bool has_result = false;    // the reduced element has to be delivered to the application and to the children
+    bool delivered = false;
+    SMI_Rank my_rank = 0;
+    SMI_Rank parent = 0;
+    int first_child = 0;
+    SMI_Rank num_children = 0;
+    SMI_Rank child = 0;         // next child to send the reduced element to
+
+    for (int i = 0; i < credits_flow_control; i++)
+    {
+        data_recvd[i] = 0;
+        #pragma unroll
+        for(int j = 0; j < SHIFT_REG + 1; j++)
+        {
+            reduce_result[i][j] = {{ op.shift_reg_init() }};
+        }
+    }
+
+    for (int i = 0; i < MAX_RANKS; i++)
+    {
+        add_to[i] = 0;
+    }
+    char current_buffer_element = 0;
+    char add_to_own = 0;
+    char contiguos_reads = 0;
+
+    while (true)
+    {
+        bool completed = false;
+        if (has_result)
+        {
+            if (!delivered)
+            {
+                write_channel_intel({{ op.get_channel("allreduce_recv") }}, result);
+                delivered = true;
+            }
+            else if (child < num_children)
+            {
+                SET_HEADER_OP(result.header, SMI_BROADCAST);
+                SET_HEADER_NUM_ELEMS(result.header, 1);
+                SET_HEADER_PORT(result.header, {{ op.logical_port }});
+                SET_HEADER_SRC(result.header, my_rank);
+                SET_HEADER_DST(result.header, first_child + child);
+                write_channel_intel({{ op.get_channel("cks_data") }}, result);
+                child++;
+            }
+            else
+            {
+                has_result = false;
+            }
+        }
+        else if (send_credits)
+        {
+            // send a credit to every child
+            SET_HEADER_OP(reduce.header, SMI_SYNCH);
+            SET_HEADER_NUM_ELEMS(reduce.header, 1);
+            SET_HEADER_PORT(reduce.header, {{ op.logical_port }});
+            SET_HEADER_DST(reduce.header, first_child + send_to);
+            write_channel_intel({{ op.get_channel("cks_control") }}, reduce);
+            send_to++;
+            if (send_to == num_children)
+            {
+                send_to = 0;
+                credits--;
+                send_credits = credits != 0;
+                sent_credits++;
+            }
+        }
+        else if (active && data_recvd[current_buffer_element] == num_children + 1 && (my_rank == 0 || parent_credits != 0))
+        {
+            // We received all the contributions for this element: rank 0 sends the reduced element back,
+            // the other ranks forward the partial result to their parent
+            {{ op.data_type }} res = {{ op.shift_reg_init() }};
+            #pragma unroll
+            for (int i = 0; i < SHIFT_REG; i++)
+            {
+                res = {{ op.reduce_op() }}(res, reduce_result[current_buffer_element][i]);
+            }
+            if (my_rank == 0)
+            {
+                *({{ op.data_type }}*) (result.data) = res;
+                has_result = true;
+                delivered = false;
+                child = 0;
+            }
+            else
+            {
+                *({{ op.data_type }}*) (reduce.data) = res;
+                SET_HEADER_OP(reduce.header, SMI_REDUCE);
+                SET_HEADER_NUM_ELEMS(reduce.header, 1);
+                SET_HEADER_PORT(reduce.header, {{ op.logical_port }});
+                SET_HEADER_SRC(reduce.header, my_rank);
+                SET_HEADER_DST(reduce.header, parent);
+                write_channel_intel({{ op.get_channel("cks_data") }}, reduce);
+                parent_credits--;
+            }
+            completed = true;
+        }
+        else
+        {
+            bool valid = false;
+            switch (sender_id)
+            {
+                case 0: // contribution of the application, if there is a free element in the buffer
+                    if (!active || (own_elems != message_size && own_elems - reduced_elems < credits_flow_control))
+                    {
+                        mess = read_channel_nb_intel({{ op.get_channel("allreduce_send") }}, &valid);
+                    }
+                    break;
+                case 1: // partial results of the children or reduced elements from the parent
+                    mess = read_channel_nb_intel({{ op.get_channel("ckr_data") }}, &valid);
+                    break;
+                case 2: // credits from the parent
+                    mess = read_channel_nb_intel({{ op.get_channel("ckr_control") }}, &valid);
+                    break;
+            }
+            if (valid)
+            {
+                if (sender_id == 1 && GET_HEADER_OP(mess.header) == SMI_BROADCAST)
+                {
+                    // reduced elements arrive in order: deliver and forward them
+                    contiguos_reads++;
+                    result = mess;
+                    has_result = true;
+                    delivered = false;
+                    child = 0;
+                }
+                else if (sender_id == 2)
+                {
+                    parent_credits++;
+                }
+                else
+                {
+                    char addto;
+                    if (sender_id == 0)
+                    {
+                        if (GET_HEADER_OP(mess.header) == SMI_SYNCH) // first element of a new allreduce
+                        {
+                            // the application indicates the shape of the tree and the length of the message
+                            // by exploiting the data buffer, since data elements are not packed
+                            my_rank = GET_HEADER_SRC(mess.header);
+                            const int fanout = *(short *) (&(mess.data[SMI_PACKET_PAYLOAD_SIZE - 6]));
+                            const int children = fanout == 0 ? num_rank - 1 : fanout;
+                            first_child = my_rank * children + 1;
+                            num_children = (SMI_Rank) MIN(MAX(num_rank - first_child, 0), children);
+                            parent = my_rank == 0 ? 0 : (my_rank - 1) / children;
+                            message_size = *(unsigned int *) (&(mess.data[SMI_PACKET_PAYLOAD_SIZE - 4]));
+                            own_elems = 0;
+                            reduced_elems = 0;
+                            sent_credits = 0;
+                            send_to = 0;
+                            credits = MIN((unsigned int) credits_flow_control, message_size);
+                            send_credits = num_children != 0;
+                            current_buffer_element = 0;
+                            add_to_own = 0;
+                            for (int i = 0; i < MAX_RANKS; i++)
+                            {
+                                add_to[i] = 0;
+                            }
+                            active = true;
+                        }
+                        own_elems++;
+                        addto = add_to_own;
+                        add_to_own = add_to_own == credits_flow_control - 1 ? 0 : add_to_own + 1;
+                    }
+                    else
+                    {
+                        // partial result of a child
+                        contiguos_reads++;
+                        SMI_Rank rank = GET_HEADER_SRC(mess.header);
+                        addto = add_to[rank];
+                        add_to[rank] = addto == credits_flow_control - 1 ? 0 : addto + 1;
+                    }
+                    data_recvd[addto]++;
+                    // apply reduce
+                    {{ op.data_type }} data = *({{ op.data_type }}*) (mess.data);
+                    reduce_result[addto][SHIFT_REG] = {{ op.reduce_op() }}(data, reduce_result[addto][0]);
+                    #pragma unroll
+                    for (int j = 0; j < SHIFT_REG; j++)
+                    {
+                        reduce_result[addto][j] = reduce_result[addto][j + 1];
+                    }
+                }
+            }
+            // keep reading from the tree until the limit, then move to the next sender
+            if (sender_id != 1 || !valid || contiguos_reads == READS_LIMIT)
+            {
+                sender_id = sender_id == 2 ? 0 : sender_id + 1;
+                contiguos_reads = 0;
+            }
+        }
+
+        if (completed)
+        {
+            // the contribution in this element of the buffer has been reduced
+            reduced_elems++;
+            active = reduced_elems != message_size;
+            if (num_children != 0 && sent_credits < message_size)
+            {
+                // send additional tokens if there are other elements to reduce
+                credits++;
+                send_credits = true;
+            }
+            data_recvd[current_buffer_element] = 0;
+
+            //reset shift register
+            #pragma unroll
+            for (int j = 0; j < SHIFT_REG + 1; j++)
+            {
+                reduce_result[current_buffer_element][j] = {{ op.shift_reg_init() }};
+            }
+            current_buffer_element++;
+            if (current_buffer_element == credits_flow_control)
+            {
+                current_buffer_element = 0;
+            }
+        }
+    }
+}
+{%- endmacro %}
+
+{%- macro smi_allreduce_impl(program, op) -%}
+void {{ utils.impl_name_port_type("SMI_Allreduce", op) }}(SMI_ARChannel* chan,  void* data_snd, void* data_rcv)
+{
+    char* conv = (char*) data_snd;
+    // copy data to the network message: packetization is disabled, the element is always the first one
+    #pragma unroll
+    for (int jj = 0; jj < {{ op.data_size() }}; jj++)
+    {
+        chan->net.data[jj] = conv[jj];
+    }
+
+    SET_HEADER_NUM_ELEMS(chan->net.header, 1);
+    if (GET_HEADER_OP(chan->net.header) == SMI_SYNCH)
+    {
+        // the support kernel builds the allreduce tree when it receives the first element, which also
+        // carries the message size (see SMI_Open_allreduce_channel)
+        *(short *)(&(chan->net.data[SMI_PACKET_PAYLOAD_SIZE - 6])) = chan->fanout;
+    }
+
+    // offload to the support kernel and wait for the reduced element. The support kernel accepts further
+    // contributions while this one is in flight, so a pipelined loop of calls keeps several elements in flight
+    write_channel_intel({{ op.get_channel("allreduce_send") }}, chan->net);
+    SET_HEADER_OP(chan->net.header, SMI_REDUCE);          // after sending the first element of this allreduce
+    mem_fence(CLK_CHANNEL_MEM_FENCE);
+    SMI_Network_message result = read_channel_intel({{ op.get_channel("allreduce_recv") }});
+    // copy data from the network message to user variable
+    #pragma unroll
+    for (int jj = 0; jj < {{ op.data_size() }}; jj++)
+    {
+        ((char *)data_rcv)[jj] = result.data[jj];
+    }
+}
+{%- endmacro %}
+
+{%- macro smi_allreduce_channel(program, op) -%}
+SMI_ARChannel {{ utils.impl_name_port_type("SMI_Open_allreduce_channel", op) }}(int count, SMI_Datatype data_type, SMI_Op op, int port, SMI_Comm comm)
+{
+    SMI_ARChannel chan;
+    // setup channel descriptor
+    chan.message_size = (unsigned int) count;
+    chan.data_type = data_type;
+    chan.port = (char) port;
+    chan.my_rank = (SMI_Rank) SMI_Comm_rank(comm);
+    chan.num_rank = (SMI_Rank) SMI_Comm_size(comm);
+    chan.reduce_op = (char) op;
+    chan.fanout = SMI_ALLREDUCE_FANOUT;
+    chan.size_of_type = {{ op.data_size() }};
+
+    // setup header for the message
+    SET_HEADER_DST(chan.net.header, 0);
+    SET_HEADER_SRC(chan.net.header, chan.my_rank);
+    SET_HEADER_PORT(chan.net.header, chan.port);
+    SET_HEADER_NUM_ELEMS(chan.net.header, 0);            // at the beginning no data
+    // workaround: the support kernel has to know the message size to limit the number of credits
+    // exploiting the data buffer
+    *(unsigned int *)(&(chan.net.data[SMI_PACKET_PAYLOAD_SIZE - 4])) = chan.message_size;
+    SET_HEADER_OP(chan.net.header, SMI_SYNCH);           // used to signal to the support kernel that a new allreduce has begun
+    return chan;
+}
+{%- endmacro -%}
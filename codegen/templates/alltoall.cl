@@ -0,0 +1,198 @@
+{% import 'utils.cl' as utils %}
+
+{%- macro smi_alltoall_kernel(program, op) -%}
+__kernel void smi_kernel_alltoall_{{ op.logical_port }}(SMI_Rank num_rank)
+{
+    // sends the packets of the application to the destination of the current step. In every step the ranks
+    // send to different destinations (my_rank + step), so that no rank (and no CKS) becomes a hotspot.
+    // A destination has to be ready to receive before the first packet of its step is sent, since it receives
+    // from one source at a time: the requests of later steps may arrive before the current one and are kept
+    // until their step begins. Then the packets are flow-controlled with credits, so that the data in flight never
+    // exceeds the buffer of the CKR channel of the destination, which would otherwise block its CKR
+    __constant int WINDOW = {{ op.buffer_size }};
+    __constant int CREDITS_BATCH = {{ op.credits_batch() }};
+    bool ready[{{ program.max_ranks }}];    // ready to receive messages of the next steps
+    SMI_Network_message mess;
+    SMI_Rank dest = 0;
+    bool active = false;    // the current destination is ready to receive
+    int credits = 0;
+
+    for (int i = 0; i < {{ program.max_ranks }}; i++)
+    {
+        ready[i] = false;
+    }
+
+    while (true)
+    {
+        mess = read_channel_intel({{ op.get_channel("alltoall") }});
+        if (GET_HEADER_OP(mess.header) == SMI_SYNCH)
+        {
+            // first packet of a step
+            dest = GET_HEADER_DST(mess.header);
+            active = ready[dest];
+            ready[dest] = false;
+            credits = active ? WINDOW : 0;
+            SET_HEADER_OP(mess.header, SMI_SCATTER);
+        }
+        while (!active || credits == 0)
+        {
+            SMI_Network_message req = read_channel_intel({{ op.get_channel("ckr_control") }});
+            const SMI_Rank src = GET_HEADER_SRC(req.header);
+            if (GET_HEADER_NUM_ELEMS(req.header) == 1) // ready to receive
+            {
+                if (src == dest && !active)
+                {
+                    active = true;
+                    credits = WINDOW;
+                }
+                else
+                {
+                    ready[src] = true;
+                }
+            }
+            else if (src == dest && active)
+            {
+                credits += CREDITS_BATCH;
+            }
+            // otherwise, these are late credits of a step that has been completed
+        }
+        write_channel_intel({{ op.get_channel("cks_data") }}, mess);
+        credits--;
+    }
+}
+{%- endmacro %}
+
+{%- macro alltoall_store(op, mess) -%}
+            // the packets of the source are stored in the receive buffer as soon as they arrive
+            char* rcv = ((char*) data_rcv) + (chan->step * chan->count + chan->received_elements) * {{ op.data_size() }};
+            const int elems = GET_HEADER_NUM_ELEMS({{ mess }}.header);
+            #pragma unroll
+            for (int jj = 0; jj < {{ op.data_elements_per_packet() * op.data_size() }}; jj++)
+            {
+                if (jj < elems * {{ op.data_size() }})
+                {
+                    rcv[jj] = {{ mess }}.data[jj];
+                }
+            }
+            chan->received_elements += elems;
+            chan->received_packets++;
+            // return the credits only if more data is expected
+            if (chan->received_packets == {{ op.credits_batch() }} && chan->received_elements < chan->count)
+            {
+                SET_HEADER_NUM_ELEMS(control.header, 0);
+                write_channel_intel({{ op.get_channel("cks_control") }}, control);
+                chan->received_packets = 0;
+            }
+{%- endmacro %}
+
+{%- macro smi_alltoall_impl(program, op) -%}
+/**
+ * @brief SMI_Alltoall
+ * @param chan pointer to the alltoall channel descriptor
+ * @param data_snd pointer to the data element that must be sent
+ * @param data_rcv pointer to the receive buffer (count * num_ranks elements)
+ */
+void {{ utils.impl_name_port_type("SMI_Alltoall", op) }}(SMI_AlltoallChannel* chan, void* data_snd, void* data_rcv)
+{
+    char* conv = (char*) data_snd;
+    if (chan->step == 0) // the data for myself does not go through the network
+    {
+        #pragma unroll
+        for (int jj = 0; jj < {{ op.data_size() }}; jj++)
+        {
+            ((char *)data_rcv)[chan->processed_elements * {{ op.data_size() }} + jj] = conv[jj];
+        }
+        chan->processed_elements++;
+    }
+    else
+    {
+        SMI_Network_message control;
+        SET_HEADER_OP(control.header, SMI_SYNCH);
+        SET_HEADER_PORT(control.header, chan->port);
+        SET_HEADER_SRC(control.header, chan->my_rank);
+        const SMI_Rank src = chan->my_rank >= chan->step ? chan->my_rank - chan->step : chan->my_rank - chan->step + chan->num_rank;
+        SET_HEADER_DST(control.header, src);
+        if (chan->processed_elements == 0)
+        {
+            // first element of the step: tell the source that we are ready to receive its data
+            SET_HEADER_NUM_ELEMS(control.header, 1);
+            write_channel_intel({{ op.get_channel("cks_control") }}, control);
+
+            const SMI_Rank dest = chan->my_rank + chan->step < chan->num_rank ? chan->my_rank + chan->step : chan->my_rank + chan->step - chan->num_rank;
+            SET_HEADER_DST(chan->net.header, dest);
+            SET_HEADER_OP(chan->net.header, SMI_SYNCH);
+            chan->received_packets = 0;
+            chan->received_elements = 0;
+        }
+
+{{ utils.pack(op, "chan->net.data", "chan->packet_element_id", "conv", op.data_elements_per_packet())|indent(4, first=True) }}
+        chan->packet_element_id++;
+        chan->processed_elements++;
+        // the packets are sent only when full or at the end of the step: the caller does not wait for the data of
+        // the source, so no rank waits for the partial packet of another one
+        if (chan->packet_element_id == chan->elements_per_packet || chan->processed_elements == chan->count)
+        {
+            SET_HEADER_NUM_ELEMS(chan->net.header, chan->packet_element_id);
+            write_channel_intel({{ op.get_channel("alltoall") }}, chan->net);
+            SET_HEADER_OP(chan->net.header, SMI_SCATTER);
+            chan->packet_element_id = 0;
+        }
+
+        if (chan->processed_elements < chan->count)
+        {
+            bool valid = false;
+            SMI_Network_message mess = read_channel_nb_intel({{ op.get_channel("ckr_data") }}, &valid);
+            if (valid)
+            {
+{{ alltoall_store(op, "mess")|indent(4, first=True) }}
+            }
+        }
+        else
+        {
+            // end of the step: the source sends its last packet at the end of its own step
+            while (chan->received_elements < chan->count)
+            {
+                SMI_Network_message mess = read_channel_intel({{ op.get_channel("ckr_data") }});
+{{ alltoall_store(op, "mess")|indent(4, first=True) }}
+            }
+        }
+    }
+
+    if (chan->processed_elements == chan->count)
+    {
+        // go to the next step
+        chan->processed_elements = 0;
+        chan->step++;
+        if (chan->step == chan->num_rank)
+        {
+            chan->step = 0;
+        }
+    }
+}
+{%- endmacro %}
+
+{%- macro smi_alltoall_channel(program, op) -%}
+SMI_AlltoallChannel {{ utils.impl_name_port_type("SMI_Open_alltoall_channel", op) }}(int count, SMI_Datatype data_type, int port, SMI_Comm comm)
+{
+    SMI_AlltoallChannel chan;
+    chan.port = (char) port;
+    chan.count = count;
+    chan.data_type = data_type;
+    chan.my_rank = (SMI_Rank) SMI_Comm_rank(comm);
+    chan.num_rank = (SMI_Rank) SMI_Comm_size(comm);
+    chan.step = 0;
+    chan.size_of_type = {{ op.data_size() }};
+    chan.elements_per_packet = {{ op.data_elements_per_packet() }};
+
+    // setup header for the message
+    SET_HEADER_SRC(chan.net.header, chan.my_rank);
+    SET_HEADER_PORT(chan.net.header, chan.port);
+    SET_HEADER_NUM_ELEMS(chan.net.header, 0);
+    SET_HEADER_OP(chan.net.header, SMI_SYNCH);
+    chan.processed_elements = 0;
+    chan.received_packets = 0;
+    chan.received_elements = 0;
+    chan.packet_element_id = 0;
+    return chan;
+}
+{%- endmacro -%}
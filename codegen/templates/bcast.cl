@@ -1,14 +1,25 @@
 {% import 'utils.cl' as utils %}
 
 {%- macro smi_bcast_kernel(program, op) -%}
-__kernel void smi_kernel_bcast_{{ op.logical_port }}(char num_rank)
+__kernel void smi_kernel_bcast_{{ op.logical_port }}(SMI_Rank num_rank)
 {
-    bool external = true;
-    char rcv;
-    char root;
-    char received_request = 0; // how many ranks are ready to receive
-    const char num_requests = num_rank - 1;
+    // the ranks form a tree with SMI_BCAST_FANOUT children per rank, numbered relative to the root:
+    // every rank forwards the packets to its children as soon as they arrive.
+    // A rank is ready to receive when its whole subtree is: the ready-to-receive is sent to the parent only after
+    // all the children are ready, so that the data never waits in CK_R for a late rank of the subtree
+    bool external = true;       // wait for the application
+    bool has_packet = false;    // the current packet has to be forwarded to the children
+    bool is_root = false;
+    SMI_Rank root = 0;
+    int first_child = 0;        // relative rank of the first child
+    char num_children = 0;
+    char child = 0;             // next child to send the packet to
+    char received_request = 0;  // how many children are not yet ready to receive
+    bool send_ready = false;    // the subtree is ready, the parent has to be notified
+    unsigned int message_size = 0;
+    unsigned int received_elements = 0;
     SMI_Network_message mess;
+    SMI_Network_message ready;
 
     while (true)
     {
@@ -17,36 +28,70 @@ __kernel void smi_kernel_bcast_{{ op.logical_port }}(char num_rank)
             mess = read_channel_intel({{ op.get_channel("broadcast") }});
             if (GET_HEADER_OP(mess.header) == SMI_SYNCH)   // beginning of a broadcast, we have to wait for "ready to receive"
             {
-                received_request = num_requests;
+                root = GET_HEADER_SRC(mess.header);
+                const int relative_rank = (GET_HEADER_DST(mess.header) - root + num_rank) % num_rank;
+                is_root = relative_rank == 0;
+                first_child = relative_rank * SMI_BCAST_FANOUT + 1;
+                num_children = (char) MIN(MAX(num_rank - first_child, 0), SMI_BCAST_FANOUT);
+                received_request = num_children;
+                send_ready = !is_root;
+                SET_HEADER_OP(ready.header, SMI_SYNCH);
+                SET_HEADER_SRC(ready.header, GET_HEADER_DST(mess.header));
+                SET_HEADER_DST(ready.header, (root + (relative_rank - 1) / SMI_BCAST_FANOUT) % num_rank);
+                SET_HEADER_PORT(ready.header, {{ op.logical_port }});
+                // on non-root ranks the application only announces the broadcast and its length
+                message_size = *(unsigned int *) (&(mess.data[SMI_PACKET_PAYLOAD_SIZE - 4]));
+                received_elements = 0;
             }
             SET_HEADER_OP(mess.header, SMI_BROADCAST);
-            rcv = 0;
+            has_packet = is_root;
+            child = 0;
             external = false;
-            root = GET_HEADER_SRC(mess.header);
         }
-        else // handle the request
+        else if (received_request != 0)
         {
-            if (received_request != 0)
-            {
-                SMI_Network_message req = read_channel_intel({{ op.get_channel("ckr_control") }});
-                received_request--;
-            }
-            else
-            {
-                if (rcv != root) // it's not me
-                {
-                    SET_HEADER_DST(mess.header, rcv);
-                    SET_HEADER_PORT(mess.header, {{ op.logical_port }});
-                    write_channel_intel({{ op.get_channel("cks_data") }}, mess);
-                }
-                rcv++;
-                external = rcv == num_rank;
-            }
+            SMI_Network_message req = read_channel_intel({{ op.get_channel("ckr_control") }});
+            received_request--;
+        }
+        else if (send_ready) // send ready-to-receive to the parent
+        {
+            write_channel_intel({{ op.get_channel("cks_control") }}, ready);
+            send_ready = false;
+        }
+        else if (!has_packet) // receive from the parent and deliver to the application
+        {
+            mess = read_channel_intel({{ op.get_channel("ckr_data") }});
+            received_elements += GET_HEADER_NUM_ELEMS(mess.header);
+            write_channel_intel({{ op.get_channel("broadcast_recv") }}, mess);
+            has_packet = true;
+            child = 0;
+        }
+        else if (child < num_children)
+        {
+            SET_HEADER_DST(mess.header, (root + first_child + child) % num_rank);
+            SET_HEADER_PORT(mess.header, {{ op.logical_port }});
+            write_channel_intel({{ op.get_channel("cks_data") }}, mess);
+            child++;
+        }
+        else // the packet reached all the children
+        {
+            has_packet = false;
+            external = is_root || received_elements >= message_size;
         }
     }
 }
 {%- endmacro %}
 
+{%- macro bcast_init(op) -%}
+        // announce the broadcast to the support kernel, which sends ready-to-receive to the parent once the children
+        // are ready and forwards the packets to them
+        SET_HEADER_SRC(chan->net.header, chan->root_rank);
+        SET_HEADER_DST(chan->net.header, chan->my_rank);
+        *(unsigned int *)(&(chan->net.data[SMI_PACKET_PAYLOAD_SIZE - 4])) = chan->message_size;
+        write_channel_intel({{ op.get_channel("broadcast") }}, chan->net);
+        chan->init=false;
+{%- endmacro %}
+
 {%- macro smi_bcast_impl(program, op) -%}
 void {{ utils.impl_name_port_type("SMI_Bcast", op) }}(SMI_BChannel* chan, void* data)
 {
@@ -55,7 +100,7 @@ void {{ utils.impl_name_port_type("SMI_Bcast", op) }}(SMI_BChannel* chan, void*
     {
         const unsigned int message_size = chan->message_size;
         chan->processed_elements++;
-        COPY_DATA_TO_NET_MESSAGE(chan, chan->net, conv);
+{{ utils.pack(op, "chan->net.data", "chan->packet_element_id", "conv", op.data_elements_per_packet())|indent(4, first=True) }}
 
         chan->packet_element_id++;
         // send the network packet if it is full or we reached the message size
@@ -72,18 +117,17 @@ void {{ utils.impl_name_port_type("SMI_Bcast", op) }}(SMI_BChannel* chan, void*
     }
     else // I have to receive
     {
-        if(chan->init)  //send ready-to-receive to the root
+        if(chan->init)
         {
-            write_channel_intel({{ op.get_channel("cks_control") }}, chan->net);
-            chan->init=false;
+{{ bcast_init(op)|indent(4, first=True) }}
         }
 
         if (chan->packet_element_id_rcv == 0)
         {
-            chan->net_2 = read_channel_intel({{ op.get_channel("ckr_data") }});
+            chan->net_2 = read_channel_intel({{ op.get_channel("broadcast_recv") }});
         }
 
-        COPY_DATA_FROM_NET_MESSAGE(chan, chan->net_2, conv);
+{{ utils.unpack(op, "chan->net_2.data", "chan->packet_element_id_rcv", "conv", op.data_elements_per_packet())|indent(4, first=True) }}
 
         chan->packet_element_id_rcv++;
         if (chan->packet_element_id_rcv == chan->elements_per_packet)
@@ -92,6 +136,42 @@ void {{ utils.impl_name_port_type("SMI_Bcast", op) }}(SMI_BChannel* chan, void*
         }
     }
 }
+void {{ utils.impl_name_port_type("SMI_Bcast_vec", op) }}(SMI_BChannel* chan, void* data)
+{
+    char* conv = (char*)data;
+    // a whole packet is copied at once: no per element selection of the position
+    if (chan->my_rank == chan->root_rank) // I'm the root
+    {
+        const unsigned int remaining = chan->message_size - chan->processed_elements;
+        const unsigned int elems = MIN(remaining, (unsigned int) chan->elements_per_packet);
+        chan->processed_elements += elems;
+        #pragma unroll
+        for (int jj = 0; jj < {{ op.data_elements_per_packet() * op.data_size() }}; jj++)
+        {
+            chan->net.data[jj] = conv[jj];
+        }
+        SET_HEADER_NUM_ELEMS(chan->net.header, elems);
+        SET_HEADER_PORT(chan->net.header, {{ op.logical_port }});
+
+        // offload to support kernel
+        write_channel_intel({{ op.get_channel("broadcast") }}, chan->net);
+        SET_HEADER_OP(chan->net.header, SMI_BROADCAST);  // for the subsequent network packets
+    }
+    else // I have to receive
+    {
+        if(chan->init)
+        {
+{{ bcast_init(op)|indent(4, first=True) }}
+        }
+
+        chan->net_2 = read_channel_intel({{ op.get_channel("broadcast_recv") }});
+        #pragma unroll
+        for (int jj = 0; jj < {{ op.data_elements_per_packet() * op.data_size() }}; jj++)
+        {
+            conv[jj] = chan->net_2.data[jj];
+        }
+    }
+}
 {%- endmacro %}
 
 {%- macro smi_bcast_channel(program, op) -%}
@@ -102,26 +182,25 @@ SMI_BChannel {{ utils.impl_name_port_type("SMI_Open_bcast_channel", op) }}(int c
     chan.message_size = count;
     chan.data_type = data_type;
     chan.port = (char) port;
-    chan.my_rank = (char) SMI_Comm_rank(comm);
-    chan.root_rank = (char) root;
-    chan.num_rank = (char) SMI_Comm_size(comm);
+    chan.my_rank = (SMI_Rank) SMI_Comm_rank(comm);
+    chan.root_rank = (SMI_Rank) root;
+    chan.num_rank = (SMI_Rank) SMI_Comm_size(comm);
     chan.init = true;
     chan.size_of_type = {{ op.data_size() }};
     chan.elements_per_packet = {{ op.data_elements_per_packet() }};
 
     if (chan.my_rank != chan.root_rank)
     {
-        // At the beginning, send a "ready to receive" to the root
+        // At the beginning, the support kernel sends a "ready to receive" to the parent in the broadcast tree
         // This is needed to not inter-mix subsequent collectives
         SET_HEADER_OP(chan.net.header, SMI_SYNCH);
-        SET_HEADER_DST(chan.net.header, chan.root_rank);
-        SET_HEADER_SRC(chan.net.header, chan.my_rank);
         SET_HEADER_PORT(chan.net.header, chan.port);
     }
     else
     {
         SET_HEADER_OP(chan.net.header, SMI_SYNCH);           // used to signal to the support kernel that a new broadcast has begun
         SET_HEADER_SRC(chan.net.header, chan.root_rank);
+        SET_HEADER_DST(chan.net.header, chan.root_rank);     // used by the support kernel to detect the root
         SET_HEADER_PORT(chan.net.header, chan.port);         // used by destination
         SET_HEADER_NUM_ELEMS(chan.net.header, 0);            // at the beginning no data
     }
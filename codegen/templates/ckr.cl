@@ -1,28 +1,12 @@
 {% import 'utils.cl' as utils %}
 
-{%- macro smi_ckr(program, channel, channel_count, target_index) -%}
-__kernel void smi_kernel_ckr_{{ channel.index }}(__global volatile char *restrict rt, const char rank)
-{
-    // rt contains intertwined (dp0, cp0, dp1, cp1, ...)
-{% set logical_ports = program.logical_port_count %}
-    char external_routing_table[{{ logical_ports }} /* logical port count */][2];
-    for (int i = 0; i < {{ logical_ports }}; i++)
-    {
-        for (int j = 0; j < 2; j++)
-        {
-            external_routing_table[i][j] = rt[i * 2 + j];
-        }
-    }
-
-    // QSFP + number of CK_Rs - 1 + CK_S
-    const char num_sender = {{ channel_count + 1 }};
-    char sender_id = 0;
-    SMI_Network_message message;
-
-    char contiguous_reads = 0;
-    while (1)
-    {
+{%- macro read_data_lane(program, channel, channel_count, declare) %}
+{% if program.arbiter == "ready-mask" %}
+{{ utils.ready_mask_grant(channel_count + 1, declare) }}
+{%- else %}
+{% if declare %}
         bool valid = false;
+{% endif %}
         switch (sender_id)
         {
             case 0:
@@ -40,39 +24,244 @@ __kernel void smi_kernel_ckr_{{ channel.index }}(__global volatile char *restric
                 message = read_channel_nb_intel(channels_interconnect_ck_s_to_ck_r[{{ channel.index }}], &valid);
                 break;
         }
+{%- endif %}
+{%- endmacro %}
 
-        if (valid)
-        {
-            contiguous_reads++;
+{%- macro destination() %}
             char dest;
             if (GET_HEADER_DST(message.header) != rank)
             {
                 dest = 0;
             }
             else dest = external_routing_table[GET_HEADER_PORT(message.header)][GET_HEADER_OP(message.header) == SMI_SYNCH];
+{%- endmacro %}
 
+{%- macro forward(program, channel, channel_count, target_index, lane, message="message") %}
             switch (dest)
             {
                 case 0:
                     // send to CK_S_{{ channel.index }}
-                    write_channel_intel(channels_interconnect_ck_r_to_ck_s[{{ channel.index }}], message);
+{% if program.virtual_channels %}
+                    // on the virtual channel of the message (the remote CK_S holds a credit for it)
+                    if (GET_HEADER_VC({{ message }}.header))
+                    {
+                        write_channel_intel(channels_interconnect_ck_r_to_ck_s_vc1[{{ channel.index }}], {{ message }});
+                    }
+                    else
+                    {
+                        write_channel_intel(channels_interconnect_ck_r_to_ck_s[{{ channel.index }}], {{ message }});
+                    }
+{% else %}
+                    write_channel_intel(channels_interconnect_ck_r_to_ck_s{{ lane }}[{{ channel.index }}], {{ message }});
+{% endif %}
                     break;
                 {% for ck_r in channel.neighbours() %}
                 case {{ loop.index0 + 1 }}:
                     // send to CK_R_{{ ck_r }}
-                    write_channel_intel(channels_interconnect_ck_r[{{ (channel_count - 1) * ck_r + target_index(ck_r, channel.index) }}], message);
+                    write_channel_intel(channels_interconnect_ck_r{{ lane }}[{{ (channel_count - 1) * ck_r + target_index(ck_r, channel.index) }}], {{ message }});
                     break;
                 {% endfor %}
                 {% for (op, key) in program.get_channel_allocations_with_prefix(channel.index, "ckr") %}
                 case {{ channel_count + loop.index0 }}:
                     // send to {{ op }}
-                    write_channel_intel({{ op.get_channel(key) }}, message);
+                    write_channel_intel({{ op.get_channel(key) }}, {{ message }});
                     break;
                 {% endfor %}
             }
+{%- endmacro %}
+
+{%- macro forward_burst(program, channel, channel_count, target_index) %}
+            if (GET_HEADER_OP(message.header) == SMI_BURST)
+            {
+                // the payload flits follow the header flit on the same input and are forwarded to the same output
+                for (char flit = 0; flit < GET_HEADER_NUM_ELEMS(message.header); flit++)
+                {
+                    SMI_Network_message payload;
+                    switch (sender_id)
+                    {
+                        case 0:
+                            payload = read_channel_intel(io_in_{{ channel.index }});
+                            break;
+                        {% for ck_r in channel.neighbours() %}
+                        case {{ loop.index0 + 1 }}:
+                            payload = read_channel_intel(channels_interconnect_ck_r[{{ (channel_count - 1) * channel.index + loop.index0 }}]);
+                            break;
+                        {% endfor %}
+                        case {{ channel_count }}:
+                            payload = read_channel_intel(channels_interconnect_ck_s_to_ck_r[{{ channel.index }}]);
+                            break;
+                    }
+{{ forward(program, channel, channel_count, target_index, "", "payload")|indent(8, first=True) }}
+                }
+            }
+{%- endmacro %}
+
+{%- macro smi_ckr(program, channel, channel_count, target_index) -%}
+__kernel void smi_kernel_ckr_{{ channel.index }}(__global volatile char *restrict rt, const SMI_Rank rank)
+{
+    // rt contains intertwined (dp0, cp0, dp1, cp1, ...)
+{% set logical_ports = program.logical_port_count %}
+    char external_routing_table[{{ logical_ports }} /* logical port count */][2];
+    for (int i = 0; i < {{ logical_ports }}; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            external_routing_table[i][j] = rt[i * 2 + j];
+        }
+    }
+
+    // QSFP + number of CK_Rs - 1 + CK_S
+    const char num_sender = {{ channel_count + 1 }};
+    char sender_id = 0;
+    SMI_Network_message message;
+{% if program.control_lane %}
+    // control lane: number of CK_Rs - 1 + CK_S (the QSFP is shared with the data lane)
+    const char num_control_sender = {{ channel_count }};
+    char control_sender_id = 0;
+{% endif %}
+
+    char contiguous_reads = 0;
+{% if program.virtual_channels %}
+    // credits of the virtual channels received from the remote CK_S, and credits freed by the messages received
+    // from the QSFP and delivered here: both are accumulated until CK_S_{{ channel.index }} takes them, so that the QSFP
+    // is never held back
+    unsigned char received_credits[2] = {0, 0};
+    unsigned char delivered_credits[2] = {0, 0};
+{% endif %}
+{% if program.arbiter == "ready-mask" %}
+    // messages read from the inputs and not yet forwarded
+    SMI_Network_message messages[{{ channel_count + 1 }}];
+    bool ready[{{ channel_count + 1 }}];
+    for (int i = 0; i < {{ channel_count + 1 }}; i++)
+    {
+        ready[i] = false;
+    }
+{% endif %}
+    while (1)
+    {
+{% if program.virtual_channels %}
+        if (received_credits[0] != 0 || received_credits[1] != 0 || delivered_credits[0] != 0 || delivered_credits[1] != 0)
+        {
+            SMI_Network_message credits;
+            credits.data[0] = received_credits[0];
+            credits.data[1] = received_credits[1];
+            credits.data[2] = delivered_credits[0];
+            credits.data[3] = delivered_credits[1];
+            if (write_channel_nb_intel(channels_interconnect_ck_r_to_ck_s_credits[{{ channel.index }}], credits))
+            {
+                received_credits[0] = 0;
+                received_credits[1] = 0;
+                delivered_credits[0] = 0;
+                delivered_credits[1] = 0;
+            }
+        }
+
+{% endif %}
+{% if program.arbiter == "ready-mask" %}
+        // poll all the inputs that do not hold a message
+        if (!ready[0])
+        {
+            // QSFP
+            messages[0] = read_channel_nb_intel(io_in_{{ channel.index }}, &ready[0]);
+        }
+        {% for ck_r in channel.neighbours() %}
+        if (!ready[{{ loop.index0 + 1 }}])
+        {
+            // receive from CK_R_{{ ck_r }}
+            messages[{{ loop.index0 + 1 }}] = read_channel_nb_intel(channels_interconnect_ck_r[{{ (channel_count - 1) * channel.index + loop.index0 }}], &ready[{{ loop.index0 + 1 }}]);
+        }
+        {% endfor %}
+        if (!ready[{{ channel_count }}])
+        {
+            // receive from CK_S_{{ channel.index }}
+            messages[{{ channel_count }}] = read_channel_nb_intel(channels_interconnect_ck_s_to_ck_r[{{ channel.index }}], &ready[{{ channel_count }}]);
+        }
+
+{% endif %}
+{% if program.control_lane %}
+        // the control lane has strict priority: the data lane is served only when it holds no message
+        bool valid = false;
+        switch (control_sender_id)
+        {
+            {% for ck_r in channel.neighbours() %}
+            case {{ loop.index0 }}:
+                // receive from CK_R_{{ ck_r }}
+                message = read_channel_nb_intel(channels_interconnect_ck_r_control[{{ (channel_count - 1) * channel.index + loop.index0 }}], &valid);
+                break;
+            {% endfor %}
+            case {{ channel_count - 1 }}:
+                // receive from CK_S_{{ channel.index }}
+                message = read_channel_nb_intel(channels_interconnect_ck_s_to_ck_r_control[{{ channel.index }}], &valid);
+                break;
+        }
+        control_sender_id++;
+        if (control_sender_id == num_control_sender)
+        {
+            control_sender_id = 0;
+        }
+
+        const bool control = valid;
+        if (!control)
+        {
+{{ read_data_lane(program, channel, channel_count, False)|indent(4, first=True) }}
+        }
+{% else %}
+{{ read_data_lane(program, channel, channel_count, True) }}
+{% endif %}
+
+        if (valid)
+        {
+{% if program.control_lane %}
+            if (!control)
+            {
+                contiguous_reads++;
+            }
+{% else %}
+            contiguous_reads++;
+{% endif %}
+{% if program.virtual_channels %}
+            // the credits port has no entry in the routing table
+            if (sender_id == 0 && GET_HEADER_PORT(message.header) == SMI_VC_CREDITS_PORT)
+            {
+                // credits returned by the remote CK_S
+                received_credits[0] += message.data[0];
+                received_credits[1] += message.data[1];
+            }
+            else
+            {
+{{ destination()|indent(4, first=True) }}
+
+{{ forward(program, channel, channel_count, target_index, "")|indent(4, first=True) }}
+                if (sender_id == 0 && dest != 0)
+                {
+                    // delivered here: the credit goes back to the remote CK_S
+                    delivered_credits[GET_HEADER_VC(message.header)]++;
+                }
+            }
+{% else %}
+{{ destination() }}
+
+{% if program.control_lane %}
+            // synchronization messages (credits, ready to receive) never queue behind data
+            if (GET_HEADER_OP(message.header) == SMI_SYNCH)
+            {
+{{ forward(program, channel, channel_count, target_index, "_control")|indent(4, first=True) }}
+            }
+            else
+            {
+{{ forward(program, channel, channel_count, target_index, "")|indent(4, first=True) }}
+            }
+{% else %}
+{{ forward(program, channel, channel_count, target_index, "") }}
+{% endif %}
+{% endif %}
+{% if program.burst_length %}
+{{ forward_burst(program, channel, channel_count, target_index) }}
+{% endif %}
         }
+{% if program.arbiter != "ready-mask" %}
 
-        if (!valid || contiguous_reads == READS_LIMIT)
+        if ({% if program.control_lane %}!control && ({% endif %}!valid || contiguous_reads == READS_LIMIT{% if program.control_lane %}){% endif %})
         {
             contiguous_reads = 0;
             sender_id++;
@@ -81,6 +270,7 @@ __kernel void smi_kernel_ckr_{{ channel.index }}(__global volatile char *restric
                 sender_id = 0;
             }
         }
+{% endif %}
     }
 }
 {%- endmacro %}
@@ -1,8 +1,118 @@
 {% import 'utils.cl' as utils %}
 
-{%- macro smi_cks(program, channel, channel_count, target_index) -%}
-__kernel void smi_kernel_cks_{{ channel.index }}(__global volatile char *restrict rt, const char num_ranks)
-{
+{%- macro read_data_lane(program, channel, channel_count, allocations, declare) %}
+{% if program.arbiter == "ready-mask" %}
+{{ utils.ready_mask_grant(channel_count + allocations|length, declare, reads_limit(program)) }}
+{%- else %}
+{% if declare %}
+        bool valid = false;
+{% endif %}
+        switch (sender_id)
+        {
+            {% for ck_s in channel.neighbours() %}
+            case {{ loop.index0 }}:
+                // receive from CK_S_{{ ck_s }}
+                message = read_channel_nb_intel(channels_interconnect_ck_s[{{ (channel_count - 1) * channel.index + loop.index0 }}], &valid);
+                break;
+            {% endfor %}
+            case {{ channel_count - 1 }}:
+                // receive from CK_R_{{ channel.index }}
+                message = read_channel_nb_intel(channels_interconnect_ck_r_to_ck_s[{{ channel.index }}], &valid);
+                break;
+            {% for (op, key) in allocations %}
+            case {{ channel_count + loop.index0 }}:
+                // receive from {{ op }}
+                message = read_channel_nb_intel({{ op.get_channel(key) }}, &valid);
+                break;
+            {% endfor %}
+        }
+{%- endif %}
+{%- endmacro %}
+
+{%- macro reads_limit(program) -%}
+{{ "reads_limit[sender_id]" if program.port_weights else "READS_LIMIT" }}
+{%- endmacro %}
+
+{%- macro route(program) -%}
+{% if program.wide_ranks %}
+            // both levels are read in parallel: the entry of the own group defers to the per-rank table
+            const char group_idx = group_routing_table[GET_HEADER_DST(message.header) / RANK_GROUP_SIZE];
+            const char local_idx = local_routing_table[GET_HEADER_DST(message.header) % RANK_GROUP_SIZE];
+            char idx = group_idx == CKS_LOCAL_GROUP ? local_idx : group_idx;
+{%- else %}
+            char idx = external_routing_table[GET_HEADER_DST(message.header)];
+{%- endif %}
+{%- endmacro %}
+
+{%- macro forward(channel, channel_count, target_index, lane, message="message") %}
+            switch (idx)
+            {
+                case 0:
+                    // send to QSFP
+                    write_channel_intel(io_out_{{ channel.index }}, {{ message }});
+                    break;
+                case 1:
+                    // send to CK_R_{{ channel.index }}
+                    write_channel_intel(channels_interconnect_ck_s_to_ck_r{{ lane }}[{{ channel.index }}], {{ message }});
+                    break;
+                {% for ck_s in channel.neighbours() %}
+                case {{ 2 + loop.index0 }}:
+                    // send to CK_S_{{ ck_s }}
+                    write_channel_intel(channels_interconnect_ck_s{{ lane }}[{{ (channel_count - 1) * ck_s + target_index(ck_s, channel.index) }}], {{ message }});
+                    break;
+                {% endfor %}
+            }
+{%- endmacro %}
+
+{%- macro forward_burst(program, channel, channel_count, allocations, target_index) %}
+            if (GET_HEADER_OP(message.header) == SMI_BURST)
+            {
+                // the payload flits follow the header flit on the same input and are forwarded to the same output
+                for (char flit = 0; flit < GET_HEADER_NUM_ELEMS(message.header); flit++)
+                {
+                    SMI_Network_message payload;
+                    switch (sender_id)
+                    {
+                        {% for ck_s in channel.neighbours() %}
+                        case {{ loop.index0 }}:
+                            payload = read_channel_intel(channels_interconnect_ck_s[{{ (channel_count - 1) * channel.index + loop.index0 }}]);
+                            break;
+                        {% endfor %}
+                        case {{ channel_count - 1 }}:
+                            payload = read_channel_intel(channels_interconnect_ck_r_to_ck_s[{{ channel.index }}]);
+                            break;
+                        {% for (op, key) in allocations %}
+                        {% if op in program.get_burst_ops() and key == "cks_data" %}
+                        case {{ channel_count + loop.index0 }}:
+                            payload = read_channel_intel({{ op.get_burst_channel() }});
+                            break;
+                        {% endif %}
+                        {% endfor %}
+                    }
+{{ forward(channel, channel_count, target_index, "", "payload")|indent(8, first=True) }}
+                }
+            }
+{%- endmacro %}
+
+{%- macro load_routing_table(program) %}
+{% if program.wide_ranks %}
+    // two-level table: rt contains one entry per group of RANK_GROUP_SIZE ranks,
+    // followed by one entry per rank of the group of this rank
+    char group_routing_table[MAX_RANK_GROUPS];
+    char local_routing_table[RANK_GROUP_SIZE];
+    const SMI_Rank num_groups = (num_ranks + RANK_GROUP_SIZE - 1) / RANK_GROUP_SIZE;
+    for (int i = 0; i < MAX_RANK_GROUPS; i++)
+    {
+        if (i < num_groups)
+        {
+            group_routing_table[i] = rt[i];
+        }
+    }
+    for (int i = 0; i < RANK_GROUP_SIZE; i++)
+    {
+        local_routing_table[i] = rt[num_groups + i];
+    }
+{% else %}
     char external_routing_table[MAX_RANKS];
     for (int i = 0; i < MAX_RANKS; i++)
     {
@@ -11,61 +121,314 @@ __kernel void smi_kernel_cks_{{ channel.index }}(__global volatile char *restric
             external_routing_table[i] = rt[i];
         }
     }
+{% endif %}
+{%- endmacro %}
 
-{% set allocations = program.get_channel_allocations_with_prefix(channel.index, "cks") %}
+{%- macro smi_cks(program, channel, channel_count, target_index) -%}
+__kernel void smi_kernel_cks_{{ channel.index }}(__global volatile char *restrict rt, const SMI_Rank num_ranks)
+{
+{{ load_routing_table(program) }}
+
+{% set allocations = program.get_lane_allocations(channel.index, "cks", False) %}
     // number of CK_S - 1 + CK_R + {{ allocations|length }} CKS hardware ports
     const char num_sender = {{ channel_count + allocations|length }};
     char sender_id = 0;
     SMI_Network_message message;
+{% if program.control_lane %}
+{% set control_allocations = program.get_lane_allocations(channel.index, "cks", True) %}
+    // control lane: number of CK_S - 1 + CK_R + {{ control_allocations|length }} CKS control ports
+    const char num_control_sender = {{ channel_count + control_allocations|length }};
+    char control_sender_id = 0;
+{% endif %}
 
     char contiguous_reads = 0;
+{% if program.port_weights %}
+    // maximum number of consecutive reads from every input, given by the weight of its logical port
+    const char reads_limit[{{ channel_count + allocations|length }}] = {
+        {%- for i in range(channel_count) %}READS_LIMIT, {% endfor %}
+        {%- for (op, key) in allocations %}{{ program.get_reads_limit(op) }}{{ ", " if not loop.last }}{% endfor %}};
+{% endif %}
+{% if program.arbiter == "ready-mask" %}
+    // messages read from the inputs and not yet forwarded
+    SMI_Network_message messages[{{ channel_count + allocations|length }}];
+    bool ready[{{ channel_count + allocations|length }}];
+    for (int i = 0; i < {{ channel_count + allocations|length }}; i++)
+    {
+        ready[i] = false;
+    }
+{% endif %}
 
     while (1)
     {
+{% if program.arbiter == "ready-mask" %}
+        // poll all the inputs that do not hold a message
+        {% for ck_s in channel.neighbours() %}
+        if (!ready[{{ loop.index0 }}])
+        {
+            // receive from CK_S_{{ ck_s }}
+            messages[{{ loop.index0 }}] = read_channel_nb_intel(channels_interconnect_ck_s[{{ (channel_count - 1) * channel.index + loop.index0 }}], &ready[{{ loop.index0 }}]);
+        }
+        {% endfor %}
+        if (!ready[{{ channel_count - 1 }}])
+        {
+            // receive from CK_R_{{ channel.index }}
+            messages[{{ channel_count - 1 }}] = read_channel_nb_intel(channels_interconnect_ck_r_to_ck_s[{{ channel.index }}], &ready[{{ channel_count - 1 }}]);
+        }
+        {% for (op, key) in allocations %}
+        if (!ready[{{ channel_count + loop.index0 }}])
+        {
+            // receive from {{ op }}
+            messages[{{ channel_count + loop.index0 }}] = read_channel_nb_intel({{ op.get_channel(key) }}, &ready[{{ channel_count + loop.index0 }}]);
+        }
+        {% endfor %}
+
+{% endif %}
+{% if program.control_lane %}
+        // the control lane has strict priority: the data lane is served only when it holds no message
         bool valid = false;
-        switch (sender_id)
+        switch (control_sender_id)
         {
             {% for ck_s in channel.neighbours() %}
             case {{ loop.index0 }}:
                 // receive from CK_S_{{ ck_s }}
-                message = read_channel_nb_intel(channels_interconnect_ck_s[{{ (channel_count - 1) * channel.index + loop.index0 }}], &valid);
+                message = read_channel_nb_intel(channels_interconnect_ck_s_control[{{ (channel_count - 1) * channel.index + loop.index0 }}], &valid);
                 break;
             {% endfor %}
             case {{ channel_count - 1 }}:
                 // receive from CK_R_{{ channel.index }}
-                message = read_channel_nb_intel(channels_interconnect_ck_r_to_ck_s[{{ channel.index }}], &valid);
+                message = read_channel_nb_intel(channels_interconnect_ck_r_to_ck_s_control[{{ channel.index }}], &valid);
                 break;
-            {% for (op, key) in allocations %}
+            {% for (op, key) in control_allocations %}
             case {{ channel_count + loop.index0 }}:
                 // receive from {{ op }}
                 message = read_channel_nb_intel({{ op.get_channel(key) }}, &valid);
                 break;
             {% endfor %}
         }
+        control_sender_id++;
+        if (control_sender_id == num_control_sender)
+        {
+            control_sender_id = 0;
+        }
+
+        const bool control = valid;
+        if (!control)
+        {
+{{ read_data_lane(program, channel, channel_count, allocations, False)|indent(4, first=True) }}
+        }
+{% else %}
+{{ read_data_lane(program, channel, channel_count, allocations, True) }}
+{% endif %}
 
         if (valid)
         {
+{% if program.control_lane %}
+            if (!control)
+            {
+                contiguous_reads++;
+            }
+{{ route(program) }}
+            // synchronization messages (credits, ready to receive) never queue behind data
+            if (GET_HEADER_OP(message.header) == SMI_SYNCH)
+            {
+{{ forward(channel, channel_count, target_index, "_control")|indent(4, first=True) }}
+            }
+            else
+            {
+{{ forward(channel, channel_count, target_index, "")|indent(4, first=True) }}
+            }
+{% else %}
             contiguous_reads++;
-            char idx = external_routing_table[GET_HEADER_DST(message.header)];
-            switch (idx)
+{{ route(program) }}
+{{ forward(channel, channel_count, target_index, "") }}
+{% endif %}
+{% if program.burst_length %}
+{{ forward_burst(program, channel, channel_count, allocations, target_index) }}
+{% endif %}
+        }
+{% if program.arbiter != "ready-mask" %}
+        if ({% if program.control_lane %}!control && ({% endif %}!valid || contiguous_reads == {{ reads_limit(program) }}{% if program.control_lane %}){% endif %})
+        {
+            contiguous_reads = 0;
+            sender_id++;
+            if (sender_id == num_sender)
+            {
+                sender_id = 0;
+            }
+        }
+{% endif %}
+    }
+}
+{%- endmacro %}
+
+
+{%- macro forward_vc(channel, channel_count, target_index, vc) %}
+            // forward the waiting message of virtual channel {{ vc }}: the QSFP needs a credit of the virtual channel
+            // used on the link, the other outputs must not be full
+            switch (pending_idx[{{ vc }}])
             {
                 case 0:
                     // send to QSFP
-                    write_channel_intel(io_out_{{ channel.index }}, message);
+                    if (qsfp_credits[{{ vc }}] != 0)
+                    {
+                        write_channel_intel(io_out_{{ channel.index }}, pending[{{ vc }}]);
+                        qsfp_credits[{{ vc }}]--;
+                        has_pending[{{ vc }}] = false;
+                    }
+                    break;
+                case CKS_QSFP_DATELINE:
+                    // send to QSFP crossing the dateline: the message continues on the second virtual channel
+                    if (qsfp_credits[1] != 0)
+                    {
+                        SET_HEADER_VC(pending[{{ vc }}].header, 1);
+                        write_channel_intel(io_out_{{ channel.index }}, pending[{{ vc }}]);
+                        qsfp_credits[1]--;
+                        has_pending[{{ vc }}] = false;
+                    }
                     break;
                 case 1:
                     // send to CK_R_{{ channel.index }}
-                    write_channel_intel(channels_interconnect_ck_s_to_ck_r[{{ channel.index }}], message);
+                    has_pending[{{ vc }}] = !write_channel_nb_intel(channels_interconnect_ck_s_to_ck_r[{{ channel.index }}], pending[{{ vc }}]);
                     break;
                 {% for ck_s in channel.neighbours() %}
                 case {{ 2 + loop.index0 }}:
                     // send to CK_S_{{ ck_s }}
-                    write_channel_intel(channels_interconnect_ck_s[{{ (channel_count - 1) * ck_s + target_index(ck_s, channel.index) }}], message);
+                    has_pending[{{ vc }}] = !write_channel_nb_intel(channels_interconnect_ck_s{{ "_vc1" if vc }}[{{ (channel_count - 1) * ck_s + target_index(ck_s, channel.index) }}], pending[{{ vc }}]);
                     break;
                 {% endfor %}
             }
+{%- endmacro %}
+
+{#- CK_S with dateline virtual channels: the messages that wait for an output are kept aside (one per virtual channel),
+    so that the other virtual channel is still served, and the QSFP is used only with a credit of the remote CK_R -#}
+{%- macro smi_cks_vc(program, channel, channel_count, target_index) -%}
+__kernel void smi_kernel_cks_{{ channel.index }}(__global volatile char *restrict rt, const SMI_Rank num_ranks)
+{
+{{ load_routing_table(program) }}
+
+{% set allocations = program.get_lane_allocations(channel.index, "cks", False) %}
+{% set vc1_base = channel_count + allocations|length %}
+    // number of CK_S - 1 + CK_R + {{ allocations|length }} CKS hardware ports on the first virtual channel,
+    // number of CK_S - 1 + CK_R on the second one
+    const char num_sender = {{ vc1_base + channel_count }};
+    char sender_id = 0;
+    SMI_Network_message message;
+
+    char contiguous_reads = 0;
+{% if program.port_weights %}
+    // maximum number of consecutive reads from every input, given by the weight of its logical port
+    const char reads_limit[{{ vc1_base + channel_count }}] = {
+        {%- for i in range(channel_count) %}READS_LIMIT, {% endfor %}
+        {%- for (op, key) in allocations %}{{ program.get_reads_limit(op) }}, {% endfor %}
+        {%- for i in range(channel_count) %}READS_LIMIT{{ ", " if not loop.last }}{% endfor %}};
+{% endif %}
+    // the message of every virtual channel that waits for its output (with its output)
+    SMI_Network_message pending[2];
+    bool has_pending[2] = {false, false};
+    char pending_idx[2];
+    // credits of the virtual channels of the QSFP link (free entries of the CK_R -> CK_S interconnects of the
+    // remote channel), and credits to return to the remote CK_S for the messages received from the QSFP
+    unsigned char qsfp_credits[2] = {VC_CREDITS, VC_CREDITS};
+    unsigned char returned_credits[2] = {0, 0};
+
+    while (1)
+    {
+        // credits received by CK_R_{{ channel.index }}: from the remote CK_S, and for the messages that it delivered
+        bool credits_valid = false;
+        SMI_Network_message credits = read_channel_nb_intel(channels_interconnect_ck_r_to_ck_s_credits[{{ channel.index }}], &credits_valid);
+        if (credits_valid)
+        {
+            qsfp_credits[0] += credits.data[0];
+            qsfp_credits[1] += credits.data[1];
+            returned_credits[0] += credits.data[2];
+            returned_credits[1] += credits.data[3];
+        }
+
+        if (returned_credits[0] >= VC_CREDITS_BATCH || returned_credits[1] >= VC_CREDITS_BATCH)
+        {
+            // the remote CK_R never waits on credits messages, so they do not need credits
+            SMI_Network_message returned;
+            SET_HEADER_SRC(returned.header, 0);
+            SET_HEADER_DST(returned.header, 0);
+            SET_HEADER_PORT(returned.header, SMI_VC_CREDITS_PORT);
+            SET_HEADER_OP(returned.header, SMI_SYNCH);
+            SET_HEADER_NUM_ELEMS(returned.header, 2);
+            returned.data[0] = returned_credits[0];
+            returned.data[1] = returned_credits[1];
+            write_channel_intel(io_out_{{ channel.index }}, returned);
+            returned_credits[0] = 0;
+            returned_credits[1] = 0;
+        }
+
+        // a message blocked on one virtual channel never holds back the other one
+        if (has_pending[0])
+        {
+{{ forward_vc(channel, channel_count, target_index, 0) }}
+        }
+        if (has_pending[1])
+        {
+{{ forward_vc(channel, channel_count, target_index, 1) }}
+        }
+
+        // read a new message from the inputs of the virtual channels without a waiting message
+        bool valid = false;
+        switch (sender_id)
+        {
+            {% for ck_s in channel.neighbours() %}
+            case {{ loop.index0 }}:
+                // receive from CK_S_{{ ck_s }}
+                if (!has_pending[0])
+                {
+                    message = read_channel_nb_intel(channels_interconnect_ck_s[{{ (channel_count - 1) * channel.index + loop.index0 }}], &valid);
+                }
+                break;
+            {% endfor %}
+            case {{ channel_count - 1 }}:
+                // receive from CK_R_{{ channel.index }}
+                if (!has_pending[0])
+                {
+                    message = read_channel_nb_intel(channels_interconnect_ck_r_to_ck_s[{{ channel.index }}], &valid);
+                    returned_credits[0] += valid;
+                }
+                break;
+            {% for (op, key) in allocations %}
+            case {{ channel_count + loop.index0 }}:
+                // receive from {{ op }}
+                if (!has_pending[0])
+                {
+                    message = read_channel_nb_intel({{ op.get_channel(key) }}, &valid);
+                }
+                break;
+            {% endfor %}
+            {% for ck_s in channel.neighbours() %}
+            case {{ vc1_base + loop.index0 }}:
+                // receive from CK_S_{{ ck_s }} (second virtual channel)
+                if (!has_pending[1])
+                {
+                    message = read_channel_nb_intel(channels_interconnect_ck_s_vc1[{{ (channel_count - 1) * channel.index + loop.index0 }}], &valid);
+                }
+                break;
+            {% endfor %}
+            case {{ vc1_base + channel_count - 1 }}:
+                // receive from CK_R_{{ channel.index }} (second virtual channel)
+                if (!has_pending[1])
+                {
+                    message = read_channel_nb_intel(channels_interconnect_ck_r_to_ck_s_vc1[{{ channel.index }}], &valid);
+                    returned_credits[1] += valid;
+                }
+                break;
+        }
+
+        if (valid)
+        {
+            contiguous_reads++;
+{{ route(program) }}
+            const char vc = sender_id < {{ vc1_base }} ? 0 : 1;
+            pending[vc] = message;
+            pending_idx[vc] = idx;
+            has_pending[vc] = true;
         }
-        if (!valid || contiguous_reads == READS_LIMIT)
+        if (!valid || contiguous_reads == {{ reads_limit(program) }})
         {
             contiguous_reads = 0;
             sender_id++;
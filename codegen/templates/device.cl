@@ -1,3 +1,13 @@
+{% if program.message_width != 256 %}
+#ifndef SMI_MESSAGE_WIDTH
+#define SMI_MESSAGE_WIDTH {{ program.message_width }}
+#endif
+{% endif %}
+{% if program.wide_ranks %}
+#ifndef SMI_WIDE_RANKS
+#define SMI_WIDE_RANKS
+#endif
+{% endif %}
 #include "smi/network_message.h"
 {% import 'utils.cl' as utils %}
 {% import 'ckr.cl' as smi_ckr %}
@@ -7,13 +17,33 @@
 {% import 'pop.cl' as smi_pop %}
 {% import 'bcast.cl' as smi_bcast %}
 {% import 'reduce.cl' as smi_reduce %}
+{% import 'allreduce.cl' as smi_allreduce %}
 {% import 'scatter.cl' as smi_scatter %}
 {% import 'gather.cl' as smi_gather %}
+{% import 'allgather.cl' as smi_allgather %}
+{% import 'alltoall.cl' as smi_alltoall %}
+{% import 'native.cl' as smi_native %}
 
 // the maximum number of consecutive reads that each CKs/CKr can do from the same channel
 #define READS_LIMIT {{ program.consecutive_read_limit }}
 // maximum number of ranks in the cluster
 #define MAX_RANKS {{ program.max_ranks }}
+{% if program.wide_ranks %}
+// number of consecutive ranks that share an entry of the top-level CK_S routing table
+#define RANK_GROUP_SIZE {{ program.rank_group_size }}
+#define MAX_RANK_GROUPS {{ program.get_rank_group_count(program.max_ranks) }}
+// top-level CK_S routing table entry of the group of the local rank
+#define CKS_LOCAL_GROUP -1
+{% endif %}
+{% set vc_credits = 64 %}
+{% if program.virtual_channels %}
+// CK_S routing table entry of the QSFP of a dateline: the messages continue on the second virtual channel
+#define CKS_QSFP_DATELINE 64
+// credits of a virtual channel of a QSFP link, i.e. the depth of its CK_R -> CK_S interconnect on the remote FPGA
+#define VC_CREDITS {{ vc_credits }}
+// credits returned by every credits message (SMI_VC_CREDITS_PORT)
+#define VC_CREDITS_BATCH {{ vc_credits // 4 }}
+{% endif %}
 {% if program.p2p_rendezvous %}
 //P2P communications use synchronization
 #define P2P_RENDEZVOUS
@@ -22,6 +52,16 @@
 {% endif %}
 
 // QSFP channels
+{% if native %}
+{% for fpga in fpgas %}
+#if SMI_EMULATION_RANK == {{ fpga.rank }}
+    {% for channel in range(channels_per_fpga) %}
+smi_native::Channel<SMI_Network_message, 16>& io_out_{{ channel }} = smi_native::network().channel<SMI_Network_message, 16>("emulated_channel_{{ channel_name(fpga.channels[channel], true) }}");
+smi_native::Channel<SMI_Network_message, 16>& io_in_{{ channel }} = smi_native::network().channel<SMI_Network_message, 16>("emulated_channel_{{ channel_name(fpga.channels[channel], false) }}");
+    {% endfor %}
+#endif
+{% endfor %}
+{% else %}
 #ifndef SMI_EMULATION_RANK
 {% for channel in channels %}
 channel SMI_Network_message io_out_{{ channel.index }} __attribute__((depth(16))) __attribute__((io("kernel_output_ch{{ channel.index }}")));
@@ -37,38 +77,66 @@ channel SMI_Network_message io_in_{{ channel }} __attribute__((depth(16))) __att
 #endif
 {% endfor %}
 #endif
+{% endif %}
 
 {% for op in program.operations %}
 // {{ op }}
-{% for (channel, depth) in op.get_channel_defs(program.p2p_rendezvous) %}
-channel SMI_Network_message {{ channel }} __attribute__((depth({{ depth }})));
+{% for (channel, depth) in op.get_channel_defs(program.is_p2p_rendezvous(op)) %}
+{{ smi_native.channel_decl(native, channel, depth) }};
 {% endfor %}
+{% if op in program.get_burst_ops() and op in program.get_ops_by_type("push") %}
+{{ smi_native.channel_decl(native, op.get_burst_channel(), program.burst_length) }};
+{% endif %}
 {% endfor %}
 
 __constant char QSFP_COUNT = {{ channels_per_fpga }};
 
 // connect all CK_S together
-channel SMI_Network_message channels_interconnect_ck_s[QSFP_COUNT*(QSFP_COUNT-1)] __attribute__((depth(16)));
+{{ smi_native.channel_decl(native, "channels_interconnect_ck_s[QSFP_COUNT*(QSFP_COUNT-1)]", 16) }};
 
 // connect all CK_R together
-channel SMI_Network_message channels_interconnect_ck_r[QSFP_COUNT*(QSFP_COUNT-1)] __attribute__((depth(16)));
+{{ smi_native.channel_decl(native, "channels_interconnect_ck_r[QSFP_COUNT*(QSFP_COUNT-1)]", 16) }};
 
 // connect corresponding CK_S/CK_R pairs
-channel SMI_Network_message channels_interconnect_ck_s_to_ck_r[QSFP_COUNT] __attribute__((depth(16)));
+{{ smi_native.channel_decl(native, "channels_interconnect_ck_s_to_ck_r[QSFP_COUNT]", 16) }};
 
 // connect corresponding CK_R/CK_S pairs
-channel SMI_Network_message channels_interconnect_ck_r_to_ck_s[QSFP_COUNT] __attribute__((depth(16)));
+{{ smi_native.channel_decl(native, "channels_interconnect_ck_r_to_ck_s[QSFP_COUNT]", vc_credits if program.virtual_channels else 16) }};
+{% if program.control_lane %}
+
+// control lane: same connections, used only by synchronization messages
+{{ smi_native.channel_decl(native, "channels_interconnect_ck_s_control[QSFP_COUNT*(QSFP_COUNT-1)]", 16) }};
+{{ smi_native.channel_decl(native, "channels_interconnect_ck_r_control[QSFP_COUNT*(QSFP_COUNT-1)]", 16) }};
+{{ smi_native.channel_decl(native, "channels_interconnect_ck_s_to_ck_r_control[QSFP_COUNT]", 16) }};
+{{ smi_native.channel_decl(native, "channels_interconnect_ck_r_to_ck_s_control[QSFP_COUNT]", 16) }};
+{% endif %}
+{% if program.virtual_channels %}
+
+// second virtual channel of the connections that forward messages between QSFP links (the depth of the CK_R/CK_S
+// ones is VC_CREDITS), and credits of the virtual channels received by CK_R for its CK_S
+{{ smi_native.channel_decl(native, "channels_interconnect_ck_s_vc1[QSFP_COUNT*(QSFP_COUNT-1)]", 16) }};
+{{ smi_native.channel_decl(native, "channels_interconnect_ck_r_to_ck_s_vc1[QSFP_COUNT]", vc_credits) }};
+{{ smi_native.channel_decl(native, "channels_interconnect_ck_r_to_ck_s_credits[QSFP_COUNT]", 16) }};
+{% endif %}
 
 #include "smi/pop.h"
+#include "smi/persistent.h"
 #include "smi/push.h"
 #include "smi/bcast.h"
 #include "smi/reduce.h"
+#include "smi/allreduce.h"
 #include "smi/scatter.h"
 #include "smi/gather.h"
+#include "smi/allgather.h"
+#include "smi/alltoall.h"
 #include "smi/communicator.h"
 
 {% for channel in channels %}
+{% if program.virtual_channels %}
+{{ smi_cks.smi_cks_vc(program, channel, channels|length, target_index) }}
+{% else %}
 {{ smi_cks.smi_cks(program, channel, channels|length, target_index) }}
+{% endif %}
 {{ smi_ckr.smi_ckr(program, channel, channels|length, target_index) }}
 {% endfor %}
 
@@ -100,3 +168,25 @@ channel SMI_Network_message channels_interconnect_ck_r_to_ck_s[QSFP_COUNT] __att
 {{ generate_op_impl("reduce", smi_reduce.smi_reduce_kernel) }}
 {{ generate_op_impl("reduce", smi_reduce.smi_reduce_channel) }}
 {{ generate_op_impl("reduce", smi_reduce.smi_reduce_impl) }}
+// Allreduce
+{{ generate_op_impl("allreduce", smi_allreduce.smi_allreduce_kernel) }}
+{{ generate_op_impl("allreduce", smi_allreduce.smi_allreduce_channel) }}
+{{ generate_op_impl("allreduce", smi_allreduce.smi_allreduce_impl) }}
+// Allgather
+{{ generate_op_impl("allgather", smi_allgather.smi_allgather_kernel) }}
+{{ generate_op_impl("allgather", smi_allgather.smi_allgather_channel) }}
+{{ generate_op_impl("allgather", smi_allgather.smi_allgather_impl) }}
+// Alltoall
+{{ generate_op_impl("alltoall", smi_alltoall.smi_alltoall_kernel) }}
+{{ generate_op_impl("alltoall", smi_alltoall.smi_alltoall_channel) }}
+{{ generate_op_impl("alltoall", smi_alltoall.smi_alltoall_impl) }}
+{%- if native %}
+
+
+{{ smi_native.smi_native_init(program, channels) }}
+
+// user kernels
+{% for source in sources %}
+#include "{{ source }}"
+{% endfor %}
+{% endif %}
@@ -1,28 +1,109 @@
 {% import 'utils.cl' as utils %}
 
 {%- macro smi_gather_kernel(program, op) -%}
-__kernel void smi_kernel_gather_{{ op.logical_port }}(char num_rank)
+__kernel void smi_kernel_gather_{{ op.logical_port }}(SMI_Rank num_rank)
 {
-    // receives the data from the application and
-    // forwards it to the root only when the SYNCH message arrives
+    // On the contributors, forwards the data of the application to the root as long as it has credits.
+    // On the root, grants credits to SMI_GATHER_CONCURRENCY contributors at a time: their packets are
+    // buffered by source and delivered to the application in rank order, so that the next contributors
+    // are already sending while the application receives the data of the current one.
+    // Every contributor has at most WINDOW packets in flight, which never exceeds the buffer of the CKR
+    // channel of the root, which would otherwise block any other message through its CKR
+    __constant int WINDOW = {{ op.buffer_size }};
+    __constant int CREDITS_BATCH = {{ op.credits_batch() }};
+    __constant int ELEMS_PER_PACKET = {{ op.data_elements_per_packet() }};
     SMI_Network_message mess;
     SMI_Network_message req;
+    SMI_Network_message buffer[SMI_GATHER_CONCURRENCY][WINDOW];     // packets received by the root, by source
+    int received[SMI_GATHER_CONCURRENCY];   // packets received from every contributor in the window
+    int granted[SMI_GATHER_CONCURRENCY];    // credits given to every contributor in the window
+    int credits = 0;                        // packets that a contributor can send to the root
 
     while (true)
     {
         mess = read_channel_intel({{ op.get_channel("gather") }});
-        if (GET_HEADER_OP(mess.header) == SMI_SYNCH)
+        if (GET_HEADER_OP(mess.header) == SMI_SYNCH && GET_HEADER_DST(mess.header) == GET_HEADER_SRC(mess.header))
         {
-            req = read_channel_intel({{ op.get_channel("ckr_control") }});
+            // the application of the root sends its rank and the number of elements of every contribution
+            const SMI_Rank root = GET_HEADER_SRC(mess.header);
+            const int count = *(int *) mess.data;
+            const int packets = (count + ELEMS_PER_PACKET - 1) / ELEMS_PER_PACKET;
+            const int num_contributors = num_rank - 1;   // contributors are numbered without the root
+            int first = 0;          // contributor whose data is being delivered to the application
+            int next = 0;           // next contributor that enters the window
+            int delivered = 0;      // packets of the first contributor delivered to the application
+            int consumed = 0;       // delivered packets since the last credits of the first contributor
+
+            SET_HEADER_OP(req.header, SMI_SYNCH);
+            SET_HEADER_PORT(req.header, {{ op.logical_port }});
+            SET_HEADER_SRC(req.header, root);
+
+            while (first != num_contributors)
+            {
+                const int slot = first % SMI_GATHER_CONCURRENCY;
+                if (next != num_contributors && next - first < SMI_GATHER_CONCURRENCY)
+                {
+                    // a new contributor enters the window: it can fill its buffer
+                    const int next_slot = next % SMI_GATHER_CONCURRENCY;
+                    received[next_slot] = 0;
+                    granted[next_slot] = MIN(WINDOW, packets);
+                    *(int *) req.data = granted[next_slot];
+                    SET_HEADER_DST(req.header, next < root ? next : next + 1);
+                    write_channel_intel({{ op.get_channel("cks_control") }}, req);
+                    next++;
+                }
+                else if (consumed >= CREDITS_BATCH && granted[slot] != packets)
+                {
+                    // the application consumed part of the buffer of the first contributor
+                    const int grant = MIN(consumed, packets - granted[slot]);
+                    granted[slot] += grant;
+                    *(int *) req.data = grant;
+                    SET_HEADER_DST(req.header, first < root ? first : first + 1);
+                    write_channel_intel({{ op.get_channel("cks_control") }}, req);
+                    consumed = 0;
+                }
+                else
+                {
+                    // deliver to the application and receive from the network in the same iteration
+                    if (delivered != received[slot])
+                    {
+                        if (write_channel_nb_intel({{ op.get_channel("gather_recv") }}, buffer[slot][delivered % WINDOW]))
+                        {
+                            delivered++;
+                            consumed++;
+                            if (delivered == packets)
+                            {
+                                first++;
+                                delivered = 0;
+                                consumed = 0;
+                            }
+                        }
+                    }
+                    bool valid = false;
+                    SMI_Network_message recvd = read_channel_nb_intel({{ op.get_channel("ckr_data") }}, &valid);
+                    if (valid)
+                    {
+                        const SMI_Rank src = GET_HEADER_SRC(recvd.header);
+                        const int contributor = src < root ? src : src - 1;
+                        const int src_slot = contributor % SMI_GATHER_CONCURRENCY;
+                        buffer[src_slot][received[src_slot] % WINDOW] = recvd;
+                        received[src_slot]++;
+                    }
+                }
+            }
+        }
+        else
+        {
+            // the credits of a gather are exactly the packets sent by the contributor
+            while (credits == 0)
+            {
+                req = read_channel_intel({{ op.get_channel("ckr_control") }});
+                credits = *(int *) req.data;
+            }
+            SET_HEADER_OP(mess.header, SMI_GATHER);
+            write_channel_intel({{ op.get_channel("cks_data") }}, mess);
+            credits--;
         }
-
-        // we introduce a dependency on the received synchronization message to
-        // force the ordering of the two channel operations
-
-        SET_HEADER_NUM_ELEMS(mess.header, MAX(GET_HEADER_NUM_ELEMS(mess.header), GET_HEADER_NUM_ELEMS(req.header)));
-
-        SET_HEADER_OP(mess.header, SMI_GATHER);
-        write_channel_intel({{ op.get_channel("cks_data") }}, mess);
     }
 }
 {%- endmacro %}
@@ -38,29 +119,21 @@ void {{ utils.impl_name_port_type("SMI_Gather", op) }}(SMI_GatherChannel* chan,
 {
     if (chan->my_rank == chan->root_rank) // I'm the root
     {
-        // we can't offload this part to the kernel, by passing a network message
-        // because it will replies to the root once every elem_per_packet cycles
-        // the root is responsible for receiving data from a contributor, after sending it a request
-        // for sending the data. If the contributor is itself it has to set the rcv_data accordingly
+        // the support kernel receives the data of several contributors at a time and delivers them in rank order.
+        // If the contributor is the root itself, it has to set the rcv_data accordingly
         const int message_size = chan->recv_count;
 
-        if (chan->next_contrib != chan->my_rank && chan->processed_elements_root == 0 ) // at the beginning we have to send the request
+        if (GET_HEADER_OP(chan->net_2.header) == SMI_SYNCH) // at the beginning we have to configure the support kernel
         {
-            // SMI_Network_message request;
-            SET_HEADER_OP(chan->net_2.header, SMI_SYNCH);
-            SET_HEADER_NUM_ELEMS(chan->net_2.header, 1); // this is used in the support kernel
-            SET_HEADER_DST(chan->net_2.header, chan->next_contrib);
-            SET_HEADER_PORT(chan->net_2.header, {{ op.logical_port }});
-            write_channel_intel({{ op.get_channel("cks_control") }}, chan->net_2);
+            *(int *) chan->net_2.data = message_size;
+            write_channel_intel({{ op.get_channel("gather") }}, chan->net_2);
+            SET_HEADER_OP(chan->net_2.header, SMI_GATHER);
         }
-        // This fence is not necessary, the two channel operation are independent
-        // and we don't need any ordering between them
-        // mem_fence(CLK_CHANNEL_MEM_FENCE);
 
         // receive the data
         if (chan->packet_element_id_rcv == 0 && chan->next_contrib != chan->my_rank)
         {
-            chan->net = read_channel_intel({{ op.get_channel("ckr_data") }});
+            chan->net = read_channel_intel({{ op.get_channel("gather_recv") }});
         }
 
         char* data_recvd = chan->net.data;
@@ -137,9 +210,9 @@ SMI_GatherChannel {{ utils.impl_name_port_type("SMI_Open_gather_channel", op) }}
     chan.send_count = send_count;
     chan.recv_count = recv_count;
     chan.data_type = data_type;
-    chan.my_rank = (char) SMI_Comm_rank(comm);
-    chan.root_rank = (char) root;
-    chan.num_rank = (char) SMI_Comm_size(comm);
+    chan.my_rank = (SMI_Rank) SMI_Comm_rank(comm);
+    chan.root_rank = (SMI_Rank) root;
+    chan.num_rank = (SMI_Rank) SMI_Comm_size(comm);
     chan.next_contrib = 0;
     chan.size_of_type = {{ op.data_size() }};
     chan.elements_per_packet = {{ op.data_elements_per_packet() }};
@@ -149,9 +222,10 @@ SMI_GatherChannel {{ utils.impl_name_port_type("SMI_Open_gather_channel", op) }}
     SET_HEADER_PORT(chan.net.header, chan.port);
     SET_HEADER_NUM_ELEMS(chan.net.header, 0);
     SET_HEADER_OP(chan.net.header, SMI_SYNCH);
-    // net_2 is used by the non-root ranks
+    // net_2 is used by the root rank to configure the support kernel
     SET_HEADER_OP(chan.net_2.header, SMI_SYNCH);
     SET_HEADER_PORT(chan.net_2.header, chan.port);
+    SET_HEADER_SRC(chan.net_2.header, chan.my_rank);
     SET_HEADER_DST(chan.net_2.header, chan.root_rank);
     chan.processed_elements = 0;
     chan.processed_elements_root = 0;
@@ -1,4 +1,9 @@
 #define __HOST_PROGRAM__
+{% if wide_ranks %}
+#ifndef SMI_WIDE_RANKS
+#define SMI_WIDE_RANKS
+#endif
+{% endif %}
 #include <utils/smi_utils.hpp>
 #include <vector>
 #include <smi/communicator.h>
@@ -35,8 +40,11 @@ SMI_Comm SmiInit_{{ name }}(
 
     {{ generate_collective_kernels("broadcast", "smi_kernel_bcast") }}
     {{ generate_collective_kernels("reduce", "smi_kernel_reduce") }}
+    {{ generate_collective_kernels("allreduce", "smi_kernel_allreduce") }}
     {{ generate_collective_kernels("scatter", "smi_kernel_scatter") }}
     {{ generate_collective_kernels("gather", "smi_kernel_gather") }}
+    {{ generate_collective_kernels("allgather", "smi_kernel_allgather") }}
+    {{ generate_collective_kernels("alltoall", "smi_kernel_alltoall") }}
 
     IntelFPGAOCLUtils::initEnvironment(
             platform, device, fpga, context,
@@ -45,7 +53,12 @@ SMI_Comm SmiInit_{{ name }}(
 
     // create buffers for CKS/CKR
     const int ports = {{ program.logical_port_count }};
+{% if program.wide_ranks %}
+    // two-level table: one entry per group of {{ program.rank_group_size }} ranks, one entry per rank of the local group
+    const int cks_table_size = (ranks_count + {{ program.rank_group_size - 1 }}) / {{ program.rank_group_size }} + {{ program.rank_group_size }};
+{% else %}
     const int cks_table_size = ranks_count;
+{% endif %}
     const int ckr_table_size = ports * 2;
     {% for channel in range(program.channel_count) %}
     cl::Buffer routing_table_ck_s_{{ channel }}(context, CL_MEM_READ_ONLY, cks_table_size);
@@ -66,18 +79,18 @@ SMI_Comm SmiInit_{{ name }}(
     queues[0].enqueueWriteBuffer(routing_table_ck_r_{{ channel }}, CL_TRUE, 0, ckr_table_size, &routing_tables_ckr[{{ channel }}][0]);
     {% endfor %}
 
-    char char_ranks_count=ranks_count;
-    char char_rank=rank;
+    SMI_Rank smi_ranks_count=ranks_count;
+    SMI_Rank smi_rank=rank;
     {% set ctx = namespace(kernel=0) %}
     {% for channel in range(program.channel_count) %}
     // cks_{{ channel }}
     kernels[{{ ctx.kernel }}].setArg(0, sizeof(cl_mem), &routing_table_ck_s_{{ channel }});
-    kernels[{{ ctx.kernel }}].setArg(1, sizeof(char), &char_ranks_count);
+    kernels[{{ ctx.kernel }}].setArg(1, sizeof(SMI_Rank), &smi_ranks_count);
 
     // ckr_{{ channel }}
     {% set ctx.kernel = ctx.kernel + 1 %}
     kernels[{{ ctx.kernel }}].setArg(0, sizeof(cl_mem), &routing_table_ck_r_{{ channel }});
-    kernels[{{ ctx.kernel }}].setArg(1, sizeof(char), &char_rank);
+    kernels[{{ ctx.kernel }}].setArg(1, sizeof(SMI_Rank), &smi_rank);
     {% set ctx.kernel = ctx.kernel + 1 %}
     {% endfor %}
 
@@ -85,14 +98,17 @@ SMI_Comm SmiInit_{{ name }}(
     {% set ops = program.get_ops_by_type(key) %}
     {% for op in ops %}
     // {{ key }} {{ op.logical_port }}
-    kernels[{{ ctx.kernel }}].setArg(0, sizeof(char), &char_ranks_count);
+    kernels[{{ ctx.kernel }}].setArg(0, sizeof(SMI_Rank), &smi_ranks_count);
     {% set ctx.kernel = ctx.kernel + 1 %}
     {% endfor %}
     {%- endmacro %}
     {{ setup_collective_kernels("broadcast") }}
     {{ setup_collective_kernels("reduce") }}
+    {{ setup_collective_kernels("allreduce") }}
     {{ setup_collective_kernels("scatter") }}
     {{ setup_collective_kernels("gather") }}
+    {{ setup_collective_kernels("allgather") }}
+    {{ setup_collective_kernels("alltoall") }}
 
     // move buffers
     {% for channel in range(program.channel_count) %}
@@ -109,7 +125,7 @@ SMI_Comm SmiInit_{{ name }}(
     }
 
     // return the communicator
-    SMI_Comm comm{ char_rank, char_ranks_count };
+    SMI_Comm comm{ smi_rank, smi_ranks_count };
     return comm;
 
 }
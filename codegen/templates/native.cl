@@ -0,0 +1,51 @@
+{%- macro channel_decl(native, name, depth) -%}
+{% if native %}
+smi_native::Channel<SMI_Network_message, {{ depth }}> {{ name }}
+{%- else %}
+channel SMI_Network_message {{ name }} __attribute__((depth({{ depth }})))
+{%- endif %}
+{%- endmacro %}
+
+{%- macro smi_native_init(program, channels) -%}
+/**
+ * @brief SmiInit loads the routing tables of the given rank and launches the support kernels
+ * as threads of the native runtime
+ */
+SMI_Comm SmiInit(int rank, int ranks_count, const char* routing_dir, smi_native::Runtime& runtime)
+{
+{% if program.wide_ranks %}
+    // two-level table: one entry per group of {{ program.rank_group_size }} ranks, one entry per rank of the local group
+    const int cks_table_size = (ranks_count + {{ program.rank_group_size - 1 }}) / {{ program.rank_group_size }} + {{ program.rank_group_size }};
+{% else %}
+    const int cks_table_size = ranks_count;
+{% endif %}
+    const int ckr_table_size = {{ program.logical_port_count }} * 2;
+    const SMI_Rank smi_ranks_count = ranks_count;
+    const SMI_Rank smi_rank = rank;
+
+    {% for channel in channels %}
+    // cks_{{ channel.index }}, ckr_{{ channel.index }}
+    char* routing_table_ck_s_{{ channel.index }} = runtime.allocate(cks_table_size);
+    char* routing_table_ck_r_{{ channel.index }} = runtime.allocate(ckr_table_size);
+    smi_native::load_routing_table(rank, {{ channel.index }}, cks_table_size, routing_dir, "cks", routing_table_ck_s_{{ channel.index }});
+    smi_native::load_routing_table(rank, {{ channel.index }}, ckr_table_size, routing_dir, "ckr", routing_table_ck_r_{{ channel.index }});
+    runtime.launch(smi_kernel_cks_{{ channel.index }}, routing_table_ck_s_{{ channel.index }}, smi_ranks_count);
+    runtime.launch(smi_kernel_ckr_{{ channel.index }}, routing_table_ck_r_{{ channel.index }}, smi_rank);
+
+    {% endfor %}
+    {%- macro launch_collective_kernels(key, kernel_name) %}
+    {% for op in program.get_ops_by_type(key) %}
+    runtime.launch({{ kernel_name }}_{{ op.logical_port }}, smi_ranks_count);
+    {% endfor %}
+    {%- endmacro %}
+    {{ launch_collective_kernels("broadcast", "smi_kernel_bcast") }}
+    {{ launch_collective_kernels("reduce", "smi_kernel_reduce") }}
+    {{ launch_collective_kernels("allreduce", "smi_kernel_allreduce") }}
+    {{ launch_collective_kernels("scatter", "smi_kernel_scatter") }}
+    {{ launch_collective_kernels("gather", "smi_kernel_gather") }}
+    {{ launch_collective_kernels("allgather", "smi_kernel_allgather") }}
+    {{ launch_collective_kernels("alltoall", "smi_kernel_alltoall") }}
+
+    return SMI_Comm(smi_rank, smi_ranks_count);
+}
+{%- endmacro %}
@@ -0,0 +1,39 @@
+{% if message_width != 256 %}
+#define SMI_MESSAGE_WIDTH {{ message_width }}
+{% endif %}
+{% if wide_ranks %}
+#define SMI_WIDE_RANKS
+{% endif %}
+#include <utils/native_utils.hpp>
+
+// every rank gets its own copy of the channels and kernels of its program
+{% for (fpga, name, device_src) in ranks %}
+// rank {{ fpga.rank }}: {{ fpga.key() }} ({{ name }})
+#define SMI_EMULATION_RANK {{ fpga.rank }}
+namespace smi_rank_{{ fpga.rank }}
+{
+#include "{{ device_src }}"
+}
+#undef SMI_EMULATION_RANK
+
+{% endfor %}
+{% for (name, program_ranks) in programs %}
+SMI_Comm SmiInit_{{ name }}(int rank, int ranks_count, const char* routing_dir, smi_native::Runtime& runtime)
+{
+    switch (rank)
+    {
+        {% for fpga in program_ranks %}
+        case {{ fpga.rank }}: return smi_rank_{{ fpga.rank }}::SmiInit(rank, ranks_count, routing_dir, runtime);
+        {% endfor %}
+    }
+    throw std::runtime_error("Rank " + std::to_string(rank) + " does not execute program {{ name }}");
+}
+
+// returns a pointer to the kernel NAME of program {{ name }} running on rank RANK
+#define SmiKernel_{{ name }}(RANK, NAME) ( \
+    {% for fpga in program_ranks %}
+    (RANK) == {{ fpga.rank }} ? &smi_rank_{{ fpga.rank }}::NAME : \
+    {% endfor %}
+    nullptr)
+
+{% endfor %}
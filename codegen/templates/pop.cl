@@ -1,54 +1,223 @@
 {% import 'utils.cl' as utils %}
 
+{#- Unpacks the next element of the received packet and returns the tokens to the sender (after the packet has been read) -#}
+{%- macro pop_element(program, op) %}
+    chan->processed_elements++;
+{% if op in program.get_burst_ops() %}
+{{ utils.unpack(op, "chan->net.padding_", "chan->packet_element_id", "data", op.burst_elements_per_packet()) }}
+{% else %}
+{{ utils.unpack(op, "chan->net.data", "chan->packet_element_id", "data", op.data_elements_per_packet()) }}
+{% endif %}
+
+    chan->packet_element_id++;
+{% if op in program.get_burst_ops() %}
+    if (chan->packet_element_id == (chan->burst_flits == 0 ? chan->burst_last_elems : chan->elements_per_packet))
+{% else %}
+    if (chan->packet_element_id == GET_HEADER_NUM_ELEMS(chan->net.header))
+{% endif %}
+    {
+{% if program.is_p2p_rendezvous(op) and program.is_any_source(op) %}
+        // the packets of different senders are interleaved: the tokens of every packet are returned to its sender
+        SMI_Network_message mess;
+        *(unsigned int*) mess.data = chan->packet_element_id;
+        SET_HEADER_DST(mess.header, chan->sender_rank);
+        SET_HEADER_PORT(mess.header, chan->port);
+        SET_HEADER_OP(mess.header, SMI_SYNCH);
+        write_channel_intel({{ op.get_channel("cks_control") }}, mess);
+{% endif %}
+        chan->packet_element_id = 0;
+    }
+    // TODO: This is used to prevent this funny compiler to re-oder the two *_channel_intel operations
+    // mem_fence(CLK_CHANNEL_MEM_FENCE);
+{% if program.is_p2p_rendezvous(op) and not program.is_any_source(op) %}
+    //echange tokens
+    chan->tokens--;
+    if (chan->tokens == 0)
+    {
+        // At this point, the sender has still the tokens of the round trip (max_tokens minus a batch): we have to
+        // consider this while we send the new tokens to it. On a persistent channel the messages never end for the
+        // tokens: the remaining ones are returned when the channel is freed
+        unsigned int sender = chan->persistent ? {{ op.p2p_tokens_batch() }} :
+            ((int) ((int) chan->message_size - (int) chan->processed_elements - (int) (chan->max_tokens - {{ op.p2p_tokens_batch() }}))) < 0 ? 0: chan->message_size - chan->processed_elements - (chan->max_tokens - {{ op.p2p_tokens_batch() }});
+        chan->tokens = (unsigned int) (MIN({{ op.p2p_tokens_batch() }}, sender));
+        SMI_Network_message mess;
+        *(unsigned int*) mess.data = chan->tokens;
+        SET_HEADER_DST(mess.header, chan->sender_rank);
+        SET_HEADER_PORT(mess.header, chan->port);
+        SET_HEADER_OP(mess.header, SMI_SYNCH);
+        write_channel_intel({{ op.get_channel("cks_control") }}, mess);
+    }
+{% endif %}
+{%- endmacro %}
+
 {%- macro smi_pop_impl(program, op) -%}
 void {{ utils.impl_name_port_type("SMI_Pop", op) }}(SMI_Channel *chan, void *data)
 {
     // in this case we have to copy the data into the target variable
     if (chan->packet_element_id == 0)
     {
+{% if op in program.get_burst_ops() %}
+        if (chan->burst_flits == 0)
+        {
+            // a new burst starts with its header flit
+            SMI_Network_message header = read_channel_intel({{ op.get_channel("ckr_data") }});
+            chan->burst_flits = GET_HEADER_NUM_ELEMS(header.header);
+            chan->burst_last_elems = header.data[0];
+{% if program.is_any_source(op) %}
+            chan->sender_rank = GET_HEADER_SRC(header.header);  // the source of the received data
+{% endif %}
+        }
+        // no data to be unpacked...receive the next payload flit
+        chan->net = read_channel_intel({{ op.get_channel("ckr_data") }});
+        chan->burst_flits--;
+{% else %}
         // no data to be unpacked...receive from the network
         chan->net = read_channel_intel({{ op.get_channel("ckr_data") }});
+{% if program.is_any_source(op) %}
+        chan->sender_rank = GET_HEADER_SRC(chan->net.header);  // the source of the received data
+{% endif %}
+{% endif %}
     }
-    chan->processed_elements++;
-    char *data_recvd = chan->net.data;
-
-    #pragma unroll
-    for (int ee = 0; ee < {{ op.data_elements_per_packet() }}; ee++)
+{{ pop_element(program, op) }}
+}
+int {{ utils.impl_name_port_type("SMI_Pop_nb", op) }}(SMI_Channel *chan, void *data)
+{
+    if (chan->packet_element_id == 0)
     {
-        if (ee == chan->packet_element_id)
+        // the element is popped only if a packet has arrived: the channel is left untouched otherwise
+        bool valid = false;
+{% if op in program.get_burst_ops() %}
+        if (chan->burst_flits == 0)
         {
-            #pragma unroll
-            for (int jj = 0; jj < {{ op.data_size() }}; jj++)
+            SMI_Network_message header = read_channel_nb_intel({{ op.get_channel("ckr_data") }}, &valid);
+            if (!valid)
             {
-                ((char *)data)[jj] = data_recvd[(ee * {{ op.data_size() }}) + jj];
+                return 0;
             }
+            chan->burst_flits = GET_HEADER_NUM_ELEMS(header.header);
+            chan->burst_last_elems = header.data[0];
+{% if program.is_any_source(op) %}
+            chan->sender_rank = GET_HEADER_SRC(header.header);  // the source of the received data
+{% endif %}
+            // the payload flits are sent right after the header
+            chan->net = read_channel_intel({{ op.get_channel("ckr_data") }});
         }
+        else
+        {
+            SMI_Network_message mess = read_channel_nb_intel({{ op.get_channel("ckr_data") }}, &valid);
+            if (!valid)
+            {
+                return 0;
+            }
+            chan->net = mess;
+        }
+        chan->burst_flits--;
+{% else %}
+        SMI_Network_message mess = read_channel_nb_intel({{ op.get_channel("ckr_data") }}, &valid);
+        if (!valid)
+        {
+            return 0;
+        }
+        chan->net = mess;
+{% if program.is_any_source(op) %}
+        chan->sender_rank = GET_HEADER_SRC(chan->net.header);  // the source of the received data
+{% endif %}
+{% endif %}
+    }
+{{ pop_element(program, op) }}
+    return 1;
+}
+void {{ utils.impl_name_port_type("SMI_Pop_vec", op) }}(SMI_Channel *chan, void *data)
+{
+    // a whole packet is copied at once: no per element selection of the position
+{% if op in program.get_burst_ops() %}
+    if (chan->burst_flits == 0)
+    {
+        // a new burst starts with its header flit
+        SMI_Network_message header = read_channel_intel({{ op.get_channel("ckr_data") }});
+        chan->burst_flits = GET_HEADER_NUM_ELEMS(header.header);
+        chan->burst_last_elems = header.data[0];
+{% if program.is_any_source(op) %}
+        chan->sender_rank = GET_HEADER_SRC(header.header);  // the source of the received data
+{% endif %}
     }
+    chan->net = read_channel_intel({{ op.get_channel("ckr_data") }});
+    chan->burst_flits--;
+    unsigned int elems = chan->burst_flits == 0 ? chan->burst_last_elems : chan->elements_per_packet;
 
-    chan->packet_element_id++;
-    if (chan->packet_element_id == GET_HEADER_NUM_ELEMS(chan->net.header))
+    #pragma unroll
+    for (int jj = 0; jj < {{ op.burst_elements_per_packet() * op.data_size() }}; jj++)
     {
-        chan->packet_element_id = 0;
+        ((char *)data)[jj] = chan->net.padding_[jj];
     }
-    // TODO: This is used to prevent this funny compiler to re-oder the two *_channel_intel operations
-    // mem_fence(CLK_CHANNEL_MEM_FENCE);
-    #if defined P2P_RENDEZVOUS
-    //echange tokens
-    chan->tokens--;
-    if (chan->tokens == 0)
+{% else %}
+    chan->net = read_channel_intel({{ op.get_channel("ckr_data") }});
+    unsigned int elems = GET_HEADER_NUM_ELEMS(chan->net.header);
+{% if program.is_any_source(op) %}
+    chan->sender_rank = GET_HEADER_SRC(chan->net.header);  // the source of the received data
+{% endif %}
+
+    #pragma unroll
+    for (int jj = 0; jj < {{ op.data_elements_per_packet() * op.data_size() }}; jj++)
+    {
+        ((char *)data)[jj] = chan->net.data[jj];
+    }
+{% endif %}
+{% if program.is_p2p_rendezvous(op) and program.is_any_source(op) %}
+    // the tokens of the packet are returned to its sender (see SMI_Pop)
+    SMI_Network_message mess;
+    *(unsigned int*) mess.data = elems;
+    SET_HEADER_DST(mess.header, chan->sender_rank);
+    SET_HEADER_PORT(mess.header, chan->port);
+    SET_HEADER_OP(mess.header, SMI_SYNCH);
+    write_channel_intel({{ op.get_channel("cks_control") }}, mess);
+    chan->processed_elements += elems;
+{% elif program.is_p2p_rendezvous(op) %}
+    // one token per data element: new tokens are sent to the sender every time they are exhausted
+    while (elems > 0)
+    {
+        // no tokens left only after the last (empty) tokens message: as in SMI_Pop, the counter wraps around
+        const unsigned int consumed = chan->tokens == 0 ? elems : MIN(elems, chan->tokens);
+        chan->tokens -= consumed;
+        chan->processed_elements += consumed;
+        elems -= consumed;
+        if (chan->tokens == 0)
+        {
+            unsigned int sender = chan->persistent ? {{ op.p2p_tokens_batch() }} :
+                ((int) ((int) chan->message_size - (int) chan->processed_elements - (int) (chan->max_tokens - {{ op.p2p_tokens_batch() }}))) < 0 ? 0: chan->message_size - chan->processed_elements - (chan->max_tokens - {{ op.p2p_tokens_batch() }});
+            chan->tokens = (unsigned int) (MIN({{ op.p2p_tokens_batch() }}, sender));
+            SMI_Network_message mess;
+            *(unsigned int*) mess.data = chan->tokens;
+            SET_HEADER_DST(mess.header, chan->sender_rank);
+            SET_HEADER_PORT(mess.header, chan->port);
+            SET_HEADER_OP(mess.header, SMI_SYNCH);
+            write_channel_intel({{ op.get_channel("cks_control") }}, mess);
+        }
+    }
+{% else %}
+    chan->processed_elements += elems;
+{% endif %}
+}
+void {{ utils.impl_name_port_type("SMI_Start_pop", op) }}(SMI_Channel *chan)
+{
+    // a new message on the persistent channel: the tokens are returned as if the messages were a single stream
+    chan->processed_elements = 0;
+}
+void {{ utils.impl_name_port_type("SMI_Free_channel_pop", op) }}(SMI_Channel *chan)
+{
+{% if program.is_p2p_rendezvous(op) and not program.is_any_source(op) %}
+    // return the tokens of the elements received since the last tokens message
+    const unsigned int tokens = {{ op.p2p_tokens_batch() }} - chan->tokens;
+    if (tokens != 0)
     {
-        // At this point, the sender has still max_tokens*7/8 tokens: we have to consider this while we send
-        // the new tokens to it
-        unsigned int sender = ((int) ((int) chan->message_size - (int) chan->processed_elements - (int) chan->max_tokens * 7 / 8)) < 0 ? 0: chan->message_size - chan->processed_elements - chan -> max_tokens * 7 / 8;
-        chan->tokens = (unsigned int) (MIN(chan->max_tokens / 8, sender)); // b/2
         SMI_Network_message mess;
-        *(unsigned int*) mess.data = chan->tokens;
+        *(unsigned int*) mess.data = tokens;
         SET_HEADER_DST(mess.header, chan->sender_rank);
         SET_HEADER_PORT(mess.header, chan->port);
         SET_HEADER_OP(mess.header, SMI_SYNCH);
         write_channel_intel({{ op.get_channel("cks_control") }}, mess);
     }
-    #endif
+{% endif %}
 }
 {%- endmacro %}
 
@@ -58,26 +227,41 @@ SMI_Channel {{ utils.impl_name_port_type("SMI_Open_receive_channel", op) }}(int
     SMI_Channel chan;
     // setup channel descriptor
     chan.port = (char) port;
-    chan.sender_rank = (char) source;
+    chan.sender_rank = (SMI_Rank) source;
     chan.message_size = (unsigned int) count;
     chan.data_type = data_type;
     chan.op_type = SMI_RECEIVE;
+{% if op in program.get_burst_ops() %}
+    chan.elements_per_packet = {{ op.burst_elements_per_packet() }};
+    chan.burst_flits = 0;   // no burst in progress
+{% else %}
     chan.elements_per_packet = {{ op.data_elements_per_packet() }};
-    chan.max_tokens = {{ op.buffer_size * op.data_elements_per_packet() }};
+{% endif %}
+    chan.max_tokens = {{ op.p2p_window() * op.data_elements_per_packet() }};   // the window grows with the hops
 
-#if defined P2P_RENDEZVOUS
-    chan.tokens = MIN(chan.max_tokens / ((unsigned int) 8), count); // needed to prevent the compiler to optimize-away channel connections
-#else
+{% if program.is_p2p_rendezvous(op) %}
+    chan.tokens = MIN((unsigned int) {{ op.p2p_tokens_batch() }}, count); // needed to prevent the compiler to optimize-away channel connections
+{% else %}
     chan.tokens = count; // in this way, the last rendezvous is done at the end of the message. This is needed to prevent the compiler to cut-away internal FIFO buffer connections
-#endif
-    // The receiver sends tokens to the sender once every chan.max_tokens/8 received data elements
-    // chan.tokens = chan.max_tokens / ((unsigned int) 8);
+{% endif %}
+    // The receiver sends tokens to the sender once every batch of received data elements, that grows with the hops
     SET_HEADER_NUM_ELEMS(chan.net.header, 0);    // at the beginning no data
     chan.packet_element_id = 0; // data per packet
     chan.processed_elements = 0;
+    chan.persistent = 0;
     chan.sender_rank = chan.sender_rank;
     chan.receiver_rank = comm[0];
     // comm is not directly used in this first implementation
     return chan;
 }
+SMI_Channel {{ utils.impl_name_port_type("SMI_Open_persistent_receive_channel", op) }}(int count, SMI_Datatype data_type, int source, int port, SMI_Comm comm)
+{
+    SMI_Channel chan = {{ utils.impl_name_port_type("SMI_Open_receive_channel", op) }}(count, data_type, source, port, comm);
+    chan.persistent = 1;
+{% if program.is_p2p_rendezvous(op) %}
+    // the tokens are returned every batch of received elements and the remaining ones when the channel is freed
+    chan.tokens = {{ op.p2p_tokens_batch() }};
+{% endif %}
+    return chan;
+}
 {%- endmacro -%}
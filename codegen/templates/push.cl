@@ -4,7 +4,34 @@
 void {{ utils.impl_name_port_type("SMI_Push_flush", op) }}(SMI_Channel *chan, void* data, int immediate)
 {
     char* conv = (char*) data;
-    COPY_DATA_TO_NET_MESSAGE(chan, chan->net, conv);
+{% if op in program.get_burst_ops() %}
+    // burst payload flits have no header: the data elements fill the whole network message
+{{ utils.pack(op, "chan->net.padding_", "chan->packet_element_id", "conv", op.burst_elements_per_packet()) }}
+    chan->processed_elements++;
+    chan->packet_element_id++;
+
+    // stage the payload flit if it full or we reached the message size
+    if (chan->packet_element_id == chan->elements_per_packet || immediate || chan->processed_elements == chan->message_size)
+    {
+        write_channel_intel({{ op.get_burst_channel() }}, chan->net);
+        chan->burst_flits++;
+        // the header flit is sent once the whole burst is staged: CK_S forwards the burst without interruptions
+        if (chan->burst_flits == {{ program.burst_length }} || immediate || chan->processed_elements == chan->message_size)
+        {
+            SMI_Network_message header;
+            SET_HEADER_DST(header.header, chan->receiver_rank);
+            SET_HEADER_SRC(header.header, chan->sender_rank);
+            SET_HEADER_PORT(header.header, chan->port);
+            SET_HEADER_OP(header.header, SMI_BURST);
+            SET_HEADER_NUM_ELEMS(header.header, chan->burst_flits);
+            header.data[0] = chan->packet_element_id;   // valid data elements in the last flit
+            write_channel_intel({{ op.get_channel("cks_data") }}, header);
+            chan->burst_flits = 0;
+        }
+        chan->packet_element_id = 0;
+    }
+{% else %}
+{{ utils.pack(op, "chan->net.data", "chan->packet_element_id", "conv", op.data_elements_per_packet()) }}
     chan->processed_elements++;
     chan->packet_element_id++;
 
@@ -15,10 +42,20 @@ void {{ utils.impl_name_port_type("SMI_Push_flush", op) }}(SMI_Channel *chan, vo
         chan->packet_element_id = 0;
         write_channel_intel({{ op.get_channel("cks_data") }}, chan->net);
     }
+{% endif %}
     // This fence is not mandatory, the two channel operations can be
     // performed independently
     // mem_fence(CLK_CHANNEL_MEM_FENCE);
-    #if defined P2P_RENDEZVOUS
+{% if program.is_p2p_rendezvous(op) and program.is_any_source(op) %}
+    chan->tokens--;
+    // the receiver returns the tokens of every packet: wait for them when they are exhausted, and for all of them
+    // at the end of the message, so that none is left for the next channel on the port
+    while (chan->tokens == 0 || (chan->processed_elements == chan->message_size && chan->tokens != chan->max_tokens))
+    {
+        SMI_Network_message mess = read_channel_intel({{ op.get_channel("ckr_control") }});
+        chan->tokens += *(unsigned int *) mess.data;
+    }
+{% elif program.is_p2p_rendezvous(op) %}
     chan->tokens--;
     if (chan->tokens == 0)
     {
@@ -28,12 +65,174 @@ void {{ utils.impl_name_port_type("SMI_Push_flush", op) }}(SMI_Channel *chan, vo
         unsigned int tokens = *(unsigned int *) mess.data;
         chan->tokens += tokens; // tokens
     }
-    #endif
+{% endif %}
 }
 void {{ utils.impl_name_port_type("SMI_Push", op) }}(SMI_Channel *chan, void* data)
 {
     {{ utils.impl_name_port_type("SMI_Push_flush", op) }}(chan, data, 0);
 }
+void {{ utils.impl_name_port_type("SMI_Push_vec", op) }}(SMI_Channel *chan, void* data)
+{
+    char* conv = (char*) data;
+    // a whole packet is filled with a single copy: no per element selection of the position
+    const unsigned int remaining = chan->message_size - chan->processed_elements;
+    unsigned int elems = MIN(remaining, (unsigned int) chan->elements_per_packet);
+{% if program.is_p2p_rendezvous(op) %}
+    // the tokens of the whole packet are needed before it is sent, so that the window is never exceeded
+    while (chan->tokens < elems)
+    {
+        SMI_Network_message mess = read_channel_intel({{ op.get_channel("ckr_control") }});
+        chan->tokens += *(unsigned int *) mess.data;
+    }
+{% endif %}
+{% if op in program.get_burst_ops() %}
+    #pragma unroll
+    for (int jj = 0; jj < {{ op.burst_elements_per_packet() * op.data_size() }}; jj++)
+    {
+        chan->net.padding_[jj] = conv[jj];
+    }
+    chan->processed_elements += elems;
+    write_channel_intel({{ op.get_burst_channel() }}, chan->net);
+    chan->burst_flits++;
+    if (chan->burst_flits == {{ program.burst_length }} || chan->processed_elements == chan->message_size)
+    {
+        SMI_Network_message header;
+        SET_HEADER_DST(header.header, chan->receiver_rank);
+        SET_HEADER_SRC(header.header, chan->sender_rank);
+        SET_HEADER_PORT(header.header, chan->port);
+        SET_HEADER_OP(header.header, SMI_BURST);
+        SET_HEADER_NUM_ELEMS(header.header, chan->burst_flits);
+        header.data[0] = elems;     // valid data elements in the last flit
+        write_channel_intel({{ op.get_channel("cks_data") }}, header);
+        chan->burst_flits = 0;
+    }
+{% else %}
+    #pragma unroll
+    for (int jj = 0; jj < {{ op.data_elements_per_packet() * op.data_size() }}; jj++)
+    {
+        chan->net.data[jj] = conv[jj];
+    }
+    chan->processed_elements += elems;
+    SET_HEADER_NUM_ELEMS(chan->net.header, elems);
+    write_channel_intel({{ op.get_channel("cks_data") }}, chan->net);
+{% endif %}
+{% if program.is_p2p_rendezvous(op) and program.is_any_source(op) %}
+    chan->tokens -= elems;
+    while (chan->processed_elements == chan->message_size && chan->tokens != chan->max_tokens)
+    {
+        SMI_Network_message mess = read_channel_intel({{ op.get_channel("ckr_control") }});
+        chan->tokens += *(unsigned int *) mess.data;
+    }
+{% elif program.is_p2p_rendezvous(op) %}
+    // one token per data element: as in SMI_Push, the next tokens message (or the rendezvous at the end of the
+    // message) is received when they are exhausted
+    chan->tokens -= elems;
+    if (chan->tokens == 0)
+    {
+        SMI_Network_message mess = read_channel_intel({{ op.get_channel("ckr_control") }});
+        unsigned int tokens = *(unsigned int *) mess.data;
+        chan->tokens += tokens; // tokens
+    }
+{% endif %}
+}
+int {{ utils.impl_name_port_type("SMI_Push_nb", op) }}(SMI_Channel *chan, void* data)
+{
+{% if program.is_p2p_rendezvous(op) %}
+    if (chan->tokens == 0)
+    {
+        // the tokens did not arrive during the previous call
+        bool valid = false;
+        SMI_Network_message mess = read_channel_nb_intel({{ op.get_channel("ckr_control") }}, &valid);
+        if (!valid)
+        {
+            return 0;
+        }
+        chan->tokens += *(unsigned int *) mess.data;
+    }
+{% endif %}
+    char* conv = (char*) data;
+    // the element is pushed only if the packet can be sent: the channel is left untouched otherwise
+    const bool last = chan->packet_element_id + 1 == chan->elements_per_packet || chan->processed_elements + 1 == chan->message_size;
+{% if op in program.get_burst_ops() %}
+{{ utils.pack(op, "chan->net.padding_", "chan->packet_element_id", "conv", op.burst_elements_per_packet()) }}
+    if (last)
+    {
+        if (!write_channel_nb_intel({{ op.get_burst_channel() }}, chan->net))
+        {
+            return 0;
+        }
+        chan->burst_flits++;
+        if (chan->burst_flits == {{ program.burst_length }} || chan->processed_elements + 1 == chan->message_size)
+        {
+            // the payload flits are already staged: CK_S is waiting for the header
+            SMI_Network_message header;
+            SET_HEADER_DST(header.header, chan->receiver_rank);
+            SET_HEADER_SRC(header.header, chan->sender_rank);
+            SET_HEADER_PORT(header.header, chan->port);
+            SET_HEADER_OP(header.header, SMI_BURST);
+            SET_HEADER_NUM_ELEMS(header.header, chan->burst_flits);
+            header.data[0] = chan->packet_element_id + 1;   // valid data elements in the last flit
+            write_channel_intel({{ op.get_channel("cks_data") }}, header);
+            chan->burst_flits = 0;
+        }
+    }
+{% else %}
+{{ utils.pack(op, "chan->net.data", "chan->packet_element_id", "conv", op.data_elements_per_packet()) }}
+    if (last)
+    {
+        SET_HEADER_NUM_ELEMS(chan->net.header, chan->packet_element_id + 1);
+        if (!write_channel_nb_intel({{ op.get_channel("cks_data") }}, chan->net))
+        {
+            return 0;
+        }
+    }
+{% endif %}
+    chan->packet_element_id = last ? 0 : chan->packet_element_id + 1;
+    chan->processed_elements++;
+{% if program.is_p2p_rendezvous(op) and program.is_any_source(op) %}
+    // the exhausted tokens are waited for by the next call, all of them at the end of the message (see SMI_Push)
+    chan->tokens--;
+    while (chan->processed_elements == chan->message_size && chan->tokens != chan->max_tokens)
+    {
+        SMI_Network_message mess = read_channel_intel({{ op.get_channel("ckr_control") }});
+        chan->tokens += *(unsigned int *) mess.data;
+    }
+{% elif program.is_p2p_rendezvous(op) %}
+    chan->tokens--;
+    if (chan->tokens == 0)
+    {
+        bool valid = false;
+        SMI_Network_message mess = read_channel_nb_intel({{ op.get_channel("ckr_control") }}, &valid);
+        if (!valid && chan->processed_elements == chan->message_size)
+        {
+            // the rendezvous at the end of the message
+            mess = read_channel_intel({{ op.get_channel("ckr_control") }});
+            valid = true;
+        }
+        if (valid)
+        {
+            chan->tokens += *(unsigned int *) mess.data;
+        }
+    }
+{% endif %}
+    return 1;
+}
+void {{ utils.impl_name_port_type("SMI_Start_push", op) }}(SMI_Channel *chan)
+{
+    // a new message on the persistent channel: the tokens of the previous ones are kept
+    chan->processed_elements = 0;
+}
+void {{ utils.impl_name_port_type("SMI_Free_channel_push", op) }}(SMI_Channel *chan)
+{
+{% if program.is_p2p_rendezvous(op) %}
+    // receive the tokens that are still in flight: the receiver returns all of them when it frees the channel
+    while (chan->tokens != chan->max_tokens)
+    {
+        SMI_Network_message mess = read_channel_intel({{ op.get_channel("ckr_control") }});
+        chan->tokens += *(unsigned int *) mess.data;
+    }
+{% endif %}
+}
 {%- endmacro %}
 
 {%- macro smi_push_channel(program, op) -%}
@@ -45,26 +244,51 @@ SMI_Channel {{ utils.impl_name_port_type("SMI_Open_send_channel", op) }}(int cou
     chan.message_size = (unsigned int) count;
     chan.data_type = data_type;
     chan.op_type = SMI_SEND;
-    chan.receiver_rank = (char) destination;
+    chan.receiver_rank = (SMI_Rank) destination;
     // At the beginning, the sender can sends as many data items as the buffer size
     // in the receiver allows
+{% if op in program.get_burst_ops() %}
+    chan.elements_per_packet = {{ op.burst_elements_per_packet() }};
+    chan.burst_flits = 0;
+{% else %}
     chan.elements_per_packet = {{ op.data_elements_per_packet() }};
-    chan.max_tokens = {{ op.buffer_size * op.data_elements_per_packet() }};
+{% endif %}
+    chan.max_tokens = {{ op.p2p_window() * op.data_elements_per_packet() }};   // the window grows with the hops
 
     // setup header for the message
     SET_HEADER_DST(chan.net.header, chan.receiver_rank);
     SET_HEADER_PORT(chan.net.header, chan.port);
     SET_HEADER_OP(chan.net.header, SMI_SEND);
-#if defined P2P_RENDEZVOUS
+{% if program.is_p2p_rendezvous(op) and program.is_any_source(op) %}
+    // the buffer of the receiver is shared by all the ranks that can send to it: every sender has a share of it
+    chan.max_tokens = {{ program.get_any_source_tokens(op) }};
+    chan.tokens = chan.max_tokens;
+{% elif program.is_p2p_rendezvous(op) %}
+    // short messages fit in the window and are sent without waiting: the sender waits only at the end for the
+    // acknowledgement of the receiver (see SMI_Open_receive_channel)
     chan.tokens = MIN(chan.max_tokens, count); // needed to prevent the compiler to optimize-away channel connections
-#else // eager transmission protocol
+{% else %}
+    // eager transmission protocol
     chan.tokens = count;  // in this way, the last rendezvous is done at the end of the message. This is needed to prevent the compiler to cut-away internal FIFO buffer connections
-#endif
+{% endif %}
     chan.receiver_rank = destination;
     chan.processed_elements = 0;
     chan.packet_element_id = 0;
+    chan.persistent = 0;
     chan.sender_rank = comm[0];
+    SET_HEADER_SRC(chan.net.header, chan.sender_rank);     // the receiver can accept data from any source
     // chan.comm = comm; // comm is not used in this first implemenation
     return chan;
 }
+SMI_Channel {{ utils.impl_name_port_type("SMI_Open_persistent_send_channel", op) }}(int count, SMI_Datatype data_type, int destination, int port, SMI_Comm comm)
+{
+    SMI_Channel chan = {{ utils.impl_name_port_type("SMI_Open_send_channel", op) }}(count, data_type, destination, port, comm);
+    chan.persistent = 1;
+{% if program.is_p2p_rendezvous(op) %}
+    // the whole window is available to the first message and the following ones reuse the returned tokens,
+    // without a rendezvous at the end of every message
+    chan.tokens = chan.max_tokens;
+{% endif %}
+    return chan;
+}
 {%- endmacro -%}
@@ -3,31 +3,58 @@
 {%- macro smi_reduce_kernel(program, op) -%}
 #include "smi/reduce_operations.h"
 
-__kernel void smi_kernel_reduce_{{ op.logical_port }}(char num_rank)
+__kernel void smi_kernel_reduce_{{ op.logical_port }}(SMI_Rank num_rank)
 {
     __constant int SHIFT_REG = {{ op.shift_reg() }};
+    __constant int ELEMS_PER_PACKET = {{ op.data_elements_per_packet() }};
 
+    // the ranks form a tree with `fanout` children per rank, numbered relative to the root (fanout 0: all the
+    // other ranks are children of the root). Every rank combines its contribution with the partial results of its
+    // children and forwards the result to its parent, which gives credits to its children only.
+    // Contributions and partial results are packed: the reduce is applied lane-wise, one lane per element of the
+    // packet, and a credit is given for every packet. The root receives its own contribution one element at a time,
+    // since the application waits for the reduced element before sending the next one
     SMI_Network_message mess;
     SMI_Network_message reduce;
     char sender_id = 0;
     const char credits_flow_control = 16; // choose it in order to have II=1
-    // reduced results, organized in shift register to mask latency (of the design, not related to the particular operation used)
-    {{ op.data_type }} __attribute__((register)) reduce_result[credits_flow_control][SHIFT_REG + 1];
-    char data_recvd[credits_flow_control];
-    bool send_credits = false; // true if (the root) has to send reduce request
-    char credits = credits_flow_control; // the number of credits that I have
-    char send_to = 0;
-    char add_to[MAX_RANKS];   // for each rank tells to what element in the buffer we should add the received item
+    // reduced results, organized in shift registers (one per lane) to mask latency (of the design, not related to the particular operation used)
+    {{ op.data_type }} __attribute__((register)) reduce_result[credits_flow_control][ELEMS_PER_PACKET][SHIFT_REG + 1];
+    SMI_Rank data_recvd[credits_flow_control];  // packets received for every element of the buffer
+    bool send_credits = false; // true if we have to send credits to the children
+    char credits = 0; // the number of credits that we still have to send to every child
+    SMI_Rank send_to = 0;   // next child to which send the credit
+    char add_to[MAX_RANKS];   // for each rank tells to what element in the buffer we should add the received packet
     unsigned int sent_credits = 0;    //number of sent credits so far
-    unsigned int message_size;
+    unsigned int parent_credits = 0;  //credits received from the parent
+    unsigned int message_size = 0;
+    unsigned int num_packets = 0;
+    char last_packet_elems = 0;         // data elements of the last packet of the message
+    unsigned int own_packets = 0;       // contributions received from the application (non-root ranks)
+    unsigned int reduced_packets = 0;   // packets delivered to the application or forwarded to the parent
+    bool own_recvd = false;             // the root received a contribution of the application
+    {{ op.data_type }} own_data = {{ op.shift_reg_init() }};
+    char root_lane = 0;                 // lane of the next element delivered to the application (root)
+    bool active = false;                // a reduce is in progress
+    bool is_root = false;
+    SMI_Rank my_rank = 0;
+    SMI_Rank root = 0;
+    SMI_Rank parent = 0;
+    int first_child = 0;        // relative rank of the first child
+    SMI_Rank num_children = 0;
+    SMI_Rank num_contributions = 0;     // packets to receive for every element of the buffer
 
     for (int i = 0;i < credits_flow_control; i++)
     {
         data_recvd[i] = 0;
         #pragma unroll
-        for(int j = 0; j < SHIFT_REG + 1; j++)
+        for (int l = 0; l < ELEMS_PER_PACKET; l++)
         {
-            reduce_result[i][j] = {{ op.shift_reg_init() }};
+            #pragma unroll
+            for(int j = 0; j < SHIFT_REG + 1; j++)
+            {
+                reduce_result[i][l][j] = {{ op.shift_reg_init() }};
+            }
         }
     }
 
@@ -36,72 +63,185 @@ __kernel void smi_kernel_reduce_{{ op.logical_port }}(char num_rank)
         add_to[i] = 0;
     }
     char current_buffer_element = 0;
-    char add_to_root = 0;
+    char add_to_own = 0;
     char contiguos_reads = 0;
 
     while (true)
     {
-        bool valid = false;
-        if (!send_credits)
+        const char packet_elems = reduced_packets == num_packets - 1 ? last_packet_elems : ELEMS_PER_PACKET;
+        bool completed = false;
+        if (send_credits)
+        {
+            // send a credit to every child
+            SET_HEADER_OP(reduce.header, SMI_SYNCH);
+            SET_HEADER_NUM_ELEMS(reduce.header,1);
+            SET_HEADER_PORT(reduce.header, {{ op.logical_port }});
+            SET_HEADER_DST(reduce.header, (root + first_child + send_to) % num_rank);
+            write_channel_intel({{ op.get_channel("cks_control") }}, reduce);
+            send_to++;
+            if (send_to == num_children)
+            {
+                send_to = 0;
+                credits--;
+                send_credits = credits != 0;
+                sent_credits++;
+            }
+        }
+        else if (active && is_root && own_recvd && data_recvd[current_buffer_element] == num_contributions)
         {
+            // We received the partial results of the children for this element: combine them with the
+            // contribution of the root and send the result to the application
+            {{ op.data_type }} res = own_data;
+            #pragma unroll
+            for (int l = 0; l < ELEMS_PER_PACKET; l++)
+            {
+                if (l == root_lane)
+                {
+                    #pragma unroll
+                    for (int i = 0; i < SHIFT_REG; i++)
+                    {
+                        res = {{ op.reduce_op() }}(res, reduce_result[current_buffer_element][l][i]);
+                    }
+                }
+            }
+            *({{ op.data_type }}*) (reduce.data) = res;
+            write_channel_intel({{ op.get_channel("reduce_recv") }}, reduce);
+            own_recvd = false;
+            root_lane++;
+            completed = root_lane == packet_elems;
+        }
+        else if (active && !is_root && data_recvd[current_buffer_element] == num_contributions && parent_credits != 0)
+        {
+            // We received all the contributions for this packet: forward the partial results to the parent
+            #pragma unroll
+            for (int l = 0; l < ELEMS_PER_PACKET; l++)
+            {
+                {{ op.data_type }} res = {{ op.shift_reg_init() }};
+                #pragma unroll
+                for (int i = 0; i < SHIFT_REG; i++)
+                {
+                    res = {{ op.reduce_op() }}(res, reduce_result[current_buffer_element][l][i]);
+                }
+                *({{ op.data_type }}*) (&reduce.data[l * {{ op.data_size() }}]) = res;
+            }
+            SET_HEADER_OP(reduce.header, SMI_REDUCE);
+            SET_HEADER_NUM_ELEMS(reduce.header, packet_elems);
+            SET_HEADER_PORT(reduce.header, {{ op.logical_port }});
+            SET_HEADER_SRC(reduce.header, my_rank);
+            SET_HEADER_DST(reduce.header, parent);
+            write_channel_intel({{ op.get_channel("cks_data") }}, reduce);
+            parent_credits--;
+            completed = true;
+        }
+        else
+        {
+            bool valid = false;
             switch (sender_id)
-            {   // for the root, I have to receive from both sides
-                case 0:
-                    mess = read_channel_nb_intel({{ op.get_channel("reduce_send") }}, &valid);
+            {
+                case 0: // contribution of the application, if there is a free element in the buffer
+                    if (!active || (is_root && !own_recvd) ||
+                        (!is_root && own_packets != num_packets && own_packets - reduced_packets < credits_flow_control))
+                    {
+                        mess = read_channel_nb_intel({{ op.get_channel("reduce_send") }}, &valid);
+                    }
                     break;
-                case 1: // read from CK_R, can be done by the root and by the non-root
+                case 1: // partial results of the children
                     mess = read_channel_nb_intel({{ op.get_channel("ckr_data") }}, &valid);
                     break;
+                case 2: // credits from the parent
+                    mess = read_channel_nb_intel({{ op.get_channel("ckr_control") }}, &valid);
+                    break;
             }
             if (valid)
             {
-                char a;
                 if (sender_id == 0)
                 {
-                    // received root contribution to the reduced result
-                    // apply reduce
-                    char* ptr = mess.data;
-                    {{ op.data_type }} data= *({{ op.data_type }}*) (ptr);
-                    reduce_result[add_to_root][SHIFT_REG] = {{ op.reduce_op() }}(data, reduce_result[add_to_root][0]); // apply reduce
-                    #pragma unroll
-                    for (int j = 0; j < SHIFT_REG; j++)
-                    {
-                        reduce_result[add_to_root][j] = reduce_result[add_to_root][j + 1];
-                    }
-
-                    data_recvd[add_to_root]++;
-                    a = add_to_root;
-                    if (GET_HEADER_OP(mess.header) == SMI_SYNCH) // first element of a new reduce
+                    if (GET_HEADER_OP(mess.header) == SMI_SYNCH) // a new reduce begins
                     {
+                        // the application indicates the shape of the tree and the length of the message
+                        // in the first message, that carries no data
+                        my_rank = GET_HEADER_SRC(mess.header);
+                        root = GET_HEADER_DST(mess.header);
+                        const int fanout = *(short *) (&(mess.data[SMI_PACKET_PAYLOAD_SIZE - 6]));
+                        const int children = fanout == 0 ? num_rank - 1 : fanout;
+                        const int relative_rank = (my_rank - root + num_rank) % num_rank;
+                        is_root = relative_rank == 0;
+                        first_child = relative_rank * children + 1;
+                        num_children = (SMI_Rank) MIN(MAX(num_rank - first_child, 0), children);
+                        num_contributions = is_root ? num_children : num_children + 1;
+                        parent = is_root ? root : (root + (relative_rank - 1) / children) % num_rank;
+                        message_size = *(unsigned int *) (&(mess.data[SMI_PACKET_PAYLOAD_SIZE - 4]));
+                        num_packets = (message_size + ELEMS_PER_PACKET - 1) / ELEMS_PER_PACKET;
+                        last_packet_elems = message_size - (num_packets - 1) * ELEMS_PER_PACKET;
+                        own_packets = 0;
+                        reduced_packets = 0;
+                        own_recvd = false;
+                        root_lane = 0;
                         sent_credits = 0;
                         send_to = 0;
-                        // since data elements are not packed we exploit the data buffer
-                        // to indicate to the support kernel the lenght of the message
-                        message_size = *(unsigned int *) (&(mess.data[24]));
-                        send_credits = true;
-                        credits = MIN((unsigned int) credits_flow_control, message_size);
+                        credits = MIN((unsigned int) credits_flow_control, num_packets);
+                        send_credits = num_children != 0;
+                        current_buffer_element = 0;
+                        add_to_own = 0;
+                        for (int i = 0; i < MAX_RANKS; i++)
+                        {
+                            add_to[i] = 0;
+                        }
+                        active = true;
+                    }
+                    else if (is_root)
+                    {
+                        // single element, combined with the partial results of the children when they are complete
+                        own_data = *({{ op.data_type }}*) (mess.data);
+                        own_recvd = true;
                     }
-                    add_to_root++;
-                    if (add_to_root == credits_flow_control)
+                    else
                     {
-                        add_to_root = 0;
+                        // apply reduce lane-wise
+                        #pragma unroll
+                        for (int l = 0; l < ELEMS_PER_PACKET; l++)
+                        {
+                            {{ op.data_type }} data = *({{ op.data_type }}*) (&mess.data[l * {{ op.data_size() }}]);
+                            if (l < GET_HEADER_NUM_ELEMS(mess.header))
+                            {
+                                reduce_result[add_to_own][l][SHIFT_REG] = {{ op.reduce_op() }}(data, reduce_result[add_to_own][l][0]);
+                                #pragma unroll
+                                for (int j = 0; j < SHIFT_REG; j++)
+                                {
+                                    reduce_result[add_to_own][l][j] = reduce_result[add_to_own][l][j + 1];
+                                }
+                            }
+                        }
+
+                        data_recvd[add_to_own]++;
+                        own_packets++;
+                        add_to_own++;
+                        if (add_to_own == credits_flow_control)
+                        {
+                            add_to_own = 0;
+                        }
                     }
                 }
-                else
+                else if (sender_id == 1)
                 {
-                    // received contribution from a non-root rank, apply reduce operation
+                    // received partial results from a child, apply reduce operation lane-wise
                     contiguos_reads++;
-                    char* ptr = mess.data;
-                    char rank = GET_HEADER_SRC(mess.header);
-                    {{ op.data_type }} data = *({{ op.data_type }}*)(ptr);
+                    SMI_Rank rank = GET_HEADER_SRC(mess.header);
                     char addto = add_to[rank];
                     data_recvd[addto]++;
-                    a = addto;
-                    reduce_result[addto][SHIFT_REG] = {{ op.reduce_op() }}(data, reduce_result[addto][0]);        // apply reduce
                     #pragma unroll
-                    for (int j = 0; j < SHIFT_REG; j++)
+                    for (int l = 0; l < ELEMS_PER_PACKET; l++)
                     {
-                        reduce_result[addto][j] = reduce_result[addto][j + 1];
+                        {{ op.data_type }} data = *({{ op.data_type }}*) (&mess.data[l * {{ op.data_size() }}]);
+                        if (l < GET_HEADER_NUM_ELEMS(mess.header))
+                        {
+                            reduce_result[addto][l][SHIFT_REG] = {{ op.reduce_op() }}(data, reduce_result[addto][l][0]);        // apply reduce
+                            #pragma unroll
+                            for (int j = 0; j < SHIFT_REG; j++)
+                            {
+                                reduce_result[addto][l][j] = reduce_result[addto][l][j + 1];
+                            }
+                        }
                     }
 
                     addto++;
@@ -111,70 +251,47 @@ __kernel void smi_kernel_reduce_{{ op.logical_port }}(char num_rank)
                     }
                     add_to[rank] = addto;
                 }
-
-                if (data_recvd[current_buffer_element] == num_rank)
+                else
                 {
-                    // We received all the contributions, we can send result to application
-                    char* data_snd = reduce.data;
-                    // Build reduced result
-                    {{ op.data_type }} res = {{ op.shift_reg_init() }};
-                    #pragma unroll
-                    for (int i = 0; i < SHIFT_REG; i++)
-                    {
-                        res = {{ op.reduce_op() }}(res,reduce_result[current_buffer_element][i]);
-                    }
-                    char* conv = (char*)(&res);
-                    #pragma unroll
-                    for (int jj = 0; jj < {{ op.data_size() }}; jj++) // copy the data
-                    {
-                        data_snd[jj] = conv[jj];
-                    }
-                    write_channel_intel({{ op.get_channel("reduce_recv") }}, reduce);
-                    send_credits = sent_credits<message_size;               // send additional tokes if there are other elements to reduce
-                    credits++;
-                    data_recvd[current_buffer_element] = 0;
-
-                    //reset shift register
-                    #pragma unroll
-                    for (int j = 0; j < SHIFT_REG + 1; j++)
-                    {
-                        reduce_result[current_buffer_element][j] =  {{ op.shift_reg_init() }};
-                    }
-                    current_buffer_element++;
-                    if (current_buffer_element == credits_flow_control)
-                    {
-                        current_buffer_element = 0;
-                    }
+                    parent_credits++;
                 }
             }
-            if (sender_id == 0)
-            {
-                sender_id = 1;
-            }
-            else if (!valid || contiguos_reads == READS_LIMIT)
+            // keep reading from the children until the limit, then move to the next sender
+            if (sender_id != 1 || !valid || contiguos_reads == READS_LIMIT)
             {
-                sender_id = 0;
+                sender_id = sender_id == 2 ? 0 : sender_id + 1;
                 contiguos_reads = 0;
             }
         }
-        else
+
+        if (completed)
         {
-            // send credits
-            if (send_to != GET_HEADER_DST(mess.header))
+            // the packet in this element of the buffer has been reduced
+            reduced_packets++;
+            active = reduced_packets != num_packets;
+            if (num_children != 0 && sent_credits < num_packets)
             {
-                SET_HEADER_OP(reduce.header, SMI_SYNCH);
-                SET_HEADER_NUM_ELEMS(reduce.header,1);
-                SET_HEADER_PORT(reduce.header, {{ op.logical_port }});
-                SET_HEADER_DST(reduce.header, send_to);
-                write_channel_intel({{ op.get_channel("cks_control") }}, reduce);
+                // send additional tokens if there are other packets to reduce
+                credits++;
+                send_credits = true;
             }
-            send_to++;
-            if (send_to == num_rank)
+            data_recvd[current_buffer_element] = 0;
+            root_lane = 0;
+
+            //reset shift registers
+            #pragma unroll
+            for (int l = 0; l < ELEMS_PER_PACKET; l++)
             {
-                send_to = 0;
-                credits--;
-                send_credits = credits != 0;
-                sent_credits++;
+                #pragma unroll
+                for (int j = 0; j < SHIFT_REG + 1; j++)
+                {
+                    reduce_result[current_buffer_element][l][j] = {{ op.shift_reg_init() }};
+                }
+            }
+            current_buffer_element++;
+            if (current_buffer_element == credits_flow_control)
+            {
+                current_buffer_element = 0;
             }
         }
     }
@@ -185,30 +302,47 @@ __kernel void smi_kernel_reduce_{{ op.logical_port }}(char num_rank)
 void {{ utils.impl_name_port_type("SMI_Reduce", op) }}(SMI_RChannel* chan,  void* data_snd, void* data_rcv)
 {
     char* conv = (char*) data_snd;
-    // copy data to the network message
-    COPY_DATA_TO_NET_MESSAGE(chan, chan->net,conv);
-
-    // In this case we disabled network packetization: so we can just send the data as soon as we have it
-    SET_HEADER_NUM_ELEMS(chan->net.header, 1);
+    if (GET_HEADER_OP(chan->net.header) == SMI_SYNCH)
+    {
+        // the first message builds the reduce tree in the support kernel: it carries the fanout
+        // and the message size instead of data
+        *(short *)(&(chan->net.data[SMI_PACKET_PAYLOAD_SIZE - 6])) = chan->fanout;
+        write_channel_intel({{ op.get_channel("reduce_send") }}, chan->net);
+        SET_HEADER_OP(chan->net.header, SMI_REDUCE);
+    }
 
     if (chan->my_rank == chan->root_rank) // root
     {
+        // the root needs the reduced element before the next one: the element is always the first one
+        #pragma unroll
+        for (int jj = 0; jj < {{ op.data_size() }}; jj++)
+        {
+            chan->net.data[jj] = conv[jj];
+        }
+        SET_HEADER_NUM_ELEMS(chan->net.header, 1);
         write_channel_intel({{ op.get_channel("reduce_send") }}, chan->net);
-        SET_HEADER_OP(chan->net.header, SMI_REDUCE);          // after sending the first element of this reduce
         mem_fence(CLK_CHANNEL_MEM_FENCE);
-        chan->net_2 = read_channel_intel({{ op.get_channel("reduce_recv") }});
+        SMI_Network_message result = read_channel_intel({{ op.get_channel("reduce_recv") }});
         // copy data from the network message to user variable
-        COPY_DATA_FROM_NET_MESSAGE(chan, chan->net_2, data_rcv);
+        #pragma unroll
+        for (int jj = 0; jj < {{ op.data_size() }}; jj++)
+        {
+            ((char *)data_rcv)[jj] = result.data[jj];
+        }
     }
     else
     {
-        // wait for credits
-
-        SMI_Network_message req = read_channel_intel({{ op.get_channel("ckr_control") }});
-        mem_fence(CLK_CHANNEL_MEM_FENCE);
-        SET_HEADER_OP(chan->net.header,SMI_REDUCE);
-        // then send the data
-        write_channel_intel({{ op.get_channel("cks_data") }}, chan->net);
+        // pack the contribution and offload full packets to the support kernel, which combines them lane-wise
+        // with the partial results of the children
+{{ utils.pack(op, "chan->net.data", "chan->packet_element_id", "conv", op.data_elements_per_packet())|indent(4, first=True) }}
+        chan->packet_element_id++;
+        chan->processed_elements++;
+        if (chan->packet_element_id == chan->elements_per_packet || chan->processed_elements == chan->message_size)
+        {
+            SET_HEADER_NUM_ELEMS(chan->net.header, chan->packet_element_id);
+            write_channel_intel({{ op.get_channel("reduce_send") }}, chan->net);
+            chan->packet_element_id = 0;
+        }
     }
 }
 {%- endmacro %}
@@ -221,10 +355,11 @@ SMI_RChannel {{ utils.impl_name_port_type("SMI_Open_reduce_channel", op) }}(int
     chan.message_size = (unsigned int) count;
     chan.data_type = data_type;
     chan.port = (char) port;
-    chan.my_rank = (char) SMI_Comm_rank(comm);
-    chan.root_rank = (char) root;
-    chan.num_rank = (char) SMI_Comm_size(comm);
+    chan.my_rank = (SMI_Rank) SMI_Comm_rank(comm);
+    chan.root_rank = (SMI_Rank) root;
+    chan.num_rank = (SMI_Rank) SMI_Comm_size(comm);
     chan.reduce_op = (char) op;
+    chan.fanout = SMI_REDUCE_FANOUT;
     chan.size_of_type = {{ op.data_size() }};
     chan.elements_per_packet = {{ op.data_elements_per_packet() }};
 
@@ -235,7 +370,7 @@ SMI_RChannel {{ utils.impl_name_port_type("SMI_Open_reduce_channel", op) }}(int
     SET_HEADER_NUM_ELEMS(chan.net.header, 0);            // at the beginning no data
     // workaround: the support kernel has to know the message size to limit the number of credits
     // exploiting the data buffer
-    *(unsigned int *)(&(chan.net.data[24])) = chan.message_size;
+    *(unsigned int *)(&(chan.net.data[SMI_PACKET_PAYLOAD_SIZE - 4])) = chan.message_size;
     SET_HEADER_OP(chan.net.header, SMI_SYNCH);
     chan.processed_elements = 0;
     chan.packet_element_id = 0;
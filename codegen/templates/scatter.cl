@@ -1,39 +1,61 @@
 {% import 'utils.cl' as utils %}
 
 {%- macro smi_scatter_kernel(program, op) -%}
-__kernel void smi_kernel_scatter_{{ op.logical_port }}(char num_rank)
+__kernel void smi_kernel_scatter_{{ op.logical_port }}(SMI_Rank num_rank)
 {
-    bool external = true;
-    char to_be_received_requests = 0; // how many ranks have still to communicate that they are ready to receive
-    const char num_requests = num_rank - 1;
+    // forwards the packets of the root to their destination as soon as the destination is ready to receive,
+    // without waiting for the other ranks: the ready messages of the next destinations are kept until their turn.
+    // The packets are flow-controlled with credits for every destination, so that the data in flight never
+    // exceeds the buffer of the CKR channel of the destination, which would otherwise block its CKR
+    __constant int WINDOW = {{ op.buffer_size }};
+    __constant int CREDITS_BATCH = {{ op.credits_batch() }};
+    bool ready[{{ program.max_ranks }}];    // ready to receive, before their turn
     SMI_Network_message mess;
+    SMI_Rank dest = 0;
+    bool active = false;    // the current destination is ready to receive
+    int credits = 0;
+
+    for (int i = 0; i < {{ program.max_ranks }}; i++)
+    {
+        ready[i] = false;
+    }
 
     while (true)
     {
-        if (external) // read from the application
+        mess = read_channel_intel({{ op.get_channel("scatter") }});
+        if (GET_HEADER_OP(mess.header) == SMI_SYNCH || GET_HEADER_DST(mess.header) != dest)
         {
-            mess = read_channel_intel({{ op.get_channel("scatter") }});
-            if (GET_HEADER_OP(mess.header) == SMI_SYNCH)
-            {
-                to_be_received_requests = num_requests;
-                SET_HEADER_OP(mess.header, SMI_SCATTER);
-            }
-            external = false;
+            // first packet of a scatter or of a destination
+            dest = GET_HEADER_DST(mess.header);
+            active = ready[dest];
+            ready[dest] = false;
+            credits = active ? WINDOW : 0;
+            SET_HEADER_OP(mess.header, SMI_SCATTER);
         }
-        else // handle the request
+        while (!active || credits == 0)
         {
-            if (to_be_received_requests != 0)
+            SMI_Network_message req = read_channel_intel({{ op.get_channel("ckr_control") }});
+            const SMI_Rank src = GET_HEADER_SRC(req.header);
+            if (GET_HEADER_NUM_ELEMS(req.header) == 1) // ready to receive
             {
-                SMI_Network_message req = read_channel_intel({{ op.get_channel("ckr_control") }});
-                to_be_received_requests--;
+                if (src == dest && !active)
+                {
+                    active = true;
+                    credits = WINDOW;
+                }
+                else
+                {
+                    ready[src] = true;
+                }
             }
-            else
+            else if (src == dest && active)
             {
-                // just push it to the network
-                write_channel_intel({{ op.get_channel("cks_data") }}, mess);
-                external = true;
+                credits += CREDITS_BATCH;
             }
+            // otherwise, these are late credits of a destination that has been completed
         }
+        write_channel_intel({{ op.get_channel("cks_data") }}, mess);
+        credits--;
     }
 }
 {%- endmacro %}
@@ -100,16 +122,26 @@ void {{ utils.impl_name_port_type("SMI_Scatter", op) }}(SMI_ScatterChannel* chan
     {
         if(chan->init)  //send ready-to-receive to the root
         {
+            SET_HEADER_NUM_ELEMS(chan->net.header, 1);
             write_channel_intel({{ op.get_channel("cks_control") }}, chan->net);
             chan->init=false;
         }
         if (chan->packet_element_id_rcv == 0)
         {
             chan->net_2 = read_channel_intel({{ op.get_channel("ckr_data") }});
+            chan->received_packets++;
+            // return the credits to the root only if more data is expected
+            if (chan->received_packets == {{ op.credits_batch() }} && chan->processed_elements + GET_HEADER_NUM_ELEMS(chan->net_2.header) < chan->recv_count)
+            {
+                SET_HEADER_NUM_ELEMS(chan->net.header, 0);
+                write_channel_intel({{ op.get_channel("cks_control") }}, chan->net);
+                chan->received_packets = 0;
+            }
         }
-        COPY_DATA_FROM_NET_MESSAGE(chan, chan->net_2, data_rcv);
+{{ utils.unpack(op, "chan->net_2.data", "chan->packet_element_id_rcv", "data_rcv", op.data_elements_per_packet())|indent(4, first=True) }}
 
         chan->packet_element_id_rcv++;
+        chan->processed_elements++;
         if (chan->packet_element_id_rcv == elem_per_packet)
         {
             chan->packet_element_id_rcv = 0;
@@ -128,9 +160,9 @@ SMI_ScatterChannel {{ utils.impl_name_port_type("SMI_Open_scatter_channel", op)
     chan.recv_count = (unsigned int) recv_count;
     chan.data_type = data_type;
     chan.port = (char) port;
-    chan.my_rank = (char) comm[0];
-    chan.num_ranks = (char) comm[1];
-    chan.root_rank = (char) root;
+    chan.my_rank = (SMI_Rank) comm[0];
+    chan.num_ranks = (SMI_Rank) comm[1];
+    chan.root_rank = (SMI_Rank) root;
     chan.next_rcv = 0;
     chan.init = true;
     chan.size_of_type = {{ op.data_size() }};
@@ -154,6 +186,7 @@ SMI_ScatterChannel {{ utils.impl_name_port_type("SMI_Open_scatter_channel", op)
     }
 
     chan.processed_elements = 0;
+    chan.received_packets = 0;
     chan.packet_element_id = 0;
     chan.packet_element_id_rcv = 0;
     return chan;
@@ -1 +1,70 @@
 {%- macro impl_name_port_type(name, op) -%}{{ name }}_{{ op.logical_port }}_{{ op.data_type }}{%- endmacro -%}
+
+{#- Copies the element src in position element_id of the packet data (specialised for the data type of op).
+    The packet is not built as a shift register: the element is written by position, so that a partially filled
+    (last) packet keeps its elements at the start, where the receiver expects them. Since the element size is known
+    at code generation, the selection is a single compare per element instead of the data_type switch and byte
+    offsets of COPY_DATA_TO_NET_MESSAGE -#}
+{%- macro pack(op, data, element_id, src, elements_per_packet) %}
+    #pragma unroll
+    for (int ee = 0; ee < {{ elements_per_packet }}; ee++)
+    {
+        if (ee == {{ element_id }})
+        {
+            #pragma unroll
+            for (int jj = 0; jj < {{ op.data_size() }}; jj++)
+            {
+                {{ data }}[(ee * {{ op.data_size() }}) + jj] = {{ src }}[jj];
+            }
+        }
+    }
+{%- endmacro %}
+
+{#- Copies the element in position element_id of the packet data to dst (specialised for the data type of op).
+    The packet is not shifted as a shift register would do: it is left untouched, since SMI_Pop_vec reads the
+    whole packet as it was received -#}
+{%- macro unpack(op, data, element_id, dst, elements_per_packet) %}
+    #pragma unroll
+    for (int ee = 0; ee < {{ elements_per_packet }}; ee++)
+    {
+        if (ee == {{ element_id }})
+        {
+            #pragma unroll
+            for (int jj = 0; jj < {{ op.data_size() }}; jj++)
+            {
+                ((char *){{ dst }})[jj] = {{ data }}[(ee * {{ op.data_size() }}) + jj];
+            }
+        }
+    }
+{%- endmacro %}
+
+
+{%- macro ready_mask_grant(num_inputs, declare=True, reads_limit="READS_LIMIT") %}
+        // keep the granted input until it is empty or it reaches READS_LIMIT, then grant the closest ready input after it
+        if (!ready[sender_id] || contiguous_reads == {{ reads_limit }})
+        {
+            contiguous_reads = 0;
+            char next = sender_id;
+            #pragma unroll
+            for (char i = {{ num_inputs - 1 }}; i > 0; i--)
+            {
+                char candidate = sender_id + i;
+                if (candidate >= {{ num_inputs }})
+                {
+                    candidate -= {{ num_inputs }};
+                }
+                if (ready[candidate])
+                {
+                    next = candidate;
+                }
+            }
+            sender_id = next;
+        }
+
+        {{ "bool " if declare else "" }}valid = ready[sender_id];
+        if (valid)
+        {
+            message = messages[sender_id];
+            ready[sender_id] = false;
+        }
+{%- endmacro %}
@@ -0,0 +1,20 @@
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+#include <smi.h>
+
+void SMI_Alltoall_1_int(SMI_AlltoallChannel* chan, void* data_snd, void* data_rcv);
+void SMI_Allgather_0_float(SMI_AllgatherChannel* chan, void* send_data, void* rcv_data);
+SMI_AlltoallChannel SMI_Open_alltoall_channel_1_int(int count, SMI_Datatype data_type, int port, SMI_Comm comm);
+SMI_AllgatherChannel SMI_Open_allgather_channel_0_float(int send_count, int recv_count, SMI_Datatype data_type, int port, SMI_Comm comm);
+__kernel void app_0(const int N)
+{
+    SMI_Comm comm;
+    SMI_AllgatherChannel chan_allgather = SMI_Open_allgather_channel_0_float(N, N * SMI_Comm_size(comm), SMI_FLOAT, 0, comm);
+    SMI_AlltoallChannel chan_alltoall = SMI_Open_alltoall_channel_1_int(N, SMI_INT, 1, comm);
+    for (int i = 0; i < N * SMI_Comm_size(comm); i++)
+    {
+        float f = i;
+        SMI_Allgather_0_float(&chan_allgather, &f, &f);
+        SMI_Alltoall_1_int(&chan_alltoall, &i, &i);
+    }
+}
@@ -0,0 +1,16 @@
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+#include <smi.h>
+
+__kernel void app_0(const int N)
+{
+    SMI_Comm comm;
+    SMI_AllgatherChannel chan_allgather = SMI_Open_allgather_channel(N, N * SMI_Comm_size(comm), SMI_FLOAT, 0, comm);
+    SMI_AlltoallChannel chan_alltoall = SMI_Open_alltoall_channel_ad(N, SMI_INT, 1, comm, 32);
+    for (int i = 0; i < N * SMI_Comm_size(comm); i++)
+    {
+        float f = i;
+        SMI_Allgather(&chan_allgather, &f, &f);
+        SMI_Alltoall(&chan_alltoall, &i, &i);
+    }
+}
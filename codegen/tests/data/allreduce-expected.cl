@@ -0,0 +1,21 @@
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+#include <smi.h>
+
+void SMI_Allreduce_1_float(SMI_ARChannel* chan,  void* data_snd, void* data_rcv);
+SMI_ARChannel SMI_Open_allreduce_channel_1_float(int count, SMI_Datatype data_type, SMI_Op op, int port, SMI_Comm comm);
+void SMI_Allreduce_0_int(SMI_ARChannel* chan,  void* data_snd, void* data_rcv);
+SMI_ARChannel SMI_Open_allreduce_channel_0_int(int count, SMI_Datatype data_type, SMI_Op op, int port, SMI_Comm comm);
+__kernel void app_0(const int N)
+{
+    SMI_Comm comm;
+    for (int i = 0; i < N; i++)
+    {
+        SMI_ARChannel chan_allreduce = SMI_Open_allreduce_channel_0_int(1, SMI_INT, SMI_ADD, 0, comm);
+        SMI_Allreduce_0_int(&chan_allreduce, &i, &i);
+
+        SMI_ARChannel chan_allreduce1 = SMI_Open_allreduce_channel_1_float(1, SMI_FLOAT, SMI_MAX, 1, comm);
+        float f = i;
+        SMI_Allreduce_1_float(&chan_allreduce1, &f, &f);
+    }
+}
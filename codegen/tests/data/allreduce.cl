@@ -0,0 +1,17 @@
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+#include <smi.h>
+
+__kernel void app_0(const int N)
+{
+    SMI_Comm comm;
+    for (int i = 0; i < N; i++)
+    {
+        SMI_ARChannel chan_allreduce = SMI_Open_allreduce_channel(1, SMI_INT, SMI_ADD, 0, comm);
+        SMI_Allreduce(&chan_allreduce, &i, &i);
+
+        SMI_ARChannel chan_allreduce1 = SMI_Open_allreduce_channel(1, SMI_FLOAT, SMI_MAX, 1, comm);
+        float f = i;
+        SMI_Allreduce(&chan_allreduce1, &f, &f);
+    }
+}
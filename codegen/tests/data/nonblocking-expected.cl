@@ -0,0 +1,33 @@
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+#include <smi.h>
+
+int SMI_Push_nb_2_float(SMI_Channel* chan, void* data);
+int SMI_Pop_nb_1_float(SMI_Channel* chan, void* data);
+int SMI_Pop_nb_0_float(SMI_Channel* chan, void* data);
+SMI_Channel SMI_Open_send_channel_2_float(int count, SMI_Datatype data_type, int destination, int port, SMI_Comm comm);
+SMI_Channel SMI_Open_receive_channel_1_float(int count, SMI_Datatype data_type, int source, int port, SMI_Comm comm);
+SMI_Channel SMI_Open_receive_channel_0_float(int count, SMI_Datatype data_type, int source, int port, SMI_Comm comm);
+__kernel void app_0(const int N, SMI_Comm comm)
+{
+    SMI_Channel chan_left = SMI_Open_receive_channel_0_float(N, SMI_FLOAT, 0, 0, comm);
+    SMI_Channel chan_right = SMI_Open_receive_channel_1_float(N, SMI_FLOAT, 2, 1, comm);
+    SMI_Channel chan_send = SMI_Open_send_channel_2_float(N, SMI_FLOAT, 0, 2, comm);
+    int left = 0, right = 0, sent = 0;
+    while (left < N || right < N || sent < N)
+    {
+        float data;
+        if (left < N && SMI_Pop_nb_0_float(&chan_left, &data))
+        {
+            left++;
+        }
+        if (right < N && SMI_Pop_nb_1_float(&chan_right, &data))
+        {
+            right++;
+        }
+        if (sent < N && SMI_Push_nb_2_float(&chan_send, &data))
+        {
+            sent++;
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+#include <smi.h>
+
+__kernel void app_0(const int N, SMI_Comm comm)
+{
+    SMI_Channel chan_left = SMI_Open_receive_channel(N, SMI_FLOAT, 0, 0, comm);
+    SMI_Channel chan_right = SMI_Open_receive_channel(N, SMI_FLOAT, 2, 1, comm);
+    SMI_Channel chan_send = SMI_Open_send_channel(N, SMI_FLOAT, 0, 2, comm);
+    int left = 0, right = 0, sent = 0;
+    while (left < N || right < N || sent < N)
+    {
+        float data;
+        if (left < N && SMI_Pop_nb(&chan_left, &data))
+        {
+            left++;
+        }
+        if (right < N && SMI_Pop_nb(&chan_right, &data))
+        {
+            right++;
+        }
+        if (sent < N && SMI_Push_nb(&chan_send, &data))
+        {
+            sent++;
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+#include <smi.h>
+
+void SMI_Free_channel_pop_1_int(SMI_Channel* chan);
+void SMI_Free_channel_push_0_int(SMI_Channel* chan);
+void SMI_Pop_1_int(SMI_Channel* chan, void* data);
+void SMI_Push_0_int(SMI_Channel* chan, void* data);
+void SMI_Start_pop_1_int(SMI_Channel* chan);
+void SMI_Start_push_0_int(SMI_Channel* chan);
+SMI_Channel SMI_Open_persistent_receive_channel_1_int(int count, SMI_Datatype data_type, int source, int port, SMI_Comm comm);
+SMI_Channel SMI_Open_persistent_send_channel_0_int(int count, SMI_Datatype data_type, int destination, int port, SMI_Comm comm);
+__kernel void app_0(const int N, const int iterations, const char dst)
+{
+    SMI_Comm comm;
+    SMI_Channel chan_send = SMI_Open_persistent_send_channel_0_int(N, SMI_INT, dst, 0, comm);
+    SMI_Channel chan_recv = SMI_Open_persistent_receive_channel_1_int(N, SMI_INT, dst, 1, comm);
+    for (int it = 0; it < iterations; it++)
+    {
+        SMI_Start_push_0_int(&chan_send);
+        SMI_Start_pop_1_int(&chan_recv);
+        for (int i = 0; i < N; i++)
+        {
+            int data = i;
+            SMI_Push_0_int(&chan_send, &data);
+            SMI_Pop_1_int(&chan_recv, &data);
+        }
+    }
+    SMI_Free_channel_push_0_int(&chan_send);
+    SMI_Free_channel_pop_1_int(&chan_recv);
+}
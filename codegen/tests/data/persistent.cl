@@ -0,0 +1,23 @@
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+#include <smi.h>
+
+__kernel void app_0(const int N, const int iterations, const char dst)
+{
+    SMI_Comm comm;
+    SMI_Channel chan_send = SMI_Open_persistent_send_channel(N, SMI_INT, dst, 0, comm);
+    SMI_Channel chan_recv = SMI_Open_persistent_receive_channel(N, SMI_INT, dst, 1, comm);
+    for (int it = 0; it < iterations; it++)
+    {
+        SMI_Start(&chan_send);
+        SMI_Start(&chan_recv);
+        for (int i = 0; i < N; i++)
+        {
+            int data = i;
+            SMI_Push(&chan_send, &data);
+            SMI_Pop(&chan_recv, &data);
+        }
+    }
+    SMI_Free_channel(&chan_send);
+    SMI_Free_channel(&chan_recv);
+}
@@ -36,10 +36,16 @@ SMI_Comm SmiInit_program(
         // reduce kernels
     kernel_names.push_back("smi_kernel_reduce_6");
 
+        // allreduce kernels
+
         // scatter kernels
 
         // gather kernels
 
+        // allgather kernels
+
+        // alltoall kernels
+
 
     IntelFPGAOCLUtils::initEnvironment(
             platform, device, fpga, context,
@@ -77,46 +83,49 @@ SMI_Comm SmiInit_program(
     queues[0].enqueueWriteBuffer(routing_table_ck_s_3, CL_TRUE, 0, cks_table_size, &routing_tables_cks[3][0]);
     queues[0].enqueueWriteBuffer(routing_table_ck_r_3, CL_TRUE, 0, ckr_table_size, &routing_tables_ckr[3][0]);
 
-    char char_ranks_count=ranks_count;
-    char char_rank=rank;
+    SMI_Rank smi_ranks_count=ranks_count;
+    SMI_Rank smi_rank=rank;
     // cks_0
     kernels[0].setArg(0, sizeof(cl_mem), &routing_table_ck_s_0);
-    kernels[0].setArg(1, sizeof(char), &char_ranks_count);
+    kernels[0].setArg(1, sizeof(SMI_Rank), &smi_ranks_count);
 
     // ckr_0
     kernels[1].setArg(0, sizeof(cl_mem), &routing_table_ck_r_0);
-    kernels[1].setArg(1, sizeof(char), &char_rank);
+    kernels[1].setArg(1, sizeof(SMI_Rank), &smi_rank);
     // cks_1
     kernels[2].setArg(0, sizeof(cl_mem), &routing_table_ck_s_1);
-    kernels[2].setArg(1, sizeof(char), &char_ranks_count);
+    kernels[2].setArg(1, sizeof(SMI_Rank), &smi_ranks_count);
 
     // ckr_1
     kernels[3].setArg(0, sizeof(cl_mem), &routing_table_ck_r_1);
-    kernels[3].setArg(1, sizeof(char), &char_rank);
+    kernels[3].setArg(1, sizeof(SMI_Rank), &smi_rank);
     // cks_2
     kernels[4].setArg(0, sizeof(cl_mem), &routing_table_ck_s_2);
-    kernels[4].setArg(1, sizeof(char), &char_ranks_count);
+    kernels[4].setArg(1, sizeof(SMI_Rank), &smi_ranks_count);
 
     // ckr_2
     kernels[5].setArg(0, sizeof(cl_mem), &routing_table_ck_r_2);
-    kernels[5].setArg(1, sizeof(char), &char_rank);
+    kernels[5].setArg(1, sizeof(SMI_Rank), &smi_rank);
     // cks_3
     kernels[6].setArg(0, sizeof(cl_mem), &routing_table_ck_s_3);
-    kernels[6].setArg(1, sizeof(char), &char_ranks_count);
+    kernels[6].setArg(1, sizeof(SMI_Rank), &smi_ranks_count);
 
     // ckr_3
     kernels[7].setArg(0, sizeof(cl_mem), &routing_table_ck_r_3);
-    kernels[7].setArg(1, sizeof(char), &char_rank);
+    kernels[7].setArg(1, sizeof(SMI_Rank), &smi_rank);
         // broadcast 3
-    kernels[8].setArg(0, sizeof(char), &char_ranks_count);
+    kernels[8].setArg(0, sizeof(SMI_Rank), &smi_ranks_count);
     // broadcast 4
-    kernels[9].setArg(0, sizeof(char), &char_ranks_count);
+    kernels[9].setArg(0, sizeof(SMI_Rank), &smi_ranks_count);
 
         // reduce 6
-    kernels[10].setArg(0, sizeof(char), &char_ranks_count);
+    kernels[10].setArg(0, sizeof(SMI_Rank), &smi_ranks_count);
 
     
     
+    
+    
+    
 
     // move buffers
     buffers.push_back(std::move( routing_table_ck_s_0));
@@ -137,7 +146,7 @@ SMI_Comm SmiInit_program(
     }
 
     // return the communicator
-    SMI_Comm comm{ char_rank, char_ranks_count };
+    SMI_Comm comm{ smi_rank, smi_ranks_count };
     return comm;
 
 }
@@ -0,0 +1,20 @@
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+#include <smi.h>
+
+void SMI_Pop_vec_1_float(SMI_Channel* chan, void* data);
+void SMI_Push_vec_0_float(SMI_Channel* chan, void* data);
+SMI_Channel SMI_Open_receive_channel_1_float(int count, SMI_Datatype data_type, int source, int port, SMI_Comm comm);
+SMI_Channel SMI_Open_send_channel_0_float(int count, SMI_Datatype data_type, int destination, int port, SMI_Comm comm);
+__kernel void app_0(const int N, const char dst)
+{
+    SMI_Comm comm;
+    float vec[SMI_FLOAT_ELEM_PER_PCKT];
+    SMI_Channel chan_send = SMI_Open_send_channel_0_float(N, SMI_FLOAT, dst, 0, comm);
+    SMI_Channel chan_recv = SMI_Open_receive_channel_1_float(N, SMI_FLOAT, dst, 1, comm);
+    for (int i = 0; i < N; i += SMI_FLOAT_ELEM_PER_PCKT)
+    {
+        SMI_Push_vec_0_float(&chan_send, vec);
+        SMI_Pop_vec_1_float(&chan_recv, vec);
+    }
+}
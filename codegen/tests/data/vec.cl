@@ -0,0 +1,16 @@
+#pragma OPENCL EXTENSION cl_intel_channels : enable
+
+#include <smi.h>
+
+__kernel void app_0(const int N, const char dst)
+{
+    SMI_Comm comm;
+    float vec[SMI_FLOAT_ELEM_PER_PCKT];
+    SMI_Channel chan_send = SMI_Open_send_channel(N, SMI_FLOAT, dst, 0, comm);
+    SMI_Channel chan_recv = SMI_Open_receive_channel(N, SMI_FLOAT, dst, 1, comm);
+    for (int i = 0; i < N; i += SMI_FLOAT_ELEM_PER_PCKT)
+    {
+        SMI_Push_vec(&chan_send, vec);
+        SMI_Pop_vec(&chan_recv, vec);
+    }
+}
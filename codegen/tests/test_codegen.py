@@ -1,4 +1,6 @@
-from codegen import generate_program_device, generate_program_host
+import pytest
+
+from codegen import generate_program_device, generate_program_host, generate_program_native_host
 from ops import Push, Pop, Broadcast, Reduce, Scatter, Gather
 from program import Program, ProgramMapping
 from routing import create_routing_context
@@ -50,3 +52,329 @@ def test_codegen_host(file_tester):
     ])
 
     file_tester.check("smi-host-1.h", generate_program_host([("program", program)]))
+
+
+def test_codegen_native():
+    program = Program([
+        Push(0),
+        Pop(0),
+        Broadcast(1)
+    ])
+
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    connections = {
+        ("n1:f1", 0): ("n1:f2", 0)
+    }
+    ctx = create_routing_context(connections, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4, native=True, sources=["program.cl"])
+    assert "channel SMI_Network_message" not in device
+    assert "smi_native::Channel<SMI_Network_message, 16> push_0_cks_data;" in device
+    assert "runtime.launch(smi_kernel_bcast_1, smi_ranks_count);" in device
+    assert device.rstrip().endswith('#include "program.cl"')
+
+    host = generate_program_native_host(ctx.fpgas, {"n1:f1": "program", "n1:f2": "program"},
+                                        {"program": "program/smi_generated_device.cl"})
+    for rank in range(2):
+        assert "namespace smi_rank_{}".format(rank) in host
+        assert "case {0}: return smi_rank_{0}::SmiInit".format(rank) in host
+    assert "#define SmiKernel_program(RANK, NAME)" in host
+
+
+def test_codegen_ready_mask_arbiter():
+    program = Program([
+        Push(0),
+        Pop(1)
+    ], arbiter="ready-mask")
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    # CK_S_0: 3 CK_S + CK_R + push_0_cks_data
+    assert "SMI_Network_message messages[5];" in device
+    assert "messages[4] = read_channel_nb_intel(push_0_cks_data, &ready[4]);" in device
+    # CK_R: QSFP + 3 CK_R + CK_S
+    assert "messages[0] = read_channel_nb_intel(io_in_0, &ready[0]);" in device
+    assert "switch (sender_id)" not in device
+
+
+def test_codegen_control_lane():
+    program = Program([
+        Push(0),
+        Pop(1)
+    ], control_lane=True)
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    assert "channels_interconnect_ck_s_control[QSFP_COUNT*(QSFP_COUNT-1)]" in device
+    # CK_S_1: the credits of Pop(1) are polled by the control lane only
+    assert "message = read_channel_nb_intel(pop_1_cks_control, &valid);" in device
+    assert "const char num_control_sender = 5;" in device
+    # synchronization messages are forwarded on the control interconnects
+    assert "write_channel_intel(channels_interconnect_ck_r_to_ck_s_control[0], message);" in device
+    assert "if (!control && (!valid || contiguous_reads == READS_LIMIT))" in device
+
+
+def test_codegen_virtual_channels():
+    program = Program([
+        Push(0),
+        Pop(1)
+    ], virtual_channels=True)
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    assert "channels_interconnect_ck_s_vc1[QSFP_COUNT*(QSFP_COUNT-1)]" in device
+    assert "channels_interconnect_ck_r_to_ck_s_credits[QSFP_COUNT]" in device
+    # CK_S_0: 3 CK_S + CK_R + push_0_cks_data on the first virtual channel, 3 CK_S + CK_R on the second one
+    assert "const char num_sender = 9;" in device
+    assert "message = read_channel_nb_intel(channels_interconnect_ck_r_to_ck_s_vc1[0], &valid);" in device
+    # the QSFP is used only with a credit, the dateline switches the virtual channel
+    assert "if (qsfp_credits[1] != 0)" in device
+    assert "SET_HEADER_VC(pending[0].header, 1);" in device
+    # CK_R forwards on the virtual channel of the message and passes the credits to CK_S
+    assert "write_channel_intel(channels_interconnect_ck_r_to_ck_s_vc1[0], message);" in device
+    assert "if (write_channel_nb_intel(channels_interconnect_ck_r_to_ck_s_credits[0], credits))" in device
+
+
+def test_codegen_port_weights():
+    program = Program([
+        Push(0),
+        Push(1)
+    ], port_weights={1: 2})
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    # CK_S_1: 3 CK_S + CK_R + push_1_cks_data
+    assert "const char reads_limit[5] = {READS_LIMIT, READS_LIMIT, READS_LIMIT, READS_LIMIT, 2};" in device
+    assert "contiguous_reads == reads_limit[sender_id]" in device
+
+    # the weights must fit in a char
+    with pytest.raises(AssertionError):
+        Program([Push(0)], port_weights={0: 128})
+
+
+def test_codegen_p2p_protocols():
+    program = Program([
+        Push(0),
+        Pop(0),
+        Push(1),
+        Pop(1)
+    ], p2p_protocols={0: "eager"})
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    # port 0 is eager: no tokens are exchanged
+    assert "push_0_ckr_control" not in device
+    assert "pop_0_cks_control" not in device
+    assert "read_channel_intel(push_1_ckr_control)" in device
+
+
+def test_codegen_p2p_hops():
+    program = Program([
+        Push(0),
+        Pop(0),
+        Pop(1)
+    ], p2p_hops={0: 3})
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    # the window of port 0 covers three hops: three times the buffer of the receiver
+    assert "chan.max_tokens = 336;" in device
+    assert "pop_0_ckr_data __attribute__((depth(48)))" in device
+    assert "pop_1_ckr_data __attribute__((depth(16)))" in device
+    # the tokens of the longer path are returned in larger batches
+    assert "chan.tokens = MIN((unsigned int) 42, count);" in device
+    assert "chan.tokens = MIN((unsigned int) 14, count);" in device
+
+    # the ports that are not configured count a single hop
+    assert program.p2p_hops == {0: 3}
+    assert program.operations[2].p2p_window() == 16
+
+
+def test_codegen_any_source():
+    program = Program([
+        Push(0),
+        Pop(0),
+        Push(1),
+        Pop(1)
+    ], any_source_ports={0}, p2p_hops={0: 3})
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    # the 48 packets of the buffer of the receiver are shared by the other 7 ranks
+    assert program.get_any_source_tokens(program.operations[0]) == 42
+    assert "chan.max_tokens = 42;" in device
+    assert device.count("chan->sender_rank = GET_HEADER_SRC(chan->net.header);") == 3
+    # the tokens of every packet go back to its sender
+    assert "*(unsigned int*) mess.data = chan->packet_element_id;" in device
+
+
+def test_codegen_message_width():
+    program = Program([
+        Push(0, "double"),
+        Pop(1, "char")
+    ], message_width=512)
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    assert device.startswith("#ifndef SMI_MESSAGE_WIDTH\n#define SMI_MESSAGE_WIDTH 512\n")
+    # 59 bytes of payload
+    assert "chan.elements_per_packet = 7;" in device
+    assert "chan.elements_per_packet = 59;" in device
+
+    host = generate_program_native_host(ctx.fpgas, {"n1:f1": "program", "n1:f2": "program"},
+                                        {"program": "program/smi_generated_device.cl"})
+    assert host.startswith("#define SMI_MESSAGE_WIDTH 512\n")
+
+
+def test_codegen_wide_ranks():
+    program = Program([
+        Push(0, "int"),
+        Broadcast(1, "char")
+    ], max_ranks=256, wide_ranks=True, rank_group_size=4)
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4, native=True)
+    assert device.startswith("#ifndef SMI_WIDE_RANKS\n#define SMI_WIDE_RANKS\n")
+    assert "#define RANK_GROUP_SIZE 4\n#define MAX_RANK_GROUPS 64\n" in device
+    # 26 bytes of payload
+    assert "chan.elements_per_packet = 6;" in device
+    assert "chan.elements_per_packet = 26;" in device
+    assert "char external_routing_table[MAX_RANKS];" not in device
+    assert "char idx = group_idx == CKS_LOCAL_GROUP ? local_idx : group_idx;" in device
+    assert "const int cks_table_size = (ranks_count + 3) / 4 + 4;" in device
+
+    host = generate_program_native_host(ctx.fpgas, {"n1:f1": "program", "n1:f2": "program"},
+                                        {"program": "program/smi_generated_device.cl"})
+    assert host.startswith("#define SMI_WIDE_RANKS\n")
+    assert generate_program_host([("program", program)]).startswith(
+        "#define __HOST_PROGRAM__\n#ifndef SMI_WIDE_RANKS\n#define SMI_WIDE_RANKS\n")
+
+
+def test_codegen_vec():
+    program = Program([
+        Push(0, "float"),
+        Pop(1, "float"),
+        Broadcast(2, "double")
+    ])
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    assert "void SMI_Push_vec_0_float(SMI_Channel *chan, void* data)" in device
+    assert "void SMI_Pop_vec_1_float(SMI_Channel *chan, void *data)" in device
+    assert "void SMI_Bcast_vec_2_double(SMI_BChannel* chan, void* data)" in device
+    # a whole packet (7 floats, 3 doubles) is copied at once
+    assert device.count("for (int jj = 0; jj < 28; jj++)") == 2
+    assert "for (int jj = 0; jj < 24; jj++)" in device
+
+
+def test_codegen_type_specialised_packing():
+    program = Program([
+        Push(0, "short"),
+        Pop(1, "short"),
+        Broadcast(2, "char"),
+        Scatter(3, "int"),
+        Reduce(4, "float", op_type="add")
+    ])
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    assert "COPY_DATA_TO_NET_MESSAGE" not in device
+    assert "COPY_DATA_FROM_NET_MESSAGE" not in device
+    # the receivers read the element at its position in the packet
+    assert "((char *)data)[jj] = chan->net.data[(ee * 2) + jj];" in device
+    assert "((char *)conv)[jj] = chan->net_2.data[(ee * 1) + jj];" in device
+    assert "((char *)data_rcv)[jj] = chan->net_2.data[(ee * 4) + jj];" in device
+
+
+def test_codegen_burst():
+    program = Program([
+        Push(0, "int"),
+        Pop(1, "int")
+    ], burst_length=4)
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    # payload flits wait in a side channel until the header flit is sent
+    assert "channel SMI_Network_message push_0_burst __attribute__((depth(4)));" in device
+    assert "payload = read_channel_intel(push_0_burst);" in device
+    assert "SET_HEADER_OP(header.header, SMI_BURST);" in device
+    # the whole 256 bit flit carries data
+    assert device.count("chan.elements_per_packet = 8;") == 2
+
+    # the receiver must be able to return credits before a whole burst is staged
+    with pytest.raises(AssertionError):
+        Program([Push(0, "int", 2)], burst_length=4)
+
+
+def test_codegen_broadcast_recv():
+    program = Program([
+        Broadcast(0, "int"),
+        Broadcast(2, "double"),
+        Push(1)
+    ])
+    mapping = ProgramMapping([program], {
+        "n1:f1": program,
+        "n1:f2": program
+    })
+    ctx = create_routing_context({("n1:f1", 0): ("n1:f2", 0)}, mapping)
+
+    device = generate_program_device(ctx.fpgas[0], ctx.fpgas, ctx.graph, 4)
+    # every broadcast port has its own channel from the support kernel to the application
+    for port in (0, 2):
+        assert "channel SMI_Network_message broadcast_{}_broadcast_recv __attribute__((depth(1)));".format(port) \
+            in device
+        assert "write_channel_intel(broadcast_{}_broadcast_recv, mess);".format(port) in device
+        assert "chan->net_2 = read_channel_intel(broadcast_{}_broadcast_recv);".format(port) in device
+    assert "broadcast_1_broadcast_recv" not in device
+    assert "push_1_broadcast_recv" not in device
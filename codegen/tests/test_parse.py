@@ -1,5 +1,8 @@
-from ops import Push, Pop, Broadcast, Reduce
-from serialization import parse_program, parse_routing_file
+from ops import Push, Pop, Broadcast, Reduce, Allreduce, Allgather, Alltoall
+from program import Program
+from serialization import parse_program, parse_routing_file, serialize_program, parse_port_weights, \
+    parse_communication, parse_p2p_protocols, parse_p2p_hops, parse_any_source_ports, \
+    parse_port_endpoints
 
 
 def test_parse_program():
@@ -55,6 +58,92 @@ def test_parse_program():
     assert program.operations[4].data_type == "float"
 
     assert program.operations[6].buffer_size == 32
+    assert program.port_weights == {}
+
+
+def test_parse_allreduce():
+    program = parse_program(serialize_program(Program([Reduce(0, "int", op_type="add"),
+                                                         Allreduce(1, "float", op_type="max")])))
+    assert program.operations[0].__class__ == Reduce
+    assert isinstance(program.operations[1], Allreduce)
+    assert program.operations[1].op_type == "max"
+    assert program.get_ops_by_type("reduce") == [program.operations[0]]
+    assert program.get_ops_by_type("allreduce") == [program.operations[1]]
+
+
+def test_parse_arbiter_control_lane():
+    program = parse_program(serialize_program(Program([Push(0)], arbiter="ready-mask", control_lane=True)))
+    assert program.arbiter == "ready-mask"
+    assert program.control_lane
+    program = parse_program(serialize_program(Program([Push(0)])))
+    assert (program.arbiter, program.control_lane) == ("round-robin", False)
+
+
+def test_parse_allgather_alltoall():
+    program = parse_program(serialize_program(Program([Allgather(0, "float"), Alltoall(1, "int", 32)])))
+    assert program.get_ops_by_type("allgather") == [Allgather(0, "float")]
+    assert program.get_ops_by_type("alltoall") == [Alltoall(1, "int", 32)]
+    assert program.operations[1].credits_batch() == 16
+
+
+def test_parse_port_weights():
+    assert parse_port_weights({"port_weights": {"0": 16, "3": 1}}) == {0: 16, 3: 1}
+
+    program = parse_program(serialize_program(Program([Push(0), Pop(3)], port_weights={3: 2})))
+    assert program.port_weights == {3: 2}
+
+
+def test_parse_p2p_protocols():
+    assert parse_p2p_protocols({"p2p_protocols": {"0": "eager", "2": "rendezvous"}}) == {0: "eager", 2: "rendezvous"}
+
+    program = parse_program(serialize_program(Program([Push(0), Pop(2)], p2p_protocols={0: "eager"})))
+    assert program.p2p_protocols == {0: "eager"}
+    assert not program.is_p2p_rendezvous(program.operations[0])
+    assert program.is_p2p_rendezvous(program.operations[1])
+
+
+def test_parse_p2p_hops():
+    assert parse_p2p_hops({"p2p_hops": {"1": 4}}) == {1: 4}
+
+    program = parse_program(serialize_program(Program([Push(0), Pop(1)], p2p_hops={1: 4})))
+    assert program.p2p_hops == {1: 4}
+    assert program.operations[1].p2p_window() == 64
+
+
+def test_parse_any_source_ports():
+    assert parse_any_source_ports({}) == set()
+    assert parse_any_source_ports({"any_source_ports": [3, "5"]}) == {3, 5}
+
+    program = parse_program(serialize_program(Program([Push(0), Pop(1)], any_source_ports={1})))
+    assert program.is_any_source(program.operations[1])
+    assert not program.is_any_source(program.operations[0])
+
+
+def test_parse_communication():
+    assert parse_communication({}) == []
+    assert parse_communication({"communication": [{"src": 0, "dst": 3, "weight": 8}, {"src": 1, "dst": 2}]}) == [
+        (0, 3, 8), (1, 2, 1)
+    ]
+
+
+def test_parse_port_endpoints():
+    assert parse_port_endpoints({"communication": [{"src": 0, "dst": 1}]}) == {}
+    assert parse_port_endpoints({"communication": [
+        {"src": 0, "dst": 3, "port": 2}, {"src": 1, "dst": 2, "weight": 4, "port": "2"}, {"src": 0, "dst": 1, "port": 0}
+    ]}) == {2: [(0, 3), (1, 2)], 0: [(0, 1)]}
+
+
+def test_parse_message_width():
+    program = parse_program(serialize_program(Program([Push(0, "double")], message_width=512)))
+    assert program.message_width == 512
+    assert program.operations[0].data_elements_per_packet() == 7
+
+
+def test_parse_wide_ranks():
+    program = parse_program(serialize_program(Program([Push(0, "short")], wide_ranks=True, rank_group_size=8)))
+    assert program.wide_ranks
+    assert program.rank_group_size == 8
+    assert program.operations[0].data_elements_per_packet() == 13
 
 
 def test_parse_connections():
@@ -1,4 +1,4 @@
-from ops import Push, Pop, Broadcast, Reduce, Scatter, Gather
+from ops import Push, Pop, Broadcast, Reduce, Scatter, Gather, Allreduce, Allgather, Alltoall
 
 
 def test_rewriter_port(rewrite_tester):
@@ -53,3 +53,39 @@ def test_rewriter_reduce(rewrite_tester):
         Reduce(1, op_type="min"),
         Reduce(2, op_type="max"),
     ])
+
+
+def test_rewriter_allreduce(rewrite_tester):
+    rewrite_tester.check("allreduce", [
+        Allreduce(0, op_type="add"),
+        Allreduce(1, "float", op_type="max"),
+    ])
+
+
+def test_rewriter_allgather_alltoall(rewrite_tester):
+    rewrite_tester.check("allgather-alltoall", [
+        Allgather(0, "float"),
+        Alltoall(1, "int", 32),
+    ])
+
+
+def test_rewriter_nonblocking(rewrite_tester):
+    rewrite_tester.check("nonblocking", [
+        Pop(0, "float"),
+        Pop(1, "float"),
+        Push(2, "float")
+    ])
+
+
+def test_rewriter_persistent(rewrite_tester):
+    rewrite_tester.check("persistent", [
+        Push(0, "int"),
+        Pop(1, "int")
+    ])
+
+
+def test_rewriter_vec(rewrite_tester):
+    rewrite_tester.check("vec", [
+        Push(0, "float"),
+        Pop(1, "float")
+    ])
@@ -1,7 +1,9 @@
 import networkx
 
 from program import ProgramMapping, Program
-from routing import load_inter_fpga_connections, create_routing_context
+from routing import load_inter_fpga_connections, create_routing_context, fpga_hops, placement_cost, shortest_paths, \
+    channel_dependency_graph, find_dependency_cycle, place_datelines, place_virtual_channel_datelines, p2p_port_hops
+from routing_table import cks_routing_table, validate_cks_routes, CKS_TARGET_QSFP, CKS_TARGET_QSFP_DATELINE
 
 
 def test_load_inter_fpga_connections():
@@ -56,3 +58,104 @@ def test_routing_context():
         fpgas[3].channels[1],
         fpgas[3].channels[3]
     ]
+
+
+def ring_context(communication, fpga_programs=None):
+    # ring n1 - n4 - n2 - n5 - n3 - n6 - n1
+    order = ["n1:f1", "n4:f1", "n2:f1", "n5:f1", "n3:f1", "n6:f1"]
+    program = Program([])
+    mapping = ProgramMapping([program], {fpga: program for fpga in order})
+    connections = {}
+    for (i, fpga) in enumerate(order):
+        connections[(fpga, 0)] = (order[(i + 1) % len(order)], 1)
+        connections[(order[(i + 1) % len(order)], 1)] = (fpga, 0)
+    return create_routing_context(connections, mapping, communication, fpga_programs)
+
+
+def test_rank_placement():
+    ring = [(i, (i + 1) % 6, 1) for i in range(6)]
+
+    ctx = ring_context(None)
+    assert [fpga.node for fpga in ctx.fpgas] == ["n1", "n2", "n3", "n4", "n5", "n6"]
+    assert placement_cost(fpga_hops(ctx.graph, ctx.fpgas), ctx.fpgas, ring) == 12
+
+    ctx = ring_context(ring)
+    assert [fpga.rank for fpga in ctx.fpgas] == list(range(6))
+    # neighbour ranks are directly connected
+    assert placement_cost(fpga_hops(ctx.graph, ctx.fpgas), ctx.fpgas, ring) == 6
+
+
+def test_p2p_port_hops():
+    ctx = ring_context(None)
+    # rank 0 (n1) is a neighbour of rank 3 (n4) and two hops away from ranks 1 (n2) and 2 (n3)
+    assert p2p_port_hops(ctx.graph, ctx.fpgas, {0: [(0, 3)], 1: [(0, 1), (3, 0), (0, 2)], 2: []}) == {
+        0: 1, 1: 2, 2: 1
+    }
+
+
+def test_rank_placement_programs():
+    ring = [(i, (i + 1) % 6, 1) for i in range(6)]
+    programs = {"n1:f1": "a", "n2:f1": "a", "n3:f1": "b", "n4:f1": "b", "n5:f1": "b", "n6:f1": "b"}
+
+    ctx = ring_context(ring, programs)
+    # ranks 0 and 1 keep running program a
+    assert [programs[fpga.key()] for fpga in ctx.fpgas] == ["a", "a", "b", "b", "b", "b"]
+    assert placement_cost(fpga_hops(ctx.graph, ctx.fpgas), ctx.fpgas, ring) < 12
+
+
+def ring_tables(graph, fpgas):
+    routes = shortest_paths(graph)
+    return {channel: cks_routing_table(routes, fpgas, channel) for fpga in fpgas for channel in fpga.channels}
+
+
+def test_channel_dependency_cycle():
+    ctx = ring_context(None)
+    dependencies = channel_dependency_graph(ctx.graph, ctx.fpgas, ring_tables(ctx.graph, ctx.fpgas))
+    cycle = find_dependency_cycle(dependencies)
+    # the messages travel around the ring in the same direction
+    assert cycle is not None
+    assert len([buffer for buffer in cycle if buffer[0] == "qsfp"]) == 6
+
+    # without the link between n6 and n1 the ring becomes a line
+    line = ctx.graph.copy()
+    line.remove_edge(ctx.fpgas[5].channels[0], ctx.fpgas[0].channels[1])
+    dependencies = channel_dependency_graph(line, ctx.fpgas, ring_tables(line, ctx.fpgas))
+    assert find_dependency_cycle(dependencies) is None
+
+
+def test_place_datelines():
+    ctx = ring_context(None)
+    (graph, datelines) = place_datelines(ctx.graph, ctx.fpgas, lambda g: ring_tables(g, ctx.fpgas))
+
+    # one dateline for each direction of the ring
+    assert len(datelines) == 2
+    for (src, dst) in datelines:
+        assert not graph.has_edge(src, dst)
+
+    tables = ring_tables(graph, ctx.fpgas)
+    validate_cks_routes(graph, ctx.fpgas, tables)
+    assert find_dependency_cycle(channel_dependency_graph(graph, ctx.fpgas, tables)) is None
+
+
+def test_place_virtual_channel_datelines():
+    ctx = ring_context(None)
+    tables = ring_tables(ctx.graph, ctx.fpgas)
+    (dateline_tables, datelines) = place_virtual_channel_datelines(ctx.graph, ctx.fpgas, tables)
+
+    # one dateline for each direction of the ring, the links are kept
+    assert len(datelines) == 2
+    for (src, dst) in datelines:
+        assert ctx.graph.has_edge(src, dst)
+        assert CKS_TARGET_QSFP_DATELINE in dateline_tables[src]
+        assert CKS_TARGET_QSFP not in dateline_tables[src]
+
+    # the routes are the same, only the virtual channel changes
+    for (channel, table) in tables.items():
+        assert [CKS_TARGET_QSFP if target == CKS_TARGET_QSFP_DATELINE else target
+                for target in dateline_tables[channel]] == table
+
+    validate_cks_routes(ctx.graph, ctx.fpgas, dateline_tables)
+    dependencies = channel_dependency_graph(ctx.graph, ctx.fpgas, dateline_tables)
+    assert find_dependency_cycle(dependencies) is None
+    # the messages that crossed a dateline use the buffers of the second virtual channel
+    assert any(buffer[-1] == 1 for buffer in dependencies.nodes)
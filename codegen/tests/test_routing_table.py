@@ -3,7 +3,9 @@ from conftest import get_routing_ctx, get_channel
 
 from ops import Push, Pop
 from program import FPGA, Program, CHANNELS_PER_FPGA
-from routing_table import cks_routing_table, NoRouteFound, ckr_routing_table
+from routing import shortest_path_lengths
+from routing_table import cks_routing_table, NoRouteFound, ckr_routing_table, cks_multipath_routing_table, \
+    cks_two_level_routing_tables, expand_two_level_table, validate_cks_routes
 
 
 def test_cks_table():
@@ -31,6 +33,98 @@ def test_cks_table():
     assert cks_routing_table(routes, fpgas, d) == [0, 0, 1]
 
 
+def test_cks_multipath_table():
+    ctx = get_routing_ctx(Program([
+        Push(0),
+        Push(1)
+    ]), {
+        ("N0:F0", 2): ("N0:F1", 3),
+        ("N0:F0", 3): ("N0:F1", 2)
+    })
+
+    graph, fpgas = (ctx.graph, ctx.fpgas)
+    distances = shortest_path_lengths(graph)
+
+    # channels without a link use different parallel links
+    assert cks_multipath_routing_table(graph, distances, fpgas, get_channel(graph, "N0:F0", 0)) == [1, 4]
+    assert cks_multipath_routing_table(graph, distances, fpgas, get_channel(graph, "N0:F0", 1)) == [1, 3]
+    assert cks_multipath_routing_table(graph, distances, fpgas, get_channel(graph, "N0:F0", 2)) == [1, 0]
+    assert cks_multipath_routing_table(graph, distances, fpgas, get_channel(graph, "N0:F0", 3)) == [1, 0]
+    assert cks_multipath_routing_table(graph, distances, fpgas, get_channel(graph, "N0:F1", 0)) == [3, 1]
+    assert cks_multipath_routing_table(graph, distances, fpgas, get_channel(graph, "N0:F1", 1)) == [4, 1]
+
+
+def test_cks_multipath_table_single_path():
+    ctx = get_routing_ctx(Program([
+        Push(0)
+    ]), {
+        ("N0:F0", 0): ("N0:F1", 0),
+        ("N1:F0", 0): ("N0:F0", 1)
+    })
+
+    graph, routes, fpgas = (ctx.graph, ctx.routes, ctx.fpgas)
+    distances = shortest_path_lengths(graph)
+    for fpga in fpgas:
+        for channel in fpga.channels:
+            assert cks_multipath_routing_table(graph, distances, fpgas, channel) == cks_routing_table(routes, fpgas, channel)
+
+
+def test_cks_two_level_table():
+    # ring of 8 FPGAs, 2 per node
+    connections = {}
+    for i in range(8):
+        j = (i + 1) % 8
+        connections[("N{}:F{}".format(i // 2, i % 2), 1)] = ("N{}:F{}".format(j // 2, j % 2), 0)
+    ctx = get_routing_ctx(Program([
+        Push(0)
+    ], wide_ranks=True), connections)
+
+    graph, fpgas = (ctx.graph, ctx.fpgas)
+    tables = cks_two_level_routing_tables(graph, fpgas, 2)
+
+    # groups of (0, 1), (2, 3), (4, 5), (6, 7), followed by ranks (0, 1) or (2, 3)
+    assert tables[get_channel(graph, "N0:F0", 0)] == [255, 2, 0, 0, 1, 2]
+    assert tables[get_channel(graph, "N0:F0", 1)] == [255, 0, 2, 2, 1, 0]
+    assert tables[get_channel(graph, "N1:F0", 0)] == [0, 255, 2, 0, 1, 2]
+    assert expand_two_level_table(tables[get_channel(graph, "N1:F0", 0)], 8, 2) == [0, 0, 1, 2, 2, 2, 0, 0]
+
+
+def test_cks_two_level_table_incomplete_group():
+    ctx = get_routing_ctx(Program([
+        Push(0)
+    ], wide_ranks=True), {
+        ("N0:F0", 0): ("N0:F1", 0),
+        ("N1:F0", 0): ("N0:F0", 1)
+    })
+
+    graph, fpgas = (ctx.graph, ctx.fpgas)
+    tables = cks_two_level_routing_tables(graph, fpgas, 2)
+
+    assert tables[get_channel(graph, "N1:F0", 0)] == [0, 255, 1, 1]
+    assert tables[get_channel(graph, "N0:F0", 2)] == [255, 3, 1, 2]
+
+
+def test_cks_routes_loop():
+    ctx = get_routing_ctx(Program([
+        Push(0)
+    ]), {
+        ("N0:F0", 0): ("N0:F1", 0)
+    })
+
+    graph, fpgas = (ctx.graph, ctx.fpgas)
+    tables = {channel: [1, 0] for channel in fpgas[0].channels}
+    tables.update({channel: [0, 1] for channel in fpgas[1].channels})
+    # channel 1 of N0:F0 has no link
+    with pytest.raises(NoRouteFound):
+        validate_cks_routes(graph, fpgas, tables)
+
+    # the channels of N0:F1 forward the messages for N0:F0 to each other
+    tables = {channel: [1, 0 if channel.index == 0 else 2] for channel in fpgas[0].channels}
+    tables.update({channel: [2, 1] for channel in fpgas[1].channels})
+    with pytest.raises(NoRouteFound):
+        validate_cks_routes(graph, fpgas, tables)
+
+
 def test_ckr_table():
     program = Program([
         Push(0),
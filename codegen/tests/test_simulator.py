@@ -0,0 +1,111 @@
+from conftest import get_routing_ctx
+
+from ops import Push, Pop
+from program import CHANNELS_PER_FPGA, Program
+from routing_table import cks_routing_table, ckr_routing_table
+from simulator import Flow, simulate, synthetic_traffic
+
+
+def get_tables(ctx):
+    tables = {}
+    for fpga in ctx.fpgas:
+        for channel in fpga.channels:
+            tables[("cks", channel)] = cks_routing_table(ctx.routes, ctx.fpgas, channel)
+            tables[("ckr", channel)] = ckr_routing_table(channel, CHANNELS_PER_FPGA, fpga.program)
+    return tables
+
+
+def get_ctx(**kwargs):
+    return get_routing_ctx(Program([
+        Push(0),
+        Pop(0),
+        Push(1),
+        Pop(1)
+    ], **kwargs), {
+        ("N0:F0", 0): ("N0:F1", 0),
+        ("N0:F1", 1): ("N1:F0", 0)
+    })
+
+
+def test_simulate_p2p():
+    ctx = get_ctx()
+    report = simulate(ctx, get_tables(ctx), [Flow(0, 2, 0, 100)], link_latency=10, link_cycles_per_packet=2)
+
+    assert report["delivered"] == 100
+    assert report["misrouted"] == 0
+    # two hops, one of them through the CK_S of the intermediate FPGA
+    used = [link for link in report["links"] if link["packets"] > 0]
+    assert len(used) == 2
+    assert all(link["packets"] == 100 for link in used)
+    # the link is the bottleneck
+    assert report["cycles"] >= 200
+    latency = report["latency"][0]
+    assert (latency["rank"], latency["port"], latency["packets"]) == (2, 0, 100)
+    assert latency["min"] >= 20
+
+
+def test_simulate_link_bandwidth():
+    ctx = get_ctx()
+    slow = simulate(ctx, get_tables(ctx), [Flow(0, 1, 0, 200)], link_cycles_per_packet=4)
+    fast = simulate(ctx, get_tables(ctx), [Flow(0, 1, 0, 200)], link_cycles_per_packet=1)
+    assert slow["cycles"] > fast["cycles"]
+    assert sum(link["stall_cycles"] for link in slow["stalls"]) > 0
+
+
+def test_synthetic_traffic():
+    ctx = get_ctx()
+    flows = synthetic_traffic(ctx.fpgas, "neighbour", 10)
+    # no port is free both on rank 2 and on rank 0
+    assert [(f.src, f.dst, f.port) for f in flows] == [(0, 1, 0), (1, 2, 1)]
+
+    report = simulate(ctx, get_tables(ctx), flows)
+    assert report["delivered"] == 20
+    assert report["undelivered"] == 0
+
+
+def test_simulate_ready_mask_arbiter():
+    ctx = get_ctx()
+    flows = lambda: [Flow(0, 2, 0, 500), Flow(1, 0, 1, 500)]
+    round_robin = simulate(ctx, get_tables(ctx), flows(), link_latency=10, link_cycles_per_packet=1)
+    # the arbiter is the one of the program
+    ctx = get_ctx(arbiter="ready-mask")
+    ready_mask = simulate(ctx, get_tables(ctx), flows(), link_latency=10, link_cycles_per_packet=1)
+
+    assert ready_mask["delivered"] == round_robin["delivered"] == 1000
+    # idle inputs do not cost a cycle
+    assert ready_mask["cycles"] < round_robin["cycles"]
+    for (rr, rm) in zip(round_robin["latency"], ready_mask["latency"]):
+        assert rm["mean"] <= rr["mean"]
+
+
+def test_simulate_control_lane():
+    ctx = get_ctx()
+    # credits from rank 2 share the CK_S of rank 1 with the data sent to rank 2
+    flows = lambda: [Flow(0, 2, 0, 1000), Flow(2, 0, 0, 50, interval=20, control=True)]
+    shared = simulate(ctx, get_tables(ctx), flows(), link_latency=10, link_cycles_per_packet=1)
+    ctx = get_ctx(control_lane=True)
+    control_lane = simulate(ctx, get_tables(ctx), flows(), link_latency=10, link_cycles_per_packet=1)
+
+    assert shared["delivered"] == control_lane["delivered"] == 1050
+    (shared_control, control) = (shared["latency"][0], control_lane["latency"][0])
+    assert (control["rank"], control["port"]) == (0, 0)
+    # control packets do not wait behind data
+    assert control["max"] < shared_control["max"]
+
+
+def test_simulate_port_weights():
+    def run(port_weights):
+        ctx = get_routing_ctx(Program([Push(0), Pop(0), Push(1), Pop(1)], port_weights=port_weights), {
+            ("N0:F0", 0): ("N0:F1", 0),
+            ("N0:F1", 1): ("N1:F0", 0)
+        })
+        # latency-critical port 0 and bulk port 1
+        flows = [Flow(0, 1, 0, 100, interval=4), Flow(0, 1, 1, 2000)]
+        return simulate(ctx, get_tables(ctx), flows, link_latency=10, link_cycles_per_packet=1)
+
+    unweighted = run({})
+    throttled = run({1: 1})
+    assert unweighted["delivered"] == throttled["delivered"] == 2100
+    (critical, bulk) = throttled["latency"]
+    assert (critical["port"], bulk["port"]) == (0, 1)
+    assert critical["max"] < unweighted["latency"][0]["max"]
@@ -126,11 +126,11 @@ kernel void ComputeMeans(__global volatile VTYPE centroids_global[],
       }
     }
 
-    DTYPE means_reduced[W][DIMS / W][K];
+    VTYPE centroids_updated[DIMS / W][K];
 
-    // printf("[%i] Starting centroid reduce...\n", smi_rank);
-    SMI_RChannel __attribute__((register)) reduce_mean_ch =
-        SMI_Open_reduce_channel(K * DIMS, SMI_FLOAT, SMI_ADD, 0, 0, comm);
+    // printf("[%i] Starting centroid allreduce...\n", smi_rank);
+    SMI_ARChannel __attribute__((register)) allreduce_mean_ch =
+        SMI_Open_allreduce_channel(K * DIMS, SMI_FLOAT, SMI_ADD, 0, comm);
     #pragma loop_coalesce
     for (int k = 0; k < K; ++k) {
       for (int d = 0; d < DIMS / W; d++) {
@@ -141,54 +141,23 @@ kernel void ComputeMeans(__global volatile VTYPE centroids_global[],
                send_vec = means[d][k];
           DTYPE send_val = send_vec[w];
           DTYPE recv_val;
-          SMI_Reduce(&reduce_mean_ch, &send_val, &recv_val);
-          // It doesn't matter that we write junk on non-0 ranks
-          means_reduced[w][d][k] = recv_val;
-        }
-      }
-    }
-
-    VTYPE centroids_updated[DIMS / W][K];
-
-    // printf("[%i] Starting centroid broadcast...\n", smi_rank);
-    SMI_BChannel __attribute__((register)) broadcast_mean_ch =
-        SMI_Open_bcast_channel(K * DIMS, SMI_FLOAT, 1, 0, comm);
-    #pragma loop_coalesce
-    for (int k = 0; k < K; ++k) {
-      for (int d = 0; d < DIMS / W; d++) {
-        VTYPE bcast_vec;
-        for (int w = 0; w < W; ++w) {
-          DTYPE bcast_val = means_reduced[w][d][k];
-          SMI_Bcast(&broadcast_mean_ch, &bcast_val);
-          bcast_vec[w] = bcast_val;
+          SMI_Allreduce(&allreduce_mean_ch, &send_val, &recv_val);
+          recv_vec[w] = recv_val;
         }
-        centroids_updated[d][k] = bcast_vec;
+        centroids_updated[d][k] = recv_vec;
       }
     }
 
-    int count_reduced[K];
-
-    // printf("[%i] Starting count reduce...\n", smi_rank);
-    SMI_RChannel __attribute__((register)) reduce_count_ch =
-        SMI_Open_reduce_channel(K, SMI_INT, SMI_ADD, 2, 0, comm);
-    for (int k = 0; k < K; k++) {
-      int send_val = count[k]; 
-      int recv_val;
-      SMI_Reduce(&reduce_count_ch, &send_val, &recv_val);
-      // Doesn't matter that this is junk on non-root ranks
-      count_reduced[k] = recv_val;
-    }
-
     int count_updated[K];
 
-    // printf("[%i] Starting count broadcast...\n", smi_rank);
-    SMI_BChannel __attribute__((register)) broadcast_count_ch =
-        SMI_Open_bcast_channel(K, SMI_INT, 3, 0, comm);
+    // printf("[%i] Starting count allreduce...\n", smi_rank);
+    SMI_ARChannel __attribute__((register)) allreduce_count_ch =
+        SMI_Open_allreduce_channel(K, SMI_INT, SMI_ADD, 1, comm);
     for (int k = 0; k < K; k++) {
-      int bcast_val = count_reduced[k];
-
-      SMI_Bcast(&broadcast_count_ch, &bcast_val);
-      count_updated[k] = bcast_val;
+      int send_val = count[k];
+      int recv_val;
+      SMI_Allreduce(&allreduce_count_ch, &send_val, &recv_val);
+      count_updated[k] = recv_val;
     }
 
     // printf("[%i] Writing back centroids...\n", smi_rank);
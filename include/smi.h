@@ -14,8 +14,12 @@
 #include "smi/communicator.h"
 #include "smi/push.h"
 #include "smi/pop.h"
+#include "smi/persistent.h"
 #include "smi/bcast.h"
 #include "smi/reduce.h"
+#include "smi/allreduce.h"
 #include "smi/gather.h"
 #include "smi/scatter.h"
+#include "smi/allgather.h"
+#include "smi/alltoall.h"
 #endif // SMI_H
@@ -0,0 +1,68 @@
+#ifndef ALLGATHER_H
+#define ALLGATHER_H
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+
+/**
+  @file allgather.h
+  This file contains the channel descriptor, open channel
+  and communication primitive for allgather
+*/
+
+
+#include "data_types.h"
+#include "header_message.h"
+#include "operation_type.h"
+#include "network_message.h"
+#include "communicator.h"
+
+typedef struct __attribute__((packed)) __attribute__((aligned(64))){
+    SMI_Network_message net;        //buffered network message, used to send the contribution of this rank
+    SMI_Network_message net_2;      //buffered network message, used to receive the contributions of the other ranks
+    char port;
+    SMI_Rank my_rank;
+    SMI_Rank num_rank;
+    SMI_Rank next_contrib;          //the rank of the contribution that is currently received
+    int send_count;                 //number of data elements sent by each rank
+    int recv_count;                 //number of data elements received by each rank (i.e. num_ranks*send_count)
+    int processed_elements;         //number of elements processed for the current contribution
+    char packet_element_id;         //given a packet, the id of the element that we are currently processing (from 0 to the data elements per packet)
+    char packet_element_id_rcv;     //used by the receivers
+    char data_type;                 //type of message
+    char size_of_type;              //size of data type
+    char elements_per_packet;       //number of data elements per packet
+    bool init;                      //true when the channel is opened, false when the support kernel has been configured
+}SMI_AllgatherChannel;
+
+/**
+ * @brief SMI_Open_allgather_channel opens an allgather channel
+ * @param send_count number of data elements transmitted by each rank
+ * @param recv_count number of data elements received by each rank (i.e. num_ranks*send_count)
+ * @param data_type type of the channel
+ * @param port port number
+ * @param comm communicator
+ * @return the channel descriptor
+ */
+SMI_AllgatherChannel SMI_Open_allgather_channel(int send_count, int recv_count, SMI_Datatype data_type, int port, SMI_Comm comm);
+
+/**
+ * @brief SMI_Open_allgather_channel_ad opens an allgather channel with a given asynchronicity degree
+ * @param send_count number of data elements transmitted by each rank
+ * @param recv_count number of data elements received by each rank (i.e. num_ranks*send_count)
+ * @param data_type type of the channel
+ * @param port port number
+ * @param comm communicator
+ * @param asynch_degree the asynchronicity degree expressed in number of data elements
+ * @return the channel descriptor
+ */
+SMI_AllgatherChannel SMI_Open_allgather_channel_ad(int send_count, int recv_count, SMI_Datatype data_type, int port, SMI_Comm comm, int asynch_degree);
+
+/**
+ * @brief SMI_Allgather must be called recv_count times by every rank: the received elements are
+ * ordered by contributing rank, and the send_count calls of the turn of the caller send its data elements
+ * @param chan pointer to the allgather channel descriptor
+ * @param data_snd pointer to the data element that must be sent (significant during the turn of the caller only)
+ * @param data_rcv pointer to the receiving data element
+ */
+void SMI_Allgather(SMI_AllgatherChannel *chan, void* send_data, void* rcv_data);
+
+#endif // ALLGATHER_H
@@ -0,0 +1,72 @@
+#ifndef ALLREDUCE_H
+#define ALLREDUCE_H
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+
+/**
+  @file allreduce.h
+  This file contains the channel descriptor, open channel
+  and communication primitive for allreduce
+*/
+
+
+#include "data_types.h"
+#include "header_message.h"
+#include "network_message.h"
+#include "operation_type.h"
+#include "communicator.h"
+#include "reduce.h"
+
+// Default shape of the allreduce tree, rooted at rank 0: the partial results are combined along the tree
+// and the reduced elements are sent back along the same tree. 0 (flat): all the ranks are children of rank 0
+#ifndef SMI_ALLREDUCE_FANOUT
+#define SMI_ALLREDUCE_FANOUT 2
+#endif
+
+/**
+    Channel descriptor for allreduce
+*/
+typedef struct __attribute__((packed)) __attribute__((aligned(64))){
+    SMI_Network_message net;            //buffered network message
+    char port;
+    SMI_Rank my_rank;                   //communicator infos
+    SMI_Rank num_rank;
+    unsigned int message_size;          //given in number of data elements
+    SMI_Datatype data_type;             //type of message
+    char size_of_type;                  //size of data type
+    char reduce_op;                     //applied reduce operation
+    SMI_Rank fanout;                    //children per rank in the allreduce tree (0: flat), same on all the ranks
+}SMI_ARChannel;
+
+
+/**
+ * @brief SMI_Open_allreduce_channel opens a transient allreduce channel
+ * @param count number of data elements to reduce
+ * @param data_type type of the channel
+ * @param op applied reduce operation
+ * @param port port number
+ * @param comm communicator
+ * @return the channel descriptor. Its fanout (SMI_ALLREDUCE_FANOUT) can be changed before the first call to SMI_Allreduce
+ */
+SMI_ARChannel SMI_Open_allreduce_channel(int count, SMI_Datatype data_type, SMI_Op op, int port, SMI_Comm comm);
+
+/**
+ * @brief SMI_Open_allreduce_channel_ad opens a transient allreduce channel with a given asynchronicity degree
+ * @param count number of data elements to reduce
+ * @param data_type type of the channel
+ * @param op applied reduce operation
+ * @param port port number
+ * @param comm communicator
+ * @param asynch_degree the asynchronicity degree expressed in number of data elements
+ * @return the channel descriptor
+ */
+SMI_ARChannel SMI_Open_allreduce_channel_ad(int count, SMI_Datatype data_type, SMI_Op op, int port, SMI_Comm comm, int asynch_degree);
+
+/**
+ * @brief SMI_Allreduce
+ * @param chan pointer to the allreduce channel descriptor
+ * @param data_snd pointer to the data element that must be reduced
+ * @param data_rcv pointer to the receiving data element (all the ranks)
+ */
+void SMI_Allreduce(SMI_ARChannel *chan,  void* data_snd, void* data_rcv);
+
+#endif // ALLREDUCE_H
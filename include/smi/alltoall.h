@@ -0,0 +1,67 @@
+#ifndef ALLTOALL_H
+#define ALLTOALL_H
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+
+/**
+  @file alltoall.h
+  This file contains the channel descriptor, open channel
+  and communication primitive for alltoall
+*/
+
+
+#include "data_types.h"
+#include "header_message.h"
+#include "operation_type.h"
+#include "network_message.h"
+#include "communicator.h"
+
+typedef struct __attribute__((packed)) __attribute__((aligned(64))){
+    SMI_Network_message net;        //buffered network message, used to send to the current destination
+    char port;
+    SMI_Rank my_rank;
+    SMI_Rank num_rank;
+    SMI_Rank step;                  //the caller sends to my_rank+step and receives from my_rank-step
+    int count;                      //number of data elements exchanged with every rank
+    int processed_elements;         //number of elements sent (and received) in the current step
+    int received_elements;          //number of elements received from the current source
+    int received_packets;           //number of packets received since the last credits
+    char packet_element_id;         //given a packet, the id of the element that we are currently processing (from 0 to the data elements per packet)
+    char data_type;                 //type of message
+    char size_of_type;              //size of data type
+    char elements_per_packet;       //number of data elements per packet
+}SMI_AlltoallChannel;
+
+/**
+ * @brief SMI_Open_alltoall_channel opens an alltoall channel
+ * @param count number of data elements sent to (and received from) every rank
+ * @param data_type type of the channel
+ * @param port port number
+ * @param comm communicator
+ * @return the channel descriptor
+ */
+SMI_AlltoallChannel SMI_Open_alltoall_channel(int count, SMI_Datatype data_type, int port, SMI_Comm comm);
+
+/**
+ * @brief SMI_Open_alltoall_channel_ad opens an alltoall channel with a given asynchronicity degree
+ * @param count number of data elements sent to (and received from) every rank
+ * @param data_type type of the channel
+ * @param port port number
+ * @param comm communicator
+ * @param asynch_degree the asynchronicity degree expressed in number of data elements
+ * @return the channel descriptor
+ */
+SMI_AlltoallChannel SMI_Open_alltoall_channel_ad(int count, SMI_Datatype data_type, int port, SMI_Comm comm, int asynch_degree);
+
+/**
+ * @brief SMI_Alltoall must be called count*num_ranks times by every rank. The calls are grouped in steps
+ * of count elements: in step s (0 <= s < num_ranks) the caller sends to rank (my_rank + s) % num_ranks and
+ * receives from rank (my_rank - s + num_ranks) % num_ranks, so that every rank has a different destination.
+ * The received elements are stored in the receive buffer as they arrive, while the caller keeps sending: element i
+ * of step s is at index s * count + i, and all the elements of a step are there when its last call returns.
+ * @param chan pointer to the alltoall channel descriptor
+ * @param data_snd pointer to the data element that must be sent
+ * @param data_rcv pointer to the receive buffer (count * num_ranks elements), the same in all the calls
+ */
+void SMI_Alltoall(SMI_AlltoallChannel *chan, void* data_snd, void* data_rcv);
+
+#endif // ALLTOALL_H
@@ -14,11 +14,17 @@
 #include "network_message.h"
 #include "communicator.h"
 
+// the ranks of a broadcast form a tree rooted at the root rank, in which every rank forwards the received
+// packets to at most SMI_BCAST_FANOUT children (1: chain). All the ranks must use the same value.
+#ifndef SMI_BCAST_FANOUT
+#define SMI_BCAST_FANOUT 2
+#endif
+
 typedef struct __attribute__((packed)) __attribute__((aligned(64))){
     SMI_Network_message net;            //buffered network message
-    char root_rank;
-    char my_rank;                       //These two are essentially the Communicator
-    char num_rank;
+    SMI_Rank root_rank;
+    SMI_Rank my_rank;                   //These two are essentially the Communicator
+    SMI_Rank num_rank;
     char port;                          //Port number
     unsigned int message_size;          //given in number of data elements
     unsigned int processed_elements;    //how many data elements we have sent/received
@@ -61,4 +67,13 @@ SMI_BChannel SMI_Open_bcast_channel_ad(int count, SMI_Datatype data_type, int po
     on the non-root rank will be the received element
  */
 void SMI_Bcast(SMI_BChannel *chan, void* data);
+
+/**
+ * @brief SMI_Bcast_vec broadcasts a whole network packet of data elements (SMI_<TYPE>_ELEM_PER_PCKT, the last one
+ *  can contain less elements). It can not be interleaved with SMI_Bcast in the same packet.
+ * @param chan pointer to the broadcast channel descriptor
+ * @param data pointer to the data elements: on the root rank they will be transmitted,
+    on the non-root rank they will be the received elements
+ */
+void SMI_Bcast_vec(SMI_BChannel *chan, void* data);
 #endif // BCAST_H
@@ -16,8 +16,8 @@
 
 typedef struct __attribute__((packed)) __attribute__((aligned(64))){
     SMI_Network_message net;            //buffered network message
-    char sender_rank;                   //rank of the sender
-    char receiver_rank;                 //rank of the receiver
+    SMI_Rank sender_rank;               //rank of the sender (of the last received data, on any-source channels)
+    SMI_Rank receiver_rank;             //rank of the receiver
     char port;                          //channel port
     unsigned int message_size;          //given in number of data elements
     unsigned int processed_elements;    //how many data elements we have sent/received so far
@@ -28,6 +28,9 @@ typedef struct __attribute__((packed)) __attribute__((aligned(64))){
     char elements_per_packet;           //number of data elements per packet
     volatile unsigned int tokens;       //current number of tokens (one tokens allow the sender to transmit one data element)
     unsigned int max_tokens;            //max tokens on the sender side
+    char burst_flits;                   //payload flits staged (Push) or still to be received (Pop) in the current burst
+    char burst_last_elems;              //number of data elements in the last flit of the current burst (Pop)
+    char persistent;                    //opened with SMI_Open_persistent_*: the tokens are exchanged as if its messages were a single stream
 }SMI_Channel;
 
 #endif
@@ -7,11 +7,21 @@
 
 //Note: Since the Intel compiler fails in compiling the emulation if you pass a user-defined
 //data type, we had to define it by resorting to OpenCL data types: the first element
-//will be "my_rank" and the second the number of ranks
+//will be "my_rank" and the second the number of ranks (16 bit wide in wide-rank mode)
 #if defined __HOST_PROGRAM__
+#if defined SMI_WIDE_RANKS
+typedef cl_short2 SMI_Comm;
+typedef cl_short SMI_Rank;
+#else
 typedef cl_char2 SMI_Comm;
+typedef cl_char SMI_Rank;
+#endif
+#else
+#if defined SMI_WIDE_RANKS
+typedef short2 SMI_Comm;
 #else
 typedef char2 SMI_Comm;
+#endif
 /**
  * @brief SMI_Comm_size return the communicator size
  * @param comm
@@ -15,17 +15,24 @@
 #include "network_message.h"
 #include "communicator.h"
 
+// Number of contributors that the root receives from at the same time: their data is buffered by the support
+// kernel of the root (the buffer size of the port, in packets, for every contributor) and delivered in rank order.
+// 1 gives a contributor at a time
+#ifndef SMI_GATHER_CONCURRENCY
+#define SMI_GATHER_CONCURRENCY 4
+#endif
+
 typedef struct __attribute__((packed)) __attribute__((aligned(64))){
     SMI_Network_message net;        //buffered network message
     int recv_count;                 //number of data elements that will be received by the root
     char port;
     int processed_elements_root;    //number of elements processed by the root
     char packet_element_id_rcv;     //used by the receivers
-    char next_contrib;              //the rank of the next contributor
-    char my_rank;
-    char num_rank;
-    char root_rank;
-    SMI_Network_message net_2;      //buffered network message, used by root rank to send synchronization messages
+    SMI_Rank next_contrib;          //the rank of the next contributor
+    SMI_Rank my_rank;
+    SMI_Rank num_rank;
+    SMI_Rank root_rank;
+    SMI_Network_message net_2;      //buffered network message, used by root rank to configure the support kernel
     int send_count;                 //number of elements sent by each non-root ranks
     int processed_elements;         //how many data elements we have sent (non-root)
     char packet_element_id;         //given a packet, the id of the element that we are currently processing (from 0 to the data elements per packet)
@@ -5,25 +5,62 @@
 #ifndef HEADER_MESSAGE_H
 #define HEADER_MESSAGE_H
 
+#ifndef SMI_MESSAGE_WIDTH
+#define SMI_MESSAGE_WIDTH 256   // width in bits of a network message (256 or 512)
+#endif
+
+// rank ids are 8 bits wide, or 16 bits wide in wide-rank mode (clusters with more than 127 ranks)
+#if defined SMI_WIDE_RANKS
+typedef short SMI_Rank;
+#else
+typedef char SMI_Rank;
+#endif
+
 #define GET_HEADER_SRC(H) (H.src)
 #define GET_HEADER_DST(H) (H.dst)
-#define GET_HEADER_PORT(H) (H.port)
-#define GET_HEADER_OP(H) ((char)H.elems_and_op & (char)7)
-#define GET_HEADER_NUM_ELEMS(H) ((char)H.elems_and_op >> ((char)3))   //returns the number of valid data elements in the packet
+#define GET_HEADER_PORT(H) (H.port & 127)
 #define SET_HEADER_SRC(H,S) (H.src=S)
 #define SET_HEADER_DST(H,D) (H.dst=D)
-#define SET_HEADER_PORT(H,P) (H.port=P)
+#define SET_HEADER_PORT(H,P) (H.port=P)     //also resets the virtual channel: messages are injected on the first one
+
+// with dateline virtual channels, the upper bit of the port contains the virtual channel of the message:
+// it becomes 1 when the message crosses a dateline and it is ignored by the ports
+#define GET_HEADER_VC(H) ((unsigned char)H.port >> 7)
+#define SET_HEADER_VC(H,V) (H.port=((H.port & 127) | ((V) << 7)))
+
+// logical port of the messages that return the credits of the virtual channels of a QSFP link
+#define SMI_VC_CREDITS_PORT 127
+
+#if SMI_MESSAGE_WIDTH == 512
+#define GET_HEADER_OP(H) (H.op)
+#define GET_HEADER_NUM_ELEMS(H) (H.elems)   //returns the number of valid data elements in the packet
+#define SET_HEADER_OP(H,O) (H.op=O)
+#define SET_HEADER_NUM_ELEMS(H,N) (H.elems=N)
+
+
+typedef struct __attribute__((packed)) {
+    SMI_Rank src;
+    SMI_Rank dst;
+    char port;
+    char op;                //type of operation
+    unsigned char elems;    //number of valid data elements in the packet (up to 59 chars, 57 with wide ranks)
+
+}SMI_Message_header;
+#else
+#define GET_HEADER_OP(H) ((char)H.elems_and_op & (char)7)
+#define GET_HEADER_NUM_ELEMS(H) ((unsigned char)H.elems_and_op >> ((char)3))   //returns the number of valid data elements in the packet
 #define SET_HEADER_OP(H,O) (H.elems_and_op=((H.elems_and_op & 248) | O & 7))
 #define SET_HEADER_NUM_ELEMS(H,N) (H.elems_and_op=((H.elems_and_op &7) | (N << 3))) //By assumption N < 32
 
 
 typedef struct __attribute__((packed)) {
-    char src;
-    char dst;
+    SMI_Rank src;
+    SMI_Rank dst;
     char port;
     char elems_and_op;    //upper 5 bits contain the number of valid data elements in the packet
                           //lower 3 bit contain the type of operation
 
 }SMI_Message_header;
+#endif
 
 #endif //ifndef HEADER_MESSAGE_H
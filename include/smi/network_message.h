@@ -5,20 +5,35 @@
 
 
 /**
- * Message sent over the network. 256 bits wide. It contains
+ * Message sent over the network. SMI_MESSAGE_WIDTH (256 or 512) bits wide. It contains
  * - an array of char that will hold the actual data
  * - the header
  */
 
 #include "header_message.h"
 
-typedef struct __attribute__((packed)) __attribute__((aligned(32))){
+#define SMI_MESSAGE_BYTES (SMI_MESSAGE_WIDTH / 8)
+#if SMI_MESSAGE_WIDTH == 512
+#if defined SMI_WIDE_RANKS
+#define SMI_PACKET_PAYLOAD_SIZE 57
+#else
+#define SMI_PACKET_PAYLOAD_SIZE 59
+#endif
+#else
+#if defined SMI_WIDE_RANKS
+#define SMI_PACKET_PAYLOAD_SIZE 26
+#else
+#define SMI_PACKET_PAYLOAD_SIZE 28
+#endif
+#endif
+
+typedef struct __attribute__((packed)) __attribute__((aligned(SMI_MESSAGE_BYTES))){
     union{
-        struct __attribute__((packed)) __attribute__((aligned(32))){
-            char data[28];
+        struct __attribute__((packed)) __attribute__((aligned(SMI_MESSAGE_BYTES))){
+            char data[SMI_PACKET_PAYLOAD_SIZE];
             SMI_Message_header header;
         };
-        char padding_[32];
+        char padding_[SMI_MESSAGE_BYTES];
     };
 }SMI_Network_message;
 
@@ -30,17 +45,17 @@ typedef struct __attribute__((packed)) __attribute__((aligned(32))){
 #define SMI_FLOAT_TYPE_SIZE     4
 #define SMI_DOUBLE_TYPE_SIZE    8
 
-#define SMI_CHAR_ELEM_PER_PCKT      28
-#define SMI_SHORT_ELEM_PER_PCKT     14
-#define SMI_INT_ELEM_PER_PCKT       7
-#define SMI_FLOAT_ELEM_PER_PCKT     7
-#define SMI_DOUBLE_ELEM_PER_PCKT    3
+#define SMI_CHAR_ELEM_PER_PCKT      (SMI_PACKET_PAYLOAD_SIZE / SMI_CHAR_TYPE_SIZE)
+#define SMI_SHORT_ELEM_PER_PCKT     (SMI_PACKET_PAYLOAD_SIZE / SMI_SHORT_TYPE_SIZE)
+#define SMI_INT_ELEM_PER_PCKT       (SMI_PACKET_PAYLOAD_SIZE / SMI_INT_TYPE_SIZE)
+#define SMI_FLOAT_ELEM_PER_PCKT     (SMI_PACKET_PAYLOAD_SIZE / SMI_FLOAT_TYPE_SIZE)
+#define SMI_DOUBLE_ELEM_PER_PCKT    (SMI_PACKET_PAYLOAD_SIZE / SMI_DOUBLE_TYPE_SIZE)
 
 /*
  * These two macro are used to manage network data.
- * They are generic and used in collective/p2p.
- * When a specialized version is needed, they are directly encapuslated in the
- * communication primitive code
+ * They are generic: they select the data type at run time.
+ * The generated communication primitives use versions specialized for the
+ * data type of their port (see pack/unpack in codegen/templates/utils.cl)
  */
 
 /**
@@ -0,0 +1,23 @@
+/**
+    Persistent point-to-point channels
+*/
+
+#ifndef PERSISTENT_H
+#define PERSISTENT_H
+#include "channel_descriptor.h"
+
+/**
+ * @brief SMI_Start starts a new message on a persistent channel (opened with SMI_Open_persistent_send_channel
+ *  or SMI_Open_persistent_receive_channel), after the previous one has been completely pushed/popped
+ * @param chan pointer to the channel descriptor of the persistent channel
+ */
+void SMI_Start(SMI_Channel *chan);
+
+/**
+ * @brief SMI_Free_channel frees a persistent channel after its last message: the receiver returns the remaining
+ *  tokens and the sender waits for them, so that the port can be used by other channels
+ * @param chan pointer to the channel descriptor of the persistent channel
+ */
+void SMI_Free_channel(SMI_Channel *chan);
+
+#endif //ifndef PERSISTENT_H
@@ -7,12 +7,17 @@
 #include "channel_descriptor.h"
 #include "communicator.h"
 
+// source of a receive channel that accepts data from any rank (only on the ports listed in any_source_ports)
+#define SMI_ANY_SOURCE -1
+
 
 /**
- * @brief SMI_Open_receive_channel opens a receive transient channel
+ * @brief SMI_Open_receive_channel opens a receive transient channel. With source SMI_ANY_SOURCE the data elements
+ *  can be sent by any rank (in packets of the same sender): the rank of the sender of the last received element is
+ *  available in the sender_rank field of the channel descriptor
  * @param count number of data elements to receive
  * @param data_type data type of the data elements
- * @param source rank of the sender
+ * @param source rank of the sender (or SMI_ANY_SOURCE)
  * @param port port number
  * @param comm communicator
  * @return channel descriptor
@@ -31,6 +36,18 @@ SMI_Channel SMI_Open_receive_channel(int count, SMI_Datatype data_type, int sour
  */
 SMI_Channel SMI_Open_receive_channel_ad(int count, SMI_Datatype data_type, int source, int port, SMI_Comm comm, int asynch_degree);
 
+/**
+ * @brief SMI_Open_persistent_receive_channel opens a receive persistent channel, used for a message of count data
+ *  elements every time it is started with SMI_Start (see SMI_Open_persistent_send_channel)
+ * @param count number of data elements of every message
+ * @param data_type data type of the data elements
+ * @param source rank of the sender
+ * @param port port number
+ * @param comm communicator
+ * @return channel descriptor
+ */
+SMI_Channel SMI_Open_persistent_receive_channel(int count, SMI_Datatype data_type, int source, int port, SMI_Comm comm);
+
 /**
  * @brief SMI_Pop: receive a data element. Returns only when data arrives
  * @param chan pointer to the transient channel descriptor
@@ -38,4 +55,20 @@ SMI_Channel SMI_Open_receive_channel_ad(int count, SMI_Datatype data_type, int s
  */
 void SMI_Pop(SMI_Channel *chan, void *data);
 
+/**
+ * @brief SMI_Pop_vec: receive a whole network packet of data elements (see SMI_Push_vec). Returns only when data arrives
+ * @param chan pointer to the transient channel descriptor
+ * @param data pointer to the target array that, on return, will contain the data elements of the packet
+ */
+void SMI_Pop_vec(SMI_Channel *chan, void *data);
+
+/**
+ * @brief SMI_Pop_nb: non-blocking version of SMI_Pop, as read_channel_nb_intel. It can be used to serve several
+ *  channels in the same kernel
+ * @param chan pointer to the transient channel descriptor
+ * @param data pointer to the target variable
+ * @return 1 if a data element has been received (and stored in data), 0 if no data has arrived
+ */
+int SMI_Pop_nb(SMI_Channel *chan, void *data);
+
 #endif //ifndef POP_H
@@ -31,6 +31,20 @@ SMI_Channel SMI_Open_send_channel(int count, SMI_Datatype data_type, int destina
  */
 SMI_Channel SMI_Open_send_channel_ad(int count, SMI_Datatype data_type, int destination, int port, SMI_Comm comm, int asynch_degree);
 
+/**
+ * @brief SMI_Open_persistent_send_channel opens a sending persistent channel, used for a message of count data
+ *  elements every time it is started with SMI_Start. The tokens are kept from one message to the next one, so
+ *  the messages do not wait for the receiver at their end. The channel must be freed with SMI_Free_channel
+ *  before the port can be used by other channels
+ * @param count number of data elements of every message
+ * @param data_type type of the data element
+ * @param destination rank of the destination
+ * @param port port number
+ * @param comm communicator
+ * @return channel descriptor
+ */
+SMI_Channel SMI_Open_persistent_send_channel(int count, SMI_Datatype data_type, int destination, int port, SMI_Comm comm);
+
 /**
  * @brief private function SMI_Push push a data elements in the transient channel. Data transferring can be delayed
  * @param chan
@@ -47,4 +61,25 @@ void SMI_Push_flush(SMI_Channel *chan, void* data, int immediate);
  */
 void SMI_Push(SMI_Channel *chan, void* data);
 
+/**
+ * @brief SMI_Push_vec push a whole network packet of data elements in the transient channel, without
+ *  selecting the position of every element in the packet. A packet contains SMI_<TYPE>_ELEM_PER_PCKT elements
+ *  (SMI_MESSAGE_BYTES / SMI_<TYPE>_TYPE_SIZE if bursts are enabled), the last one can contain less elements.
+ *  It can not be interleaved with SMI_Push in the same packet.
+ * @param chan pointer to the channel descriptor of the transient channel
+ * @param data pointer to the data elements that can be sent (a whole packet is read)
+ */
+void SMI_Push_vec(SMI_Channel *chan, void* data);
+
+/**
+ * @brief SMI_Push_nb non-blocking version of SMI_Push: the data element is pushed only if it can be sent without
+ *  waiting (e.g. for the tokens of the receiver or for a full network packet to be accepted), otherwise the
+ *  channel is left untouched and the push has to be retried. The last element of a message waits for the
+ *  receiver as in SMI_Push
+ * @param chan pointer to the channel descriptor of the transient channel
+ * @param data pointer to the data that can be sent
+ * @return 1 if the data element has been pushed, 0 otherwise
+ */
+int SMI_Push_nb(SMI_Channel *chan, void* data);
+
 #endif //ifndef PUSH_H
@@ -21,15 +21,21 @@ typedef enum{
     SMI_MIN = 2
 }SMI_Op;
 
+// Default shape of the reduce tree: every rank combines its contribution with the partial results of at most
+// SMI_REDUCE_FANOUT children (1: chain) and forwards them to its parent. 0 (flat): every rank sends to the root.
+#ifndef SMI_REDUCE_FANOUT
+#define SMI_REDUCE_FANOUT 0
+#endif
+
 /**
     Channel descriptor for reduce
 */
 typedef struct __attribute__((packed)) __attribute__((aligned(64))){
     SMI_Network_message net;            //buffered network message
     char port;                          //Output channel for the bcast, used by the root
-    char root_rank;
-    char my_rank;                       //communicator infos
-    char num_rank;
+    SMI_Rank root_rank;
+    SMI_Rank my_rank;                   //communicator infos
+    SMI_Rank num_rank;
     unsigned int message_size;          //given in number of data elements
     unsigned int processed_elements;    //how many data elements we have sent/received
     char packet_element_id;             //given a packet, the id of the element that we are currently processing (from 0 to the data elements per packet)
@@ -39,6 +45,7 @@ typedef struct __attribute__((packed)) __attribute__((aligned(64))){
     SMI_Network_message net_2;          //buffered network message (we need two of them to remove aliasing)
     char packet_element_id_rcv;         //used by the receivers
     char reduce_op;                     //applied reduce operation
+    SMI_Rank fanout;                    //children per rank in the reduce tree (0: flat), same on all the ranks
 }SMI_RChannel;
 
 
@@ -50,7 +57,7 @@ typedef struct __attribute__((packed)) __attribute__((aligned(64))){
  * @param port port number
  * @param root rank of the root
  * @param comm communicator
- * @return the channel descriptor
+ * @return the channel descriptor. Its fanout (SMI_REDUCE_FANOUT) can be changed before the first call to SMI_Reduce
  */
 SMI_RChannel SMI_Open_reduce_channel(int count, SMI_Datatype data_type, SMI_Op op, int port, int root, SMI_Comm comm);
 
@@ -20,9 +20,9 @@
 typedef struct __attribute__((packed)) __attribute__((aligned(64))){
     SMI_Network_message net;            //buffered network message
     char port;                          //port
-    char root_rank;
-    char my_rank;                       //rank of the caller
-    char num_ranks;                     //total number of ranks
+    SMI_Rank root_rank;
+    SMI_Rank my_rank;                   //rank of the caller
+    SMI_Rank num_ranks;                 //total number of ranks
     unsigned int send_count;            //given in number of data elements
     unsigned int recv_count;            //given in number of data elements
     unsigned int processed_elements;    //how many data elements we have sent/received
@@ -32,8 +32,9 @@ typedef struct __attribute__((packed)) __attribute__((aligned(64))){
     char size_of_type;                  //size of data type
     char elements_per_packet;           //number of data elements per packet
     char packet_element_id_rcv;         //used by the receivers
-    char next_rcv;                      //the  rank of the next receiver
+    SMI_Rank next_rcv;                  //the  rank of the next receiver
     bool init;                          //true when the channel is opened, false when synchronization message has been sent
+    unsigned int received_packets;      //packets received since the last credits returned to the root (non root ranks)
 }SMI_ScatterChannel;
 
 /**
@@ -0,0 +1,364 @@
+/**
+  This file contains the native (CPU) runtime used to execute SMI programs
+  without the Intel FPGA SDK.
+
+  The generated device code and the (rewritten) user kernels are compiled as C++:
+  every kernel becomes a host thread and every Intel channel becomes a lock-free
+  bounded single-producer/single-consumer queue with the same depth declared in
+  the device code. The QSFP connections between ranks are queues shared through
+  a process-wide registry, looked up by the same names used by the emulator.
+*/
+
+#ifndef NATIVE_UTILS_HPP
+#define NATIVE_UTILS_HPP
+
+#include <array>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+    OpenCL C keywords and attributes that have no meaning on the host
+*/
+#define __kernel
+#define __global
+#define __local
+#define __private
+#define __constant const
+#define restrict __restrict
+#define CLK_CHANNEL_MEM_FENCE 0
+#define CLK_GLOBAL_MEM_FENCE 0
+#define CLK_LOCAL_MEM_FENCE 0
+
+/**
+    OpenCL vector types used by the communicator (see communicator.h)
+*/
+struct char2
+{
+    char2(char x = 0, char y = 0) : s{x, y} { }
+    char& operator[](int i) { return s[i]; }
+    char operator[](int i) const { return s[i]; }
+    char s[2];
+};
+
+struct short2
+{
+    short2(short x = 0, short y = 0) : s{x, y} { }
+    short& operator[](int i) { return s[i]; }
+    short operator[](int i) const { return s[i]; }
+    short s[2];
+};
+
+#include <smi.h>
+
+namespace smi_native
+{
+/**
+ * @brief Stopped is thrown inside a kernel thread when the runtime is shut down
+ * while the kernel is waiting on a channel
+ */
+struct Stopped { };
+
+inline std::atomic<bool>& stop_flag()
+{
+    static std::atomic<bool> flag(false);
+    return flag;
+}
+
+constexpr int kSpinsBeforeYield = 64;
+constexpr int kSpinsBeforeSleep = 1 << 16;
+constexpr int kSleepMicroseconds = 50;
+
+/**
+ * @brief Backoff is used when spinning on a channel: after a number of failed
+ * attempts the thread first yields and then sleeps, so that the native backend
+ * remains usable with many more kernel threads than cores
+ */
+class Backoff
+{
+public:
+    void pause()
+    {
+        if (stop_flag().load(std::memory_order_relaxed))
+        {
+            throw Stopped();
+        }
+        this->spins++;
+        if (this->spins >= kSpinsBeforeSleep)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(kSleepMicroseconds));
+        }
+        else if (this->spins >= kSpinsBeforeYield)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    void reset()
+    {
+        this->spins = 0;
+    }
+
+private:
+    int spins = 0;
+};
+
+/**
+ * @brief Channel is a lock-free bounded SPSC queue that models an Intel channel
+ * with the given depth
+ */
+template <typename T, size_t Depth>
+class Channel
+{
+public:
+    static constexpr size_t kCapacity = Depth > 0 ? Depth : 1;
+
+    bool try_write(const T& value)
+    {
+        const size_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - this->head.load(std::memory_order_acquire) == kCapacity)
+        {
+            return false;
+        }
+        this->buffer[tail % kCapacity] = value;
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_read(T& value)
+    {
+        const size_t head = this->head.load(std::memory_order_relaxed);
+        if (head == this->tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        value = this->buffer[head % kCapacity];
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    std::array<T, kCapacity> buffer;
+};
+
+/**
+ * @brief KernelBackoff is used by the non-blocking reads of a kernel thread: the kernel
+ * backs off only after a whole pass over the channels that it polls has missed (the
+ * channel of the first miss is polled again), and any read or write resets it
+ */
+class KernelBackoff
+{
+public:
+    void miss(const void* channel)
+    {
+        if (this->first_miss == nullptr)
+        {
+            this->first_miss = channel;
+            this->pass_misses = 0;
+        }
+        else if (this->first_miss == channel || this->pass_misses == kMaxPassMisses)
+        {
+            // the pass is also closed if the kernel stops polling the channel of the first miss
+            this->backoff.pause();
+            this->first_miss = channel;
+            this->pass_misses = 0;
+        }
+        this->pass_misses++;
+    }
+
+    void progress()
+    {
+        this->first_miss = nullptr;
+        this->backoff.reset();
+    }
+
+private:
+    static constexpr int kMaxPassMisses = 64;
+
+    const void* first_miss = nullptr;
+    int pass_misses = 0;
+    Backoff backoff;
+};
+
+inline KernelBackoff& kernel_backoff()
+{
+    static thread_local KernelBackoff backoff;
+    return backoff;
+}
+
+template <typename T>
+struct Identity
+{
+    using type = T;
+};
+
+/**
+    Intel channel built-ins (found through ADL from the generated code)
+*/
+template <typename T, size_t Depth>
+T read_channel_intel(Channel<T, Depth>& channel)
+{
+    T value{};
+    Backoff backoff;
+    while (!channel.try_read(value))
+    {
+        backoff.pause();
+    }
+    kernel_backoff().progress();
+    return value;
+}
+
+template <typename T, size_t Depth>
+T read_channel_nb_intel(Channel<T, Depth>& channel, bool* valid)
+{
+    // the generated code may copy fields out of a failed read
+    T value{};
+    *valid = channel.try_read(value);
+    if (*valid)
+    {
+        kernel_backoff().progress();
+    }
+    else kernel_backoff().miss(&channel);
+    return value;
+}
+
+template <typename T, size_t Depth>
+void write_channel_intel(Channel<T, Depth>& channel, typename Identity<T>::type value)
+{
+    Backoff backoff;
+    while (!channel.try_write(value))
+    {
+        backoff.pause();
+    }
+    kernel_backoff().progress();
+}
+
+template <typename T, size_t Depth>
+bool write_channel_nb_intel(Channel<T, Depth>& channel, typename Identity<T>::type value)
+{
+    const bool written = channel.try_write(value);
+    if (written)
+    {
+        kernel_backoff().progress();
+    }
+    return written;
+}
+
+/**
+ * @brief Network contains the channels that connect different ranks (QSFP),
+ * indexed by the emulated channel name
+ */
+class Network
+{
+public:
+    template <typename T, size_t Depth>
+    Channel<T, Depth>& channel(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->channels.find(name);
+        if (it == this->channels.end())
+        {
+            it = this->channels.emplace(name, std::make_shared<Channel<T, Depth>>()).first;
+        }
+        return *std::static_pointer_cast<Channel<T, Depth>>(it->second);
+    }
+
+private:
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<void>> channels;
+};
+
+inline Network& network()
+{
+    static Network instance;
+    return instance;
+}
+
+/**
+ * @brief Runtime owns the threads of the support kernels (CKS, CKR, collectives)
+ * and the memory of the routing tables
+ */
+class Runtime
+{
+public:
+    Runtime() = default;
+    Runtime(const Runtime&) = delete;
+    Runtime& operator=(const Runtime&) = delete;
+
+    ~Runtime()
+    {
+        this->stop();
+    }
+
+    template <typename F, typename... Args>
+    void launch(F kernel, Args... args)
+    {
+        this->threads.emplace_back([=]() {
+            try
+            {
+                kernel(args...);
+            }
+            catch (const Stopped&) { }
+        });
+    }
+
+    char* allocate(size_t size)
+    {
+        this->buffers.emplace_back(new char[size]());
+        return this->buffers.back().get();
+    }
+
+    /**
+     * @brief stop terminates all the launched kernels and waits for them
+     */
+    void stop()
+    {
+        stop_flag().store(true);
+        for (auto& thread: this->threads)
+        {
+            thread.join();
+        }
+        this->threads.clear();
+        stop_flag().store(false);
+    }
+
+private:
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<char[]>> buffers;
+};
+
+inline void load_routing_table(int rank, int channel, int num_entries,
+                               const std::string& routing_directory,
+                               const std::string& prefix, char* table)
+{
+    std::stringstream path;
+    path << routing_directory << "/" << prefix << "-rank" << rank << "-channel" << channel;
+
+    std::ifstream file(path.str(), std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Routing table " + path.str() + " not found.");
+    }
+    file.read(table, num_entries);
+}
+}
+
+inline void mem_fence(int)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+#endif // NATIVE_UTILS_HPP
@@ -0,0 +1,39 @@
+#include "allgather.h"
+#include "utils.h"
+
+using namespace clang;
+
+static OperationMetadata extractAllgather(CallExpr* channelDecl)
+{
+    return OperationMetadata("allgather",
+                             extractIntArg(channelDecl, 3),
+                             extractDataType(channelDecl, 2),
+                             extractBufferSize(channelDecl, 5)
+    );
+}
+
+OperationMetadata AllgatherExtractor::GetOperationMetadata(CallExpr* callExpr)
+{
+    return extractAllgather(extractChannelDecl(callExpr));
+}
+std::string AllgatherExtractor::CreateDeclaration(const std::string& callName, const OperationMetadata& metadata)
+{
+    return "void " + this->RenameCall(callName, metadata) + "(SMI_AllgatherChannel* chan, void* send_data, void* rcv_data);";
+}
+std::vector<std::string> AllgatherExtractor::GetFunctionNames()
+{
+    return {"SMI_Allgather"};
+}
+
+OperationMetadata AllgatherChannelExtractor::GetOperationMetadata(CallExpr* callExpr)
+{
+    return extractAllgather(callExpr);
+}
+std::string AllgatherChannelExtractor::CreateDeclaration(const std::string& callName, const OperationMetadata& metadata)
+{
+    return this->CreateChannelDeclaration(callName, metadata, "SMI_AllgatherChannel", "int send_count, int recv_count, SMI_Datatype data_type, int port, SMI_Comm comm");
+}
+std::string AllgatherChannelExtractor::GetChannelFunctionName()
+{
+    return "SMI_Open_allgather_channel";
+}
@@ -0,0 +1,40 @@
+#include "allreduce.h"
+#include "utils.h"
+
+using namespace clang;
+
+static OperationMetadata extractAllreduce(CallExpr* channelDecl)
+{
+    return OperationMetadata("allreduce",
+                             extractIntArg(channelDecl, 3),
+                             extractDataType(channelDecl, 1),
+                             extractBufferSize(channelDecl, 5),
+                             { {"op_type", formatReduceOp(extractIntArg(channelDecl, 2))} }
+    );
+}
+
+OperationMetadata AllreduceExtractor::GetOperationMetadata(CallExpr* callExpr)
+{
+    return extractAllreduce(extractChannelDecl(callExpr));
+}
+std::string AllreduceExtractor::CreateDeclaration(const std::string& callName, const OperationMetadata& metadata)
+{
+    return "void " + this->RenameCall(callName, metadata) + "(SMI_ARChannel* chan,  void* data_snd, void* data_rcv);";
+}
+std::vector<std::string> AllreduceExtractor::GetFunctionNames()
+{
+    return {"SMI_Allreduce"};
+}
+
+OperationMetadata AllreduceChannelExtractor::GetOperationMetadata(CallExpr* callExpr)
+{
+    return extractAllreduce(callExpr);
+}
+std::string AllreduceChannelExtractor::CreateDeclaration(const std::string& callName, const OperationMetadata& metadata)
+{
+    return this->CreateChannelDeclaration(callName, metadata, "SMI_ARChannel", "int count, SMI_Datatype data_type, SMI_Op op, int port, SMI_Comm comm");
+}
+std::string AllreduceChannelExtractor::GetChannelFunctionName()
+{
+    return "SMI_Open_allreduce_channel";
+}
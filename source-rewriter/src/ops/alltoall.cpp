@@ -0,0 +1,39 @@
+#include "alltoall.h"
+#include "utils.h"
+
+using namespace clang;
+
+static OperationMetadata extractAlltoall(CallExpr* channelDecl)
+{
+    return OperationMetadata("alltoall",
+                             extractIntArg(channelDecl, 2),
+                             extractDataType(channelDecl, 1),
+                             extractBufferSize(channelDecl, 4)
+    );
+}
+
+OperationMetadata AlltoallExtractor::GetOperationMetadata(CallExpr* callExpr)
+{
+    return extractAlltoall(extractChannelDecl(callExpr));
+}
+std::string AlltoallExtractor::CreateDeclaration(const std::string& callName, const OperationMetadata& metadata)
+{
+    return "void " + this->RenameCall(callName, metadata) + "(SMI_AlltoallChannel* chan, void* data_snd, void* data_rcv);";
+}
+std::vector<std::string> AlltoallExtractor::GetFunctionNames()
+{
+    return {"SMI_Alltoall"};
+}
+
+OperationMetadata AlltoallChannelExtractor::GetOperationMetadata(CallExpr* callExpr)
+{
+    return extractAlltoall(callExpr);
+}
+std::string AlltoallChannelExtractor::CreateDeclaration(const std::string& callName, const OperationMetadata& metadata)
+{
+    return this->CreateChannelDeclaration(callName, metadata, "SMI_AlltoallChannel", "int count, SMI_Datatype data_type, int port, SMI_Comm comm");
+}
+std::string AlltoallChannelExtractor::GetChannelFunctionName()
+{
+    return "SMI_Open_alltoall_channel";
+}
@@ -22,7 +22,7 @@ std::string BroadcastExtractor::CreateDeclaration(const std::string& callName, c
 }
 std::vector<std::string> BroadcastExtractor::GetFunctionNames()
 {
-    return {"SMI_Bcast"};
+    return {"SMI_Bcast", "SMI_Bcast_vec"};
 }
 
 OperationMetadata BroadcastChannelExtractor::GetOperationMetadata(CallExpr* callExpr)
@@ -0,0 +1,31 @@
+#include "persistent.h"
+#include "push.h"
+#include "pop.h"
+#include "utils.h"
+
+using namespace clang;
+
+OperationMetadata PersistentExtractor::GetOperationMetadata(CallExpr* callExpr)
+{
+    auto channelDecl = extractChannelDecl(callExpr);
+    auto callee = channelDecl->getDirectCallee();
+    assert(callee);
+    if (callee->getName().str() == "SMI_Open_persistent_send_channel")
+    {
+        return extractPush(channelDecl);
+    }
+    return extractPop(channelDecl);
+}
+std::string PersistentExtractor::RenameCall(const std::string& callName, const OperationMetadata& metadata)
+{
+    // the same port can be used by a sending and a receiving channel
+    return renamePortDataType(callName + "_" + metadata.operation, metadata);
+}
+std::string PersistentExtractor::CreateDeclaration(const std::string& callName, const OperationMetadata& metadata)
+{
+    return "void " + this->RenameCall(callName, metadata) + "(SMI_Channel* chan);";
+}
+std::vector<std::string> PersistentExtractor::GetFunctionNames()
+{
+    return {"SMI_Start", "SMI_Free_channel"};
+}
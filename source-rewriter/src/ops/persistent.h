@@ -0,0 +1,16 @@
+#pragma once
+
+#include "ops.h"
+
+/**
+ * Extracts the operations of the calls that are shared by the sending and receiving persistent channels
+ * (SMI_Start, SMI_Free_channel): the operation depends on the channel declaration.
+ */
+class PersistentExtractor: public OperationExtractor
+{
+public:
+    OperationMetadata GetOperationMetadata(clang::CallExpr* callExpr) override;
+    std::string RenameCall(const std::string& callName, const OperationMetadata& metadata) override;
+    std::string CreateDeclaration(const std::string& callName, const OperationMetadata& metadata) override;
+    std::vector<std::string> GetFunctionNames() override;
+};
@@ -3,7 +3,7 @@
 
 using namespace clang;
 
-static OperationMetadata extractPop(CallExpr* channelDecl)
+OperationMetadata extractPop(CallExpr* channelDecl)
 {
     return OperationMetadata("pop",
                              extractIntArg(channelDecl, 3),
@@ -18,11 +18,13 @@ OperationMetadata PopExtractor::GetOperationMetadata(CallExpr* callExpr)
 }
 std::string PopExtractor::CreateDeclaration(const std::string& callName, const OperationMetadata& metadata)
 {
-    return "void " + this->RenameCall(callName, metadata) + "(SMI_Channel* chan, void* data);";
+    // the non-blocking version returns whether a data element has been received
+    std::string returnType = callName == "SMI_Pop_nb" ? "int " : "void ";
+    return returnType + this->RenameCall(callName, metadata) + "(SMI_Channel* chan, void* data);";
 }
 std::vector<std::string> PopExtractor::GetFunctionNames()
 {
-    return {"SMI_Pop"};
+    return {"SMI_Pop", "SMI_Pop_vec", "SMI_Pop_nb"};
 }
 
 OperationMetadata PopChannelExtractor::GetOperationMetadata(CallExpr* callExpr)
@@ -37,3 +39,8 @@ std::string PopChannelExtractor::GetChannelFunctionName()
 {
     return "SMI_Open_receive_channel";
 }
+
+std::string PersistentPopChannelExtractor::GetChannelFunctionName()
+{
+    return "SMI_Open_persistent_receive_channel";
+}
@@ -2,6 +2,8 @@
 
 #include "ops.h"
 
+OperationMetadata extractPop(clang::CallExpr* channelDecl);
+
 class PopExtractor: public OperationExtractor
 {
 public:
@@ -17,3 +19,9 @@ public:
     std::string CreateDeclaration(const std::string& callName, const OperationMetadata& metadata) override;
     std::string GetChannelFunctionName() override;
 };
+
+class PersistentPopChannelExtractor: public PopChannelExtractor
+{
+public:
+    std::string GetChannelFunctionName() override;
+};
@@ -3,7 +3,7 @@
 
 using namespace clang;
 
-static OperationMetadata extractPush(CallExpr* channelDecl)
+OperationMetadata extractPush(CallExpr* channelDecl)
 {
     return OperationMetadata("push",
                              extractIntArg(channelDecl, 3),
@@ -24,11 +24,13 @@ std::string PushExtractor::CreateDeclaration(const std::string& callName, const
         args += ", int immediate";
     }
 
-    return "void " + this->RenameCall(callName, metadata) + args + ");";
+    // the non-blocking version returns whether the data element has been pushed
+    std::string returnType = callName == "SMI_Push_nb" ? "int " : "void ";
+    return returnType + this->RenameCall(callName, metadata) + args + ");";
 }
 std::vector<std::string> PushExtractor::GetFunctionNames()
 {
-    return {"SMI_Push"};
+    return {"SMI_Push", "SMI_Push_vec", "SMI_Push_nb"};
 }
 
 OperationMetadata PushChannelExtractor::GetOperationMetadata(CallExpr* callExpr)
@@ -43,3 +45,8 @@ std::string PushChannelExtractor::GetChannelFunctionName()
 {
     return "SMI_Open_send_channel";
 }
+
+std::string PersistentPushChannelExtractor::GetChannelFunctionName()
+{
+    return "SMI_Open_persistent_send_channel";
+}
@@ -2,6 +2,8 @@
 
 #include "ops.h"
 
+OperationMetadata extractPush(clang::CallExpr* channelDecl);
+
 class PushExtractor: public OperationExtractor
 {
 public:
@@ -17,3 +19,9 @@ public:
     std::string CreateDeclaration(const std::string& callName, const OperationMetadata& metadata) override;
     std::string GetChannelFunctionName() override;
 };
+
+class PersistentPushChannelExtractor: public PushChannelExtractor
+{
+public:
+    std::string GetChannelFunctionName() override;
+};
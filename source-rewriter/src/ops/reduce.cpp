@@ -3,19 +3,6 @@
 
 using namespace clang;
 
-static std::string formatReduceOp(int op)
-{
-    switch (op)
-    {
-        case 0: return "add";
-        case 1: return "max";
-        case 2: return "min";
-    }
-
-    assert(false);
-    return "";
-}
-
 static OperationMetadata extractReduce(CallExpr* channelDecl)
 {
     return OperationMetadata("reduce",
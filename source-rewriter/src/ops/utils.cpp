@@ -62,6 +62,19 @@ std::string formatDataType(DataType dataType)
     return "";
 }
 
+std::string formatReduceOp(int op)
+{
+    switch (op)
+    {
+        case 0: return "add";
+        case 1: return "max";
+        case 2: return "min";
+    }
+
+    assert(false);
+    return "";
+}
+
 std::string renamePortDataType(const std::string& callName, const OperationMetadata& metadata)
 {
     auto call = callName + "_" + std::to_string(metadata.port);
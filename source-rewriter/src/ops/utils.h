@@ -21,6 +21,7 @@ private:
 };
 
 std::string formatDataType(DataType dataType);
+std::string formatReduceOp(int op);
 
 std::string renamePortDataType(const std::string& callName, const OperationMetadata& metadata);
 
@@ -8,6 +8,10 @@
 #include "ops/scatter.h"
 #include "ops/gather.h"
 #include "ops/reduce.h"
+#include "ops/allreduce.h"
+#include "ops/allgather.h"
+#include "ops/alltoall.h"
+#include "ops/persistent.h"
 
 #include <iostream>
 
@@ -36,14 +40,23 @@ public:
         this->extractors.push_back(std::make_unique<PushChannelExtractor>());
         this->extractors.push_back(std::make_unique<PopExtractor>());
         this->extractors.push_back(std::make_unique<PopChannelExtractor>());
+        this->extractors.push_back(std::make_unique<PersistentPushChannelExtractor>());
+        this->extractors.push_back(std::make_unique<PersistentPopChannelExtractor>());
+        this->extractors.push_back(std::make_unique<PersistentExtractor>());
         this->extractors.push_back(std::make_unique<BroadcastExtractor>());
         this->extractors.push_back(std::make_unique<BroadcastChannelExtractor>());
         this->extractors.push_back(std::make_unique<ReduceExtractor>());
         this->extractors.push_back(std::make_unique<ReduceChannelExtractor>());
+        this->extractors.push_back(std::make_unique<AllreduceExtractor>());
+        this->extractors.push_back(std::make_unique<AllreduceChannelExtractor>());
         this->extractors.push_back(std::make_unique<GatherExtractor>());
         this->extractors.push_back(std::make_unique<GatherChannelExtractor>());
         this->extractors.push_back(std::make_unique<ScatterExtractor>());
         this->extractors.push_back(std::make_unique<ScatterChannelExtractor>());
+        this->extractors.push_back(std::make_unique<AllgatherExtractor>());
+        this->extractors.push_back(std::make_unique<AllgatherChannelExtractor>());
+        this->extractors.push_back(std::make_unique<AlltoallExtractor>());
+        this->extractors.push_back(std::make_unique<AlltoallChannelExtractor>());
 
         for (auto& extractor: this->extractors)
         {
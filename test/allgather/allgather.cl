@@ -0,0 +1,65 @@
+/*
+    Allgather test: each rank sends its contribution (sequence of numbers) for the allgather.
+    All the ranks check the correctness of the result
+*/
+
+#include <smi.h>
+
+__kernel void test_char(const int N, __global char *mem, SMI_Comm comm)
+{
+    SMI_AllgatherChannel  __attribute__((register)) chan= SMI_Open_allgather_channel(N,N*SMI_Comm_size(comm), SMI_CHAR,0,comm);
+    int my_rank=SMI_Comm_rank(comm);
+    int num_ranks=SMI_Comm_size(comm);
+    char to_send=my_rank;    //starting point
+    char exp=0;
+    char check=1;
+    int rcv=0;
+    for(int i=0;i<N*num_ranks;i++)
+    {
+        char to_rcv;
+        SMI_Allgather(&chan,&to_send, &to_rcv);
+        check&=(to_rcv==exp);
+        rcv++;
+        if(rcv==N){
+            rcv=0;
+            exp++;
+        }
+    }
+    *mem=check;
+}
+
+__kernel void test_int(const int N, __global char *mem, SMI_Comm comm)
+{
+    SMI_AllgatherChannel  __attribute__((register)) chan= SMI_Open_allgather_channel(N,N*SMI_Comm_size(comm), SMI_INT,1,comm);
+    int my_rank=SMI_Comm_rank(comm);
+    int num_ranks=SMI_Comm_size(comm);
+    int to_send=my_rank*N;    //starting point
+    char check=1;
+    for(int i=0;i<N*num_ranks;i++)
+    {
+        int to_rcv;
+        SMI_Allgather(&chan,&to_send, &to_rcv);
+        if(i>=my_rank*N && i<(my_rank+1)*N)
+            to_send++;
+        check&=(to_rcv==i);
+    }
+    *mem=check;
+}
+
+__kernel void test_float(const int N, __global char *mem, SMI_Comm comm)
+{
+    SMI_AllgatherChannel  __attribute__((register)) chan= SMI_Open_allgather_channel(N,N*SMI_Comm_size(comm), SMI_FLOAT,2,comm);
+    int my_rank=SMI_Comm_rank(comm);
+    int num_ranks=SMI_Comm_size(comm);
+    float to_send=my_rank*N;    //starting point
+    char check=1;
+    for(int i=0;i<N*num_ranks;i++)
+    {
+        float to_rcv;
+        SMI_Allgather(&chan,&to_send, &to_rcv);
+        if(i>=my_rank*N && i<(my_rank+1)*N)
+            to_send++;
+        check&=(to_rcv==i);
+    }
+    *mem=check;
+}
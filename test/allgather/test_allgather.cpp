@@ -0,0 +1,42 @@
+/**
+    Allgather
+    Test must be executed with 8 ranks
+
+    Once built, execute it with:
+         env  CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=8 mpirun -np 8 ./test_allgather.exe "./allgather_emulator_<rank>.aocx"
+ */
+
+#define TEST_TIMEOUT 10
+
+#include "../common/all_collective_test.hpp"
+
+const std::vector<int> message_lengths={1,16,128};
+
+TEST(Allgather, MPIinit)
+{
+    ASSERT_EQ(rank_count,8);
+}
+
+TEST(Allgather, CharMessages)
+{
+    //with this test we evaluate the correcteness of char messages transmission
+    runKernel("test_char",message_lengths);
+}
+
+TEST(Allgather, IntegerMessages)
+{
+    //with this test we evaluate the correcteness of integer messages transmission
+    runKernel("test_int",message_lengths);
+}
+
+TEST(Allgather, FloatMessages)
+{
+    //with this test we evaluate the correcteness of float messages transmission
+    runKernel("test_float",message_lengths);
+}
+
+int main(int argc, char *argv[])
+{
+//        std::cerr << "Usage: [env CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=8 mpirun -np 8 " << argv[0] << " <fpga binary file>" << std::endl;
+    return runAllTests(argc, argv, "emulator_<rank>/allgather.aocx", SmiInit_allgather);
+}
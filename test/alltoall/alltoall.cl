@@ -0,0 +1,114 @@
+/*
+    Alltoall test: each rank sends to every rank a sequence of numbers that depends on both ranks.
+    All the ranks check the correctness of the result
+*/
+
+#include <smi.h>
+
+// receive buffer: the test runs on 8 ranks with messages of at most 1000 elements
+#define MAX_ELEMENTS 8000
+
+__kernel void test_char(const int N, __global char *mem, SMI_Comm comm)
+{
+    SMI_AlltoallChannel  __attribute__((register)) chan= SMI_Open_alltoall_channel(N, SMI_CHAR,0,comm);
+    int my_rank=SMI_Comm_rank(comm);
+    int num_ranks=SMI_Comm_size(comm);
+    char check=1;
+    char to_rcv[MAX_ELEMENTS];
+    for(int step=0;step<num_ranks;step++)
+    {
+        //in every step we send to my_rank+step and receive from my_rank-step, stored at step*N
+        const int dst=(my_rank+step)%num_ranks;
+        for(int i=0;i<N;i++)
+        {
+            char to_send=my_rank*num_ranks+dst+i;
+            SMI_Alltoall(&chan,&to_send, to_rcv);
+        }
+    }
+    for(int step=0;step<num_ranks;step++)
+    {
+        const int src=(my_rank-step+num_ranks)%num_ranks;
+        for(int i=0;i<N;i++)
+            check&=(to_rcv[step*N+i]==(char)(src*num_ranks+my_rank+i));
+    }
+    *mem=check;
+}
+
+__kernel void test_int(const int N, __global char *mem, SMI_Comm comm)
+{
+    SMI_AlltoallChannel  __attribute__((register)) chan= SMI_Open_alltoall_channel(N, SMI_INT,1,comm);
+    int my_rank=SMI_Comm_rank(comm);
+    int num_ranks=SMI_Comm_size(comm);
+    char check=1;
+    int to_rcv[MAX_ELEMENTS];
+    for(int step=0;step<num_ranks;step++)
+    {
+        const int dst=(my_rank+step)%num_ranks;
+        for(int i=0;i<N;i++)
+        {
+            int to_send=(my_rank*num_ranks+dst)*N+i;
+            SMI_Alltoall(&chan,&to_send, to_rcv);
+        }
+    }
+    for(int step=0;step<num_ranks;step++)
+    {
+        const int src=(my_rank-step+num_ranks)%num_ranks;
+        for(int i=0;i<N;i++)
+            check&=(to_rcv[step*N+i]==(src*num_ranks+my_rank)*N+i);
+    }
+    *mem=check;
+}
+
+__kernel void test_double(const int N, __global char *mem, SMI_Comm comm)
+{
+    SMI_AlltoallChannel  __attribute__((register)) chan= SMI_Open_alltoall_channel(N, SMI_DOUBLE,2,comm);
+    int my_rank=SMI_Comm_rank(comm);
+    int num_ranks=SMI_Comm_size(comm);
+    char check=1;
+    double to_rcv[MAX_ELEMENTS];
+    for(int step=0;step<num_ranks;step++)
+    {
+        const int dst=(my_rank+step)%num_ranks;
+        for(int i=0;i<N;i++)
+        {
+            double to_send=(my_rank*num_ranks+dst)*N+i+0.5;
+            SMI_Alltoall(&chan,&to_send, to_rcv);
+        }
+    }
+    for(int step=0;step<num_ranks;step++)
+    {
+        const int src=(my_rank-step+num_ranks)%num_ranks;
+        for(int i=0;i<N;i++)
+            check&=(to_rcv[step*N+i]==(src*num_ranks+my_rank)*N+i+0.5);
+    }
+    *mem=check;
+}
+
+__kernel void test_int_repeated(const int N, __global char *mem, SMI_Comm comm)
+{
+    //consecutive alltoalls on the same port: the requests of the next one can arrive before the current one completes
+    int my_rank=SMI_Comm_rank(comm);
+    int num_ranks=SMI_Comm_size(comm);
+    char check=1;
+    int to_rcv[MAX_ELEMENTS];
+    for(int r=0;r<3;r++)
+    {
+        SMI_AlltoallChannel  __attribute__((register)) chan= SMI_Open_alltoall_channel(N, SMI_INT,3,comm);
+        for(int step=0;step<num_ranks;step++)
+        {
+            const int dst=(my_rank+step)%num_ranks;
+            for(int i=0;i<N;i++)
+            {
+                int to_send=(my_rank*num_ranks+dst)*N+i+r;
+                SMI_Alltoall(&chan,&to_send, to_rcv);
+            }
+        }
+        for(int step=0;step<num_ranks;step++)
+        {
+            const int src=(my_rank-step+num_ranks)%num_ranks;
+            for(int i=0;i<N;i++)
+                check&=(to_rcv[step*N+i]==(src*num_ranks+my_rank)*N+i+r);
+        }
+    }
+    *mem=check;
+}
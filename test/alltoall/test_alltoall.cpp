@@ -0,0 +1,50 @@
+/**
+    Alltoall
+    Test must be executed with 8 ranks
+
+    Once built, execute it with:
+         env  CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=8 mpirun -np 8 ./test_alltoall.exe "./alltoall_emulator_<rank>.aocx"
+ */
+
+#define TEST_TIMEOUT 10
+
+#include "../common/all_collective_test.hpp"
+
+//the lengths not multiple of the elements per packet end with partial packets, the longest ones exceed the credits
+//window of the destinations
+const std::vector<int> message_lengths={1,3,16,128,1000};
+
+TEST(Alltoall, MPIinit)
+{
+    ASSERT_EQ(rank_count,8);
+}
+
+TEST(Alltoall, CharMessages)
+{
+    //with this test we evaluate the correcteness of char messages transmission
+    runKernel("test_char",message_lengths);
+}
+
+TEST(Alltoall, IntegerMessages)
+{
+    //with this test we evaluate the correcteness of integer messages transmission
+    runKernel("test_int",message_lengths);
+}
+
+TEST(Alltoall, DoubleMessages)
+{
+    //with this test we evaluate the correcteness of double messages transmission
+    runKernel("test_double",message_lengths);
+}
+
+TEST(Alltoall, RepeatedMessages)
+{
+    //with this test we evaluate consecutive alltoalls on the same port
+    runKernel("test_int_repeated",message_lengths);
+}
+
+int main(int argc, char *argv[])
+{
+//        std::cerr << "Usage: [env CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=8 mpirun -np 8 " << argv[0] << " <fpga binary file>" << std::endl;
+    return runAllTests(argc, argv, "emulator_<rank>/alltoall.aocx", SmiInit_alltoall);
+}
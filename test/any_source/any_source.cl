@@ -0,0 +1,113 @@
+/*
+    Any-source test: all the ranks but the root send a sequence of numbers to the root, that receives them
+    on a single channel opened with SMI_ANY_SOURCE and checks the data of every sender (identified by the
+    sender_rank of the channel) against its own sequence.
+    The test must be executed with (at most) 8 ranks
+*/
+
+#include <smi.h>
+
+#define MAX_RANKS 8
+
+__kernel void test_int(const int N, char root, __global char *mem, SMI_Comm comm)
+{
+    int my_rank=SMI_Comm_rank(comm);
+    int num_ranks=SMI_Comm_size(comm);
+    char check=1;
+    if(my_rank==root)
+    {
+        SMI_Channel chan=SMI_Open_receive_channel(N*(num_ranks-1),SMI_INT,SMI_ANY_SOURCE,0,comm);
+        int rcv[MAX_RANKS]={0,0,0,0,0,0,0,0};
+        for(int i=0;i<N*(num_ranks-1);i++)
+        {
+            int to_rcv;
+            SMI_Pop(&chan,&to_rcv);
+            int src=chan.sender_rank;
+            check&=(src!=root && to_rcv==src*1000000+rcv[src]);
+            rcv[src]++;
+        }
+        for(int r=0;r<num_ranks;r++)
+            check&=(rcv[r]==((r==root)?0:N));
+    }
+    else
+    {
+        SMI_Channel chan=SMI_Open_send_channel(N,SMI_INT,root,0,comm);
+        for(int i=0;i<N;i++)
+        {
+            int to_send=my_rank*1000000+i;
+            SMI_Push(&chan,&to_send);
+        }
+    }
+    *mem=check;
+}
+
+// the root receives whole packets: every packet comes from a single sender
+__kernel void test_float_vec(const int N, char root, __global char *mem, SMI_Comm comm)
+{
+    int my_rank=SMI_Comm_rank(comm);
+    int num_ranks=SMI_Comm_size(comm);
+    char check=1;
+    if(my_rank==root)
+    {
+        SMI_Channel chan=SMI_Open_receive_channel(N*(num_ranks-1),SMI_FLOAT,SMI_ANY_SOURCE,1,comm);
+        int rcv[MAX_RANKS]={0,0,0,0,0,0,0,0};
+        for(int i=0;i<N*(num_ranks-1);)
+        {
+            float to_rcv[SMI_FLOAT_ELEM_PER_PCKT];
+            SMI_Pop_vec(&chan,to_rcv);
+            int src=chan.sender_rank;
+            check&=(src!=root);
+            for(int j=0;j<SMI_FLOAT_ELEM_PER_PCKT && rcv[src]<N;j++)
+            {
+                check&=(to_rcv[j]==(float)(src*1000+rcv[src]));
+                rcv[src]++;
+                i++;
+            }
+        }
+        for(int r=0;r<num_ranks;r++)
+            check&=(rcv[r]==((r==root)?0:N));
+    }
+    else
+    {
+        SMI_Channel chan=SMI_Open_send_channel(N,SMI_FLOAT,root,1,comm);
+        for(int i=0;i<N;i++)
+        {
+            float to_send=my_rank*1000+i;
+            SMI_Push(&chan,&to_send);
+        }
+    }
+    *mem=check;
+}
+
+// same as test_int, on an eager port
+__kernel void test_int_eager(const int N, char root, __global char *mem, SMI_Comm comm)
+{
+    int my_rank=SMI_Comm_rank(comm);
+    int num_ranks=SMI_Comm_size(comm);
+    char check=1;
+    if(my_rank==root)
+    {
+        SMI_Channel chan=SMI_Open_receive_channel(N*(num_ranks-1),SMI_INT,SMI_ANY_SOURCE,2,comm);
+        int rcv[MAX_RANKS]={0,0,0,0,0,0,0,0};
+        for(int i=0;i<N*(num_ranks-1);i++)
+        {
+            int to_rcv;
+            SMI_Pop(&chan,&to_rcv);
+            int src=chan.sender_rank;
+            check&=(src!=root && to_rcv==src*1000000+rcv[src]);
+            rcv[src]++;
+        }
+        for(int r=0;r<num_ranks;r++)
+            check&=(rcv[r]==((r==root)?0:N));
+    }
+    else
+    {
+        SMI_Channel chan=SMI_Open_send_channel(N,SMI_INT,root,2,comm);
+        for(int i=0;i<N;i++)
+        {
+            int to_send=my_rank*1000000+i;
+            SMI_Push(&chan,&to_send);
+        }
+    }
+    *mem=check;
+}
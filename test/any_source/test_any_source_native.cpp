@@ -0,0 +1,94 @@
+/**
+    Any-source Test, native backend.
+    All the 8 ranks are executed as threads of this process: all of them but the root send to the root,
+    that receives on a single channel opened with SMI_ANY_SOURCE
+ */
+
+#define TEST_TIMEOUT 60   // all the ranks share the cores of a single node
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <future>
+#include <vector>
+#include "smi_generated_native.cpp"
+#define ROUTING_DIR "smi-routes/"
+#define RANK_COUNT 8
+
+using namespace std;
+smi_native::Runtime runtime;
+std::vector<SMI_Comm> comms(RANK_COUNT);
+
+//https://github.com/google/googletest/issues/348#issuecomment-492785854
+#define ASSERT_DURATION_LE(secs, stmt) { \
+  std::promise<bool> completed; \
+  auto stmt_future = completed.get_future(); \
+  std::thread([&](std::promise<bool>& completed) { \
+    stmt; \
+    completed.set_value(true); \
+  }, std::ref(completed)).detach(); \
+  if(stmt_future.wait_for(std::chrono::seconds(secs)) == std::future_status::timeout){ \
+    GTEST_FATAL_FAILURE_("       timed out (> " #secs \
+    " seconds). Check code for infinite loops"); \
+    } \
+}
+
+// kernel returns the kernel to run on the given rank
+template <typename F>
+bool runAndReturn(F kernel, int root, int ml)
+{
+    char check[RANK_COUNT];
+    std::vector<std::thread> threads;
+    for(int rank=0;rank<RANK_COUNT;rank++)
+        threads.emplace_back(kernel(rank), ml, (char)root, &check[rank], comms[rank]);
+    for(auto &thread: threads)
+        thread.join();
+    //the root checks the result
+    return check[root]==1;
+}
+
+// runs the kernel NAME with all the message lengths and roots: the lengths are not multiple of the elements
+// per packet and the longest ones exceed the share of the buffer of the root of a sender
+#define TEST_KERNEL(NAME) { \
+    std::vector<int> message_lengths={1,5,113,1000}; \
+    std::vector<int> roots={0,3,7}; \
+    int runs=2; \
+    for(int root:roots) \
+    { \
+        for(int ml:message_lengths) \
+        { \
+            for(int i=0;i<runs;i++) \
+            { \
+                ASSERT_DURATION_LE(TEST_TIMEOUT, { \
+                  ASSERT_TRUE(runAndReturn([](int rank) { return SmiKernel_any_source(rank, NAME); }, root, ml)); \
+                }); \
+            } \
+        } \
+    } \
+}
+
+TEST(AnySource, IntegerMessages)
+{
+    TEST_KERNEL(test_int);
+}
+
+TEST(AnySource, VectorMessages)
+{
+    TEST_KERNEL(test_float_vec);
+}
+
+TEST(AnySource, EagerMessages)
+{
+    TEST_KERNEL(test_int_eager);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    for(int i=0;i<RANK_COUNT;i++)
+        comms[i]=SmiInit_any_source(i, RANK_COUNT, ROUTING_DIR, runtime);
+
+    int result = RUN_ALL_TESTS();
+    runtime.stop();
+    return result;
+}
@@ -109,3 +109,18 @@ __kernel void test_float_ad(__global char* mem, const int N, char root,SMI_Comm
     }
     *mem=check;
 }
+
+__kernel void test_int_from_root(__global char* mem, const int N, char root,SMI_Comm comm)
+{
+    //only the root knows the data: the other ranks pass a different value, which must be overwritten
+    char check=1;
+    int my_rank=SMI_Comm_rank(comm);
+    SMI_BChannel  __attribute__((register)) chan= SMI_Open_bcast_channel(N, SMI_INT,7, root,comm);
+    for(int i=0;i<N;i++)
+    {
+        int to_comm=(my_rank==root)?i*root+1:-1;
+        SMI_Bcast(&chan,&to_comm);
+        check &= (to_comm==i*root+1);
+    }
+    *mem=check;
+}
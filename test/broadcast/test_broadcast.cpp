@@ -347,6 +347,46 @@ TEST(Broadcast, FloatMessagesAD)
     }
 }
 
+TEST(Broadcast, IntegerMessagesFromRoot)
+{
+    //with this test we evaluate that the non-root ranks receive the data of the root
+  
+    cl::Kernel kernel;
+    cl::CommandQueue queue;
+    IntelFPGAOCLUtils::createCommandQueue(context,device,queue);
+    IntelFPGAOCLUtils::createKernel(program,"test_int_from_root",kernel);
+
+    cl::Buffer check(context,CL_MEM_WRITE_ONLY,1);
+    std::vector<int> message_lengths={1,128,1024};
+    std::vector<int> roots={0,3,7};
+    int runs=2;
+    for(int root:roots)    //consider different roots
+    {
+
+        for(int ml:message_lengths)     //consider different message lengths
+        {
+            kernel.setArg(0,sizeof(cl_mem),&check);
+            kernel.setArg(1,sizeof(int),&ml);
+            kernel.setArg(2,sizeof(char),&root);
+            kernel.setArg(3,sizeof(SMI_Comm),&comm);
+
+            for(int i=0;i<runs;i++)
+            {
+                if(my_rank==0)  //remove emulated channels
+                    system("rm emulated_chan* 2> /dev/null;");
+
+
+                // run some_function() and compared with some_value
+                // but end the function if it exceeds 3 seconds
+                //source https://github.com/google/googletest/issues/348#issuecomment-492785854
+                ASSERT_DURATION_LE(TEST_TIMEOUT, {
+                  ASSERT_TRUE(runAndReturn(queue,kernel,check));
+                });
+            }
+        }
+    }
+}
+
 int main(int argc, char *argv[])
 {
 
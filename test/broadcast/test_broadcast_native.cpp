@@ -0,0 +1,119 @@
+/**
+    Broadcast Test, native backend.
+    All the 8 ranks are executed as threads of this process. The test is built with different values of
+    SMI_BCAST_FANOUT (1: chain, 2 and 7: the root sends to all the other ranks)
+ */
+
+#define TEST_TIMEOUT 60   // all the ranks share the cores of a single node
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <future>
+#include <vector>
+#include "smi_generated_native.cpp"
+#define ROUTING_DIR "smi-routes/"
+#define RANK_COUNT 8
+
+using namespace std;
+smi_native::Runtime runtime;
+std::vector<SMI_Comm> comms(RANK_COUNT);
+
+//https://github.com/google/googletest/issues/348#issuecomment-492785854
+#define ASSERT_DURATION_LE(secs, stmt) { \
+  std::promise<bool> completed; \
+  auto stmt_future = completed.get_future(); \
+  std::thread([&](std::promise<bool>& completed) { \
+    stmt; \
+    completed.set_value(true); \
+  }, std::ref(completed)).detach(); \
+  if(stmt_future.wait_for(std::chrono::seconds(secs)) == std::future_status::timeout){ \
+    GTEST_FATAL_FAILURE_("       timed out (> " #secs \
+    " seconds). Check code for infinite loops"); \
+    } \
+}
+
+// kernel returns the kernel to run on the given rank, late_rank (if any) is started after the others
+template <typename F>
+bool runAndReturn(F kernel, int root, int ml, int late_rank = -1)
+{
+    char check[RANK_COUNT];
+    std::vector<std::thread> threads;
+    for(int rank=0;rank<RANK_COUNT;rank++)
+        if(rank!=late_rank)
+            threads.emplace_back(kernel(rank), &check[rank], ml, (char)root, comms[rank]);
+    if(late_rank>=0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        threads.emplace_back(kernel(late_rank), &check[late_rank], ml, (char)root, comms[late_rank]);
+    }
+    for(auto &thread: threads)
+        thread.join();
+    //all the ranks check the result
+    bool result=true;
+    for(int rank=0;rank<RANK_COUNT;rank++)
+        result&=check[rank]==1;
+    return result;
+}
+
+// runs the kernel NAME with all the message lengths and roots
+#define TEST_KERNEL(NAME) { \
+    std::vector<int> message_lengths={1,9,300}; \
+    std::vector<int> roots={0,3,7}; \
+    int runs=2; \
+    for(int root:roots) \
+    { \
+        for(int ml:message_lengths) \
+        { \
+            for(int i=0;i<runs;i++) \
+            { \
+                ASSERT_DURATION_LE(TEST_TIMEOUT, { \
+                  ASSERT_TRUE(runAndReturn([](int rank) { return SmiKernel_broadcast(rank, NAME); }, root, ml)); \
+                }); \
+            } \
+        } \
+    } \
+}
+
+TEST(Broadcast, IntegerMessages)
+{
+    TEST_KERNEL(test_int_from_root);
+}
+
+TEST(Broadcast, CharMessages)
+{
+    TEST_KERNEL(test_char);
+}
+
+TEST(Broadcast, DoubleMessages)
+{
+    TEST_KERNEL(test_double);
+}
+
+TEST(Broadcast, LateLeaf)
+{
+    // the last rank of the tree is a leaf: its ancestors must not receive the data before it is ready,
+    // since the message does not fit in their buffers
+    std::vector<int> roots={0,3,7};
+    const int ml=300;
+    for(int root:roots)
+    {
+        ASSERT_DURATION_LE(TEST_TIMEOUT, {
+          ASSERT_TRUE(runAndReturn([](int rank) { return SmiKernel_broadcast(rank, test_int); }, root, ml,
+                                   (root+RANK_COUNT-1)%RANK_COUNT));
+        });
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    std::cout << "SMI_BCAST_FANOUT: " << SMI_BCAST_FANOUT << std::endl;
+
+    for(int i=0;i<RANK_COUNT;i++)
+        comms[i]=SmiInit_broadcast(i, RANK_COUNT, ROUTING_DIR, runtime);
+
+    int result = RUN_ALL_TESTS();
+    runtime.stop();
+    return result;
+}
@@ -0,0 +1,136 @@
+/**
+    Common setup of the tests of the collectives in which all the ranks send and receive (allgather, alltoall).
+    The test kernels take the message length, the check buffer and the communicator: every rank writes 1 in its
+    check buffer if it received the expected data.
+    Tests must be executed with 8 ranks
+ */
+
+#ifndef ALL_COLLECTIVE_TEST_HPP
+#define ALL_COLLECTIVE_TEST_HPP
+
+#ifndef TEST_TIMEOUT
+#define TEST_TIMEOUT 10
+#endif
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <unistd.h>
+#include <utils/ocl_utils.hpp>
+#include <utils/utils.hpp>
+#include <limits.h>
+#include <cmath>
+#include <thread>
+#include <future>
+#include "smi_generated_host.c"
+#define ROUTING_DIR "smi-routes/"
+using namespace std;
+std::string program_path;
+int rank_count, my_rank;
+
+cl::Platform  platform;
+cl::Device device;
+cl::Context context;
+cl::Program program;
+std::vector<cl::Buffer> buffers;
+SMI_Comm comm;
+//https://github.com/google/googletest/issues/348#issuecomment-492785854
+#define ASSERT_DURATION_LE(secs, stmt) { \
+  std::promise<bool> completed; \
+  auto stmt_future = completed.get_future(); \
+  std::thread([&](std::promise<bool>& completed) { \
+    stmt; \
+    completed.set_value(true); \
+  }, std::ref(completed)).detach(); \
+  if(stmt_future.wait_for(std::chrono::seconds(secs)) == std::future_status::timeout){ \
+    GTEST_FATAL_FAILURE_("       timed out (> " #secs \
+    " seconds). Check code for infinite loops"); \
+    MPI_Finalize();\
+    } \
+}
+
+
+bool runAndReturn(cl::CommandQueue &queue, cl::Kernel &kernel, cl::Buffer &check)
+{
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    queue.enqueueTask(kernel);
+
+    queue.finish();
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    //check: all the ranks receive the data
+    char res;
+    queue.enqueueReadBuffer(check,CL_TRUE,0,1,&res);
+    return res==1;
+}
+
+/**
+ * @brief runKernel executes the given test kernel on all the ranks, twice for every message length
+ */
+void runKernel(const char *kernel_name, const std::vector<int> &message_lengths)
+{
+    cl::Kernel kernel;
+    cl::CommandQueue queue;
+    IntelFPGAOCLUtils::createCommandQueue(context,device,queue);
+    IntelFPGAOCLUtils::createKernel(program,kernel_name,kernel);
+
+    cl::Buffer check(context,CL_MEM_WRITE_ONLY,1);
+    int runs=2;
+    for(int ml:message_lengths)     //consider different message lengths
+    {
+        kernel.setArg(0,sizeof(int),&ml);
+        kernel.setArg(1,sizeof(cl_mem),&check);
+        kernel.setArg(2,sizeof(SMI_Comm),&comm);
+
+        for(int i=0;i<runs;i++)
+        {
+            if(my_rank==0)  //remove emulated channels
+                system("rm emulated_chan* 2> /dev/null;");
+
+            ASSERT_DURATION_LE(TEST_TIMEOUT, {
+              ASSERT_TRUE(runAndReturn(queue,kernel,check));
+            });
+        }
+    }
+}
+
+/**
+ * @brief runAllTests initializes MPI and SMI (with the SmiInit function of the program) and runs the tests
+ * @param default_program_path path of the bitstream, if not given on the command line (<rank> is replaced by the rank)
+ */
+template <typename SmiInit>
+int runAllTests(int argc, char *argv[], const char *default_program_path, SmiInit smi_init)
+{
+    int result = 0;
+
+    ::testing::InitGoogleTest(&argc, argv);
+    //delete listeners for all the rank except 0
+    if(argc==2)
+        program_path =argv[1];
+    else
+        program_path = default_program_path;
+    ::testing::TestEventListeners& listeners =
+            ::testing::UnitTest::GetInstance()->listeners();
+    CHECK_MPI(MPI_Init(&argc, &argv));
+
+    CHECK_MPI(MPI_Comm_size(MPI_COMM_WORLD, &rank_count));
+    CHECK_MPI(MPI_Comm_rank(MPI_COMM_WORLD, &my_rank));
+    if (my_rank!= 0) {
+        delete listeners.Release(listeners.default_result_printer());
+    }
+
+    //create environemnt
+    int fpga=my_rank%2;
+    program_path = replace(program_path, "<rank>", std::to_string(my_rank));
+    comm=smi_init(my_rank, rank_count, program_path.c_str(), ROUTING_DIR, platform, device, context, program, fpga,buffers);
+
+    result = RUN_ALL_TESTS();
+    MPI_Finalize();
+
+    return result;
+}
+
+#endif // ALL_COLLECTIVE_TEST_HPP
@@ -168,7 +168,7 @@ TEST(Gather, IntegerMessages)
     IntelFPGAOCLUtils::createKernel(program,"test_int",kernel);
 
     cl::Buffer check(context,CL_MEM_WRITE_ONLY,1);
-    std::vector<int> message_lengths={1,16,128};
+    std::vector<int> message_lengths={1,5,16,113,128};    //also lengths that are not multiple of the elements per packet
     std::vector<int> roots={0,1,3};
     int runs=2;
     for(int root:roots)    //consider different roots
@@ -122,3 +122,73 @@ __kernel void test_double_ad_1(const int N, const char dest_rank, const SMI_Comm
        SMI_Push(&chan,&send);
     }
 }
+
+__kernel void test_int_persistent(const int N, const char dest_rank, const SMI_Comm comm)
+{
+    //a few messages on the same persistent channel
+    SMI_Channel chan=SMI_Open_persistent_send_channel(N,SMI_INT,dest_rank,11,comm);
+    for(int m=0;m<4;m++)
+    {
+        SMI_Start(&chan);
+        for(int i=0;i<N;i++)
+        {
+           int send=i+m;
+           SMI_Push(&chan,&send);
+        }
+    }
+    SMI_Free_channel(&chan);
+}
+
+__kernel void test_float_vec(const int N, const char dest_rank, const SMI_Comm comm)
+{
+    //a whole packet per call, received the same way
+    SMI_Channel chan=SMI_Open_send_channel(N,SMI_FLOAT,dest_rank,12,comm);
+    for(int i=0;i<N;i+=SMI_FLOAT_ELEM_PER_PCKT)
+    {
+       float send[SMI_FLOAT_ELEM_PER_PCKT];
+       for(int j=0;j<SMI_FLOAT_ELEM_PER_PCKT;j++)
+           send[j]=i+j;
+       SMI_Push_vec(&chan,send);
+    }
+}
+
+__kernel void test_double_vec_push(const int N, const char dest_rank, const SMI_Comm comm)
+{
+    //a whole packet per call, received one element at a time
+    SMI_Channel chan=SMI_Open_send_channel(N,SMI_DOUBLE,dest_rank,13,comm);
+    for(int i=0;i<N;i+=SMI_DOUBLE_ELEM_PER_PCKT)
+    {
+       double send[SMI_DOUBLE_ELEM_PER_PCKT];
+       for(int j=0;j<SMI_DOUBLE_ELEM_PER_PCKT;j++)
+           send[j]=i+j;
+       SMI_Push_vec(&chan,send);
+    }
+}
+
+__kernel void test_char_vec_pop(const int N, const char dest_rank, const SMI_Comm comm)
+{
+    //one element at a time, received a whole packet per call
+    SMI_Channel chan=SMI_Open_send_channel(N,SMI_CHAR,dest_rank,14,comm);
+    for(int i=0;i<N;i++)
+    {
+       char send=i;
+       SMI_Push(&chan,&send);
+    }
+}
+
+__kernel void test_nb(const int N, const char dest_rank, const SMI_Comm comm)
+{
+    //two messages pushed by a single kernel: an element is pushed only if it can be sent
+    SMI_Channel chan_int=SMI_Open_send_channel(N,SMI_INT,dest_rank,15,comm);
+    SMI_Channel chan_float=SMI_Open_send_channel(N,SMI_FLOAT,dest_rank,16,comm);
+    int sent_int=0, sent_float=0;
+    while(sent_int<N || sent_float<N)
+    {
+        int send_int=sent_int;
+        float send_float=sent_float+0.5f;
+        if(sent_int<N && SMI_Push_nb(&chan_int,&send_int))
+            sent_int++;
+        if(sent_float<N && SMI_Push_nb(&chan_float,&send_float))
+            sent_float++;
+    }
+}
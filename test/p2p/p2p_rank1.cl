@@ -173,3 +173,89 @@ __kernel void test_double_ad_1(__global char *mem, const int N, SMI_Comm comm)
     *mem=check;
 
 }
+
+__kernel void test_int_persistent(__global char *mem, const int N, SMI_Comm comm)
+{
+    SMI_Channel chan=SMI_Open_persistent_receive_channel(N,SMI_INT,0,11,comm);
+    char check=1;
+    for(int m=0;m<4;m++)
+    {
+        SMI_Start(&chan);
+        for(int i=0;i<N;i++)
+        {
+            int rcvd;
+            SMI_Pop(&chan,&rcvd);
+            check &= (rcvd==(i+m));
+        }
+    }
+    SMI_Free_channel(&chan);
+    *mem=check;
+
+}
+
+__kernel void test_float_vec(__global char *mem, const int N, SMI_Comm comm)
+{
+    SMI_Channel chan=SMI_Open_receive_channel(N,SMI_FLOAT,0,12,comm);
+    char check=1;
+    for(int i=0;i<N;i+=SMI_FLOAT_ELEM_PER_PCKT)
+    {
+        float rcvd[SMI_FLOAT_ELEM_PER_PCKT];
+        SMI_Pop_vec(&chan,rcvd);
+        //the last packet may be partial
+        for(int j=0;j<SMI_FLOAT_ELEM_PER_PCKT && i+j<N;j++)
+            check &= (rcvd[j]==(float)(i+j));
+    }
+    *mem=check;
+}
+
+__kernel void test_double_vec_push(__global char *mem, const int N, SMI_Comm comm)
+{
+    SMI_Channel chan=SMI_Open_receive_channel(N,SMI_DOUBLE,0,13,comm);
+    char check=1;
+    for(int i=0;i<N;i++)
+    {
+        double rcvd;
+        SMI_Pop(&chan,&rcvd);
+        check &= (rcvd==(double)i);
+    }
+    *mem=check;
+}
+
+__kernel void test_char_vec_pop(__global char *mem, const int N, SMI_Comm comm)
+{
+    SMI_Channel chan=SMI_Open_receive_channel(N,SMI_CHAR,0,14,comm);
+    char check=1;
+    for(int i=0;i<N;i+=SMI_CHAR_ELEM_PER_PCKT)
+    {
+        char rcvd[SMI_CHAR_ELEM_PER_PCKT];
+        SMI_Pop_vec(&chan,rcvd);
+        for(int j=0;j<SMI_CHAR_ELEM_PER_PCKT && i+j<N;j++)
+            check &= (rcvd[j]==(char)(i+j));
+    }
+    *mem=check;
+}
+
+__kernel void test_nb(__global char *mem, const int N, SMI_Comm comm)
+{
+    //two messages popped by a single kernel, in the order in which their packets arrive
+    SMI_Channel chan_int=SMI_Open_receive_channel(N,SMI_INT,0,15,comm);
+    SMI_Channel chan_float=SMI_Open_receive_channel(N,SMI_FLOAT,0,16,comm);
+    char check=1;
+    int rcvd_int=0, rcvd_float=0;
+    while(rcvd_int<N || rcvd_float<N)
+    {
+        int int_data;
+        float float_data;
+        if(rcvd_int<N && SMI_Pop_nb(&chan_int,&int_data))
+        {
+            check &= (int_data==rcvd_int);
+            rcvd_int++;
+        }
+        if(rcvd_float<N && SMI_Pop_nb(&chan_float,&float_data))
+        {
+            check &= (float_data==rcvd_float+0.5f);
+            rcvd_float++;
+        }
+    }
+    *mem=check;
+}
@@ -590,6 +590,143 @@ TEST(P2P, DoubleMessagesAD1)
         }
     }
 }
+TEST(P2P, PersistentMessages)
+{
+    //with this test we evaluate the correcteness of several messages sent on the same persistent channel
+  
+    cl::Kernel kernel;
+    cl::CommandQueue queue;
+    IntelFPGAOCLUtils::createCommandQueue(context,device,queue);
+    IntelFPGAOCLUtils::createKernel(program,"test_int_persistent",kernel);
+
+    cl::Buffer check(context,CL_MEM_WRITE_ONLY,1);
+    std::vector<int> message_lengths={1,128,1024,100000};
+    std::vector<int> receivers={1,4,7};
+    int runs=2;
+    for(int recv_rank:receivers)    //consider different receivers
+    {
+
+        for(int ml:message_lengths)     //consider different message lengths
+        {
+            if(my_rank==0)
+            {
+                char dest=(char)recv_rank;
+                kernel.setArg(0,sizeof(int),&ml);
+                kernel.setArg(1,sizeof(char),&dest);
+                kernel.setArg(2,sizeof(SMI_Comm),&comm);
+            }
+            else
+            {
+                kernel.setArg(0,sizeof(cl_mem),&check);
+                kernel.setArg(1,sizeof(int),&ml);
+                kernel.setArg(2,sizeof(SMI_Comm),&comm);
+            }
+
+            for(int i=0;i<runs;i++)
+            {
+                if(my_rank==0)  //remove emulated channels
+                    system("rm emulated_chan* 2> /dev/null;");
+
+
+                // run some_function() and compared with some_value
+                // but end the function if it exceeds 3 seconds
+                //source https://github.com/google/googletest/issues/348#issuecomment-492785854
+                ASSERT_DURATION_LE(TEST_TIMEOUT, {
+                  ASSERT_TRUE(runAndReturn(queue,kernel,check,my_rank,recv_rank));
+                });
+            }
+        }
+    }
+}
+TEST(P2P, VectorMessages)
+{
+    //with this test we evaluate whole packets pushed and/or popped per call, also mixed with single elements
+    std::vector<std::string> kernel_names={"test_float_vec","test_double_vec_push","test_char_vec_pop"};
+    for(const std::string &kernel_name:kernel_names)
+    {
+        cl::Kernel kernel;
+        cl::CommandQueue queue;
+        IntelFPGAOCLUtils::createCommandQueue(context,device,queue);
+        IntelFPGAOCLUtils::createKernel(program,kernel_name,kernel);
+
+        cl::Buffer check(context,CL_MEM_WRITE_ONLY,1);
+        std::vector<int> message_lengths={1,128,1024,100000};
+        std::vector<int> receivers={1,4,7};
+        int runs=2;
+        for(int recv_rank:receivers)    //consider different receivers
+        {
+            for(int ml:message_lengths)     //consider different message lengths
+            {
+                if(my_rank==0)
+                {
+                    char dest=(char)recv_rank;
+                    kernel.setArg(0,sizeof(int),&ml);
+                    kernel.setArg(1,sizeof(char),&dest);
+                    kernel.setArg(2,sizeof(SMI_Comm),&comm);
+                }
+                else
+                {
+                    kernel.setArg(0,sizeof(cl_mem),&check);
+                    kernel.setArg(1,sizeof(int),&ml);
+                    kernel.setArg(2,sizeof(SMI_Comm),&comm);
+                }
+
+                for(int i=0;i<runs;i++)
+                {
+                    if(my_rank==0)  //remove emulated channels
+                        system("rm emulated_chan* 2> /dev/null;");
+                    ASSERT_DURATION_LE(TEST_TIMEOUT, {
+                      ASSERT_TRUE(runAndReturn(queue,kernel,check,my_rank,recv_rank));
+                    });
+                }
+            }
+        }
+    }
+}
+
+TEST(P2P, NonBlockingMessages)
+{
+    //with this test we evaluate two messages pushed and popped with the non-blocking calls of a single kernel
+    cl::Kernel kernel;
+    cl::CommandQueue queue;
+    IntelFPGAOCLUtils::createCommandQueue(context,device,queue);
+    IntelFPGAOCLUtils::createKernel(program,"test_nb",kernel);
+
+    cl::Buffer check(context,CL_MEM_WRITE_ONLY,1);
+    std::vector<int> message_lengths={1,128,1024,100000};
+    std::vector<int> receivers={1,4,7};
+    int runs=2;
+    for(int recv_rank:receivers)    //consider different receivers
+    {
+
+        for(int ml:message_lengths)     //consider different message lengths
+        {
+            if(my_rank==0)
+            {
+                char dest=(char)recv_rank;
+                kernel.setArg(0,sizeof(int),&ml);
+                kernel.setArg(1,sizeof(char),&dest);
+                kernel.setArg(2,sizeof(SMI_Comm),&comm);
+            }
+            else
+            {
+                kernel.setArg(0,sizeof(cl_mem),&check);
+                kernel.setArg(1,sizeof(int),&ml);
+                kernel.setArg(2,sizeof(SMI_Comm),&comm);
+            }
+
+            for(int i=0;i<runs;i++)
+            {
+                if(my_rank==0)  //remove emulated channels
+                    system("rm emulated_chan* 2> /dev/null;");
+                ASSERT_DURATION_LE(TEST_TIMEOUT, {
+                  ASSERT_TRUE(runAndReturn(queue,kernel,check,my_rank,recv_rank));
+                });
+            }
+        }
+    }
+}
+
 int main(int argc, char *argv[])
 {
 
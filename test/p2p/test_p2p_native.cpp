@@ -0,0 +1,132 @@
+/**
+    P2P Test, native backend.
+    All the 8 ranks are executed as threads of this process
+ */
+
+#define TEST_TIMEOUT 60   // all the ranks share the cores of a single node
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <thread>
+#include <future>
+#include <vector>
+#include "smi_generated_native.cpp"
+#define ROUTING_DIR "smi-routes/"
+#define RANK_COUNT 8
+
+using namespace std;
+smi_native::Runtime runtime;
+std::vector<SMI_Comm> comms(RANK_COUNT);
+
+//https://github.com/google/googletest/issues/348#issuecomment-492785854
+#define ASSERT_DURATION_LE(secs, stmt) { \
+  std::promise<bool> completed; \
+  auto stmt_future = completed.get_future(); \
+  std::thread([&](std::promise<bool>& completed) { \
+    stmt; \
+    completed.set_value(true); \
+  }, std::ref(completed)).detach(); \
+  if(stmt_future.wait_for(std::chrono::seconds(secs)) == std::future_status::timeout){ \
+    GTEST_FATAL_FAILURE_("       timed out (> " #secs \
+    " seconds). Check code for infinite loops"); \
+    } \
+}
+
+template <typename S, typename R>
+bool runAndReturn(S sender, R receiver, int recv_rank, int ml)
+{
+    char check=0;
+    std::thread send_thread(sender, ml, (char)recv_rank, comms[0]);
+    std::thread recv_thread(receiver, &check, ml, comms[recv_rank]);
+    send_thread.join();
+    recv_thread.join();
+    return check==1;
+}
+
+// runs the kernel NAME with all the message lengths and receivers
+#define TEST_KERNEL(NAME) { \
+    std::vector<int> message_lengths={1,128,1024,100000}; \
+    std::vector<int> receivers={1,4,7}; \
+    int runs=2; \
+    for(int recv_rank:receivers) \
+    { \
+        for(int ml:message_lengths) \
+        { \
+            for(int i=0;i<runs;i++) \
+            { \
+                ASSERT_DURATION_LE(TEST_TIMEOUT, { \
+                  ASSERT_TRUE(runAndReturn(SmiKernel_p2p_rank0(0, NAME), SmiKernel_p2p_rank1(recv_rank, NAME), recv_rank, ml)); \
+                }); \
+            } \
+        } \
+    } \
+}
+
+TEST(P2P, CharMessages)
+{
+    TEST_KERNEL(test_char);
+}
+
+TEST(P2P, ShortMessages)
+{
+    TEST_KERNEL(test_short);
+}
+
+TEST(P2P, IntegerMessages)
+{
+    TEST_KERNEL(test_int);
+}
+
+TEST(P2P, FloatMessages)
+{
+    TEST_KERNEL(test_float);
+}
+
+TEST(P2P, DoubleMessages)
+{
+    TEST_KERNEL(test_double);
+}
+
+TEST(P2P, IntegerMessagesAD)
+{
+    TEST_KERNEL(test_int_ad_1);
+    TEST_KERNEL(test_int_ad_2);
+}
+
+TEST(P2P, MessagesAD)
+{
+    TEST_KERNEL(test_char_ad_1);
+    TEST_KERNEL(test_short_ad_1);
+    TEST_KERNEL(test_float_ad_1);
+    TEST_KERNEL(test_double_ad_1);
+}
+
+TEST(P2P, PersistentMessages)
+{
+    TEST_KERNEL(test_int_persistent);
+}
+
+TEST(P2P, VectorMessages)
+{
+    TEST_KERNEL(test_float_vec);
+    TEST_KERNEL(test_double_vec_push);
+    TEST_KERNEL(test_char_vec_pop);
+}
+
+TEST(P2P, NonBlockingMessages)
+{
+    TEST_KERNEL(test_nb);
+}
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+
+    comms[0]=SmiInit_p2p_rank0(0, RANK_COUNT, ROUTING_DIR, runtime);
+    for(int i=1;i<RANK_COUNT;i++)
+        comms[i]=SmiInit_p2p_rank1(i, RANK_COUNT, ROUTING_DIR, runtime);
+
+    int result = RUN_ALL_TESTS();
+    runtime.stop();
+    return result;
+}
@@ -170,3 +170,119 @@ __kernel void test_short_min(const int N, char root, __global volatile char *mem
     }
     *mem=check;
 }
+
+__kernel void test_int_add_tree(const int N, char root, __global volatile char *mem, SMI_Comm comm)
+{
+    unsigned int my_rank=SMI_Comm_rank(comm);
+    unsigned int num_ranks=SMI_Comm_size(comm);
+    int exp=(num_ranks*(num_ranks+1))/2;
+    char check=1;
+
+    SMI_RChannel  __attribute__((register)) rchan_int= SMI_Open_reduce_channel(N, SMI_INT, SMI_ADD, 9,root,comm);
+    rchan_int.fanout=2; //binary tree
+    for(int i=0;i<N;i++)
+    {
+        int to_comm, to_rcv=0;
+        to_comm=my_rank+1;
+        SMI_Reduce(&rchan_int,&to_comm, &to_rcv);
+        if(my_rank==root)
+            check &= (to_rcv==exp);
+    }
+    *mem=check;
+}
+
+__kernel void test_float_add_chain(const int N, char root, __global volatile char *mem, SMI_Comm comm)
+{
+    unsigned int my_rank=SMI_Comm_rank(comm);
+    unsigned int num_ranks=SMI_Comm_size(comm);
+    char check=1;
+
+    SMI_RChannel  __attribute__((register)) rchan_float= SMI_Open_reduce_channel(N, SMI_FLOAT, SMI_ADD, 10,root,comm);
+    rchan_float.fanout=1; //every rank forwards to the previous one
+    for(int i=0;i<N;i++)
+    {
+        float to_comm, to_rcv=0;
+        to_comm=i; //everyone sends i
+        SMI_Reduce(&rchan_float,&to_comm, &to_rcv);
+        if(my_rank==root)
+            check &= (to_rcv==num_ranks*i);
+    }
+    *mem=check;
+}
+
+__kernel void test_int_allreduce(const int N, char root, __global volatile char *mem, SMI_Comm comm)
+{
+    unsigned int my_rank=SMI_Comm_rank(comm);
+    unsigned int num_ranks=SMI_Comm_size(comm);
+    int exp=(num_ranks*(num_ranks+1))/2;
+    char check=1;
+
+    SMI_ARChannel  __attribute__((register)) archan_int= SMI_Open_allreduce_channel(N, SMI_INT, SMI_ADD, 11,comm);
+    for(int i=0;i<N;i++)
+    {
+        int to_comm, to_rcv=0;
+        to_comm=my_rank+1;
+        SMI_Allreduce(&archan_int,&to_comm, &to_rcv);
+        check &= (to_rcv==exp);     //every rank receives the result
+    }
+    *mem=check;
+}
+
+__kernel void test_float_allreduce_chain(const int N, char root, __global volatile char *mem, SMI_Comm comm)
+{
+    unsigned int my_rank=SMI_Comm_rank(comm);
+    unsigned int num_ranks=SMI_Comm_size(comm);
+    char check=1;
+
+    SMI_ARChannel  __attribute__((register)) archan_float= SMI_Open_allreduce_channel(N, SMI_FLOAT, SMI_MAX, 12,comm);
+    archan_float.fanout=1;
+    for(int i=0;i<N;i++)
+    {
+        float to_comm, to_rcv=0;
+        to_comm=i+my_rank;
+        SMI_Allreduce(&archan_float,&to_comm, &to_rcv);
+        check &= (to_rcv==i+num_ranks-1);
+    }
+    *mem=check;
+}
+
+__kernel void test_double_add_partial(const int N, char root, __global volatile char *mem, SMI_Comm comm)
+{
+    //the contributions travel in packets of 3 doubles: the last packet is partial if N is not a multiple of 3.
+    //The elements differ within a packet, so that the lanes are combined in the right order
+    unsigned int my_rank=SMI_Comm_rank(comm);
+    unsigned int num_ranks=SMI_Comm_size(comm);
+    char check=1;
+
+    SMI_RChannel  __attribute__((register)) rchan_double= SMI_Open_reduce_channel(N, SMI_DOUBLE, SMI_ADD, 13,root,comm);
+    for(int i=0;i<N;i++)
+    {
+        double to_comm, to_rcv=0;
+        to_comm=i*(my_rank+1);
+        SMI_Reduce(&rchan_double,&to_comm, &to_rcv);
+        if(my_rank==root)
+            check &= (to_rcv==i*(num_ranks*(num_ranks+1))/2);
+    }
+    *mem=check;
+}
+
+__kernel void test_int_add_tree_partial(const int N, char root, __global volatile char *mem, SMI_Comm comm)
+{
+    //packed partial results along a tree with three children per rank, ending with a partial packet
+    //if N is not a multiple of 7
+    unsigned int my_rank=SMI_Comm_rank(comm);
+    unsigned int num_ranks=SMI_Comm_size(comm);
+    char check=1;
+
+    SMI_RChannel  __attribute__((register)) rchan_int= SMI_Open_reduce_channel(N, SMI_INT, SMI_ADD, 14,root,comm);
+    rchan_int.fanout=3;
+    for(int i=0;i<N;i++)
+    {
+        int to_comm, to_rcv=0;
+        to_comm=i*num_ranks+my_rank;
+        SMI_Reduce(&rchan_int,&to_comm, &to_rcv);
+        if(my_rank==root)
+            check &= (to_rcv==i*num_ranks*num_ranks+(num_ranks*(num_ranks-1))/2);
+    }
+    *mem=check;
+}